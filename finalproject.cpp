@@ -4,1332 +4,9939 @@
 #include <stdexcept>
 #include <memory>
 #include <limits>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <coroutine>
+#include <optional>
+#include <variant>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <cctype>
+#include <map>
+#include <list>
+#include <algorithm>
+#include <iomanip>
+#include <shared_mutex>
+#include <sstream>
+#include <random>
+#include <iterator>
+#include <numeric>
+#include <cmath>
+#include <cerrno>
+#include <fcntl.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#include <sys/stat.h>
+#endif
+// Opt in to the io_uring backend of AsyncIo with -DLMS_USE_IO_URING (Linux 5.6
+// or later). It talks to the kernel directly, so it needs no library or link flag.
+#ifdef LMS_USE_IO_URING
+#if defined(_WIN32) || !__has_include(<linux/io_uring.h>)
+#error "LMS_USE_IO_URING needs Linux and <linux/io_uring.h>"
+#endif
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 using namespace std;
 
-// Forward declarations
-class Admin;
-class Teacher;
-class Student;
-
-class UserActionStrategy {
-public:
-    virtual void execute() = 0; // Pure virtual function
-    virtual ~UserActionStrategy() = default; // Virtual destructor
-};
-
+// Coroutine task used by the menu flows. A Task starts suspended; awaiting it
+// runs it to completion and resumes the awaiting coroutine afterwards.
+template <typename T = void>
+class Task;
+
+struct TaskPromiseBase {
+    coroutine_handle<> continuation;
+    exception_ptr error;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        coroutine_handle<> await_suspend(coroutine_handle<Promise> finished) noexcept {
+            coroutine_handle<> next = finished.promise().continuation;
+            return next ? next : noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
 
-class InvalidCourseIndexException : public runtime_error {
-public:
-    InvalidCourseIndexException() : runtime_error("Invalid course index!") {}
+    suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = current_exception(); }
 };
-class Validator {
-public:
-    static bool isValidEmail(const string& email) {
-        // Basic email validation
-        size_t atPos = email.find('@');
-        size_t dotPos = email.rfind('.');
-        return atPos != string::npos && dotPos != string::npos && 
-               atPos < dotPos && atPos > 0 && 
-               dotPos < email.length() - 1;
-    }
 
-    static bool isValidGrade(int grade) {
-        return grade >= 0 && grade <= 100;
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    optional<T> value;
+    void return_value(T result) { value = move(result); }
+    T takeResult() {
+        if (error) {
+            rethrow_exception(error);
+        }
+        return move(*value);
     }
+};
 
-    static bool isValidIndex(int index, int maxSize) {
-        return index >= 0 && index < maxSize;
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    void return_void() {}
+    void takeResult() {
+        if (error) {
+            rethrow_exception(error);
+        }
     }
+};
 
-    static bool isValidString(const string& str) {
-        return !str.empty() && str.length() <= 100;  // Arbitrary max length
-    }
+template <typename T>
+class Task {
+public:
+    struct promise_type : TaskPromise<T> {
+        Task get_return_object() {
+            return Task(coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
 
-    static int getValidatedIntInput(const string& prompt, int min, int max) {
-        int input;
-        bool validInput = false;
-        do {
-            cout << prompt;
-            if (cin >> input) {
-                if (input >= min && input <= max) {
-                    validInput = true;
-                } else {
-                    cout << "Please enter a number between " << min << " and " << max << ".\n";
-                }
-            } else {
-                cin.clear();
-                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                cout << "Invalid input. Please enter a number.\n";
-                
-            }
-        } while (!validInput);
-        return input;
-    }
-};
+private:
+    coroutine_handle<promise_type> handle;
 
-// Base User class
-class User {
-protected:
-    string username;
-    string email;
-    string password;
-    unique_ptr<UserActionStrategy> actionStrategy; // Strategy member
+    explicit Task(coroutine_handle<promise_type> handle) : handle(handle) {}
 
 public:
-    User(string username, string email, string password)
-        : username(username), email(email), password(password) {}
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
 
-    void setActionStrategy(UserActionStrategy* strategy) {
-        actionStrategy.reset(strategy); // Set the strategy
-    }
-
-    void performAction() {
-        if (actionStrategy) {
-            actionStrategy->execute(); // Execute the strategy
+    ~Task() {
+        if (handle) {
+            handle.destroy();
         }
     }
 
-    virtual void displayMenu() = 0; // Pure virtual function
-    virtual ~User() = default; // Virtual destructor
-
-    string getEmail() const { return email; }
-    string getPassword() const { return password; }
-};
+    // Awaiting a task from another coroutine
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> caller) noexcept {
+        handle.promise().continuation = caller;
+        return handle;
+    }
+    T await_resume() { return handle.promise().takeResult(); }
 
-class ValidationException : public runtime_error {
-public:
-    ValidationException(const string& msg) : runtime_error(msg) {}
+    // Driving a top-level task (a session) from ordinary code
+    void start() { handle.resume(); }
+    bool isDone() const { return handle.done(); }
+    T result() { return handle.promise().takeResult(); }
 };
 
-using UserPtr = shared_ptr<User>;
-vector<UserPtr> users; 
-
-// Forward declarations
-class Course;
-class LMSManager;
+// Escaping for tab-separated text records (session traces, mutation log)
+string escapeField(const string& text) {
+    string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\r': escaped += "\\r"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
 
-// Admin class
-class Admin : public User {
-public:
-     Admin(string username, string email, string password)
-        : User(username, email, password) {}
+string unescapeField(const string& text) {
+    string plain;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            char code = text[++i];
+            plain += code == 'n' ? '\n' : code == 't' ? '\t' : code == 'r' ? '\r' : code;
+        } else {
+            plain += text[i];
+        }
+    }
+    return plain;
+}
 
-    void displayMenu() override;
-    void manageCourses();
-    void addCourse();
-    void deleteCourse();
-    void editCourse();
-    void viewReports();
-    void enrollStudent();    
-    void removeStudent();   
-};
+// Records every chunk of input a session receives, with its arrival time and
+// the screen that was waiting for it. One tab-separated record per line:
+// microseconds since start, screen, escaped text.
+class SessionRecorder {
+private:
+    ofstream file;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
 
-// Teacher class
-class Teacher : public User {
 public:
-    Teacher(string username, string email, string password)
-        : User(username, email, password) {}
+    explicit SessionRecorder(const string& path) : file(path) {
+        if (!file) {
+            throw runtime_error("Cannot open trace file: " + path);
+        }
+        file << "# LMS session trace v1\n";
+    }
 
-    void displayMenu() override;
-    void manageCourses();
-    void viewCourse();
-    void viewReports();
-    void addGrade(); 
-    void addContent(); 
-    void viewAssignedStudents();
+    void record(const string& screen, const string& text) {
+        long long offset = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - started).count();
+        file << offset << '\t' << screen << '\t' << escapeField(text) << '\n';
+        file.flush(); // Keep the trace usable even if the program is killed
+    }
 };
 
-// Student class
-class Student : public User {
+class SessionClosedException : public runtime_error {
 public:
-    Student(string username, string email, string password)
-        : User(username, email, password) {}
-
-    void displayMenu() override;
-    void viewEnrolledCourses();
-    void viewGrades();
-    void enrollInCourse();
+    SessionClosedException() : runtime_error("Session input closed") {}
 };
 
+class Session;
 
-// Concrete Strategies
-class AdminActions : public UserActionStrategy {
-    Admin* admin;
+// Labels the session with the current screen for traces and latency reports,
+// restoring the parent screen when the screen coroutine returns
+class ScreenScope {
+private:
+    Session& session;
+    string previous;
 
 public:
-    AdminActions(Admin* admin) : admin(admin) {}
-
-    void execute() override {
-        admin->displayMenu(); // Call the Admin menu
-    }
+    ScreenScope(Session& session, const string& name);
+    ~ScreenScope();
 };
 
-class TeacherActions : public UserActionStrategy {
-    Teacher* teacher;
+// Puts back a stream's format flags and precision when the screen that
+// changed them returns, including when it ends by an exception
+class StreamFormatScope {
+private:
+    ostream& stream;
+    ios::fmtflags flags;
+    streamsize precision;
 
 public:
-    TeacherActions(Teacher* teacher) : teacher(teacher) {}
-
-    void execute() override {
-        teacher->displayMenu(); // Call the Teacher menu
+    explicit StreamFormatScope(ostream& stream)
+        : stream(stream), flags(stream.flags()), precision(stream.precision()) {}
+    ~StreamFormatScope() {
+        stream.flags(flags);
+        stream.precision(precision);
     }
 };
 
-class StudentActions : public UserActionStrategy {
-    Student* student;
-
-public:
-    StudentActions(Student* student) : student(student) {}
+// One menu session: buffered text input plus the stream its screens print to.
+// Reads parse the buffer the way `cin >>` and `getline` would. When the buffer
+// runs dry the session either pulls another line from its blocking source
+// (the console) or suspends until feed() delivers more text, which lets a
+// single thread multiplex many sessions.
+class Session {
+private:
+    string buffer;
+    size_t readPos = 0;
+    bool inputClosed = false;
+    ostream* output;
+    function<bool(string&)> blockingSource;
+    coroutine_handle<> waiting;
+    function<bool()> pendingRead; // Retries the suspended read when input arrives
+    string screen = "Login";      // Screen currently waiting for input
+    SessionRecorder* recorder = nullptr;
+    string source = "console";    // Where the input comes from, for login throttling
+
+    void appendInput(const string& text) {
+        if (recorder) {
+            recorder->record(screen, text);
+        }
+        buffer += text;
+    }
 
-    void execute() override {
-        student->displayMenu(); // Call the Student menu
+    void skipWhitespace() {
+        while (readPos < buffer.size() && isspace(static_cast<unsigned char>(buffer[readPos]))) {
+            ++readPos;
+        }
     }
-};
 
-// Course class
-class Course {
-private:
-    string courseName;
-    string teacherEmail;
-    vector<string> contents;
-    vector<pair<string, int>> grades;
-    vector<string> enrolledStudents;
-    
-     
+    void compact() {
+        if (readPos > 4096) {
+            buffer.erase(0, readPos);
+            readPos = 0;
+        }
+    }
 
-public:
-    Course(string courseName, string teacherEmail) {
-        if (!Validator::isValidString(courseName)) {
-            throw ValidationException("Invalid course name");
+    // Parsers: return true once they could complete with the buffered text
+    bool parseToken(string& token) {
+        skipWhitespace();
+        size_t end = readPos;
+        while (end < buffer.size() && !isspace(static_cast<unsigned char>(buffer[end]))) {
+            ++end;
         }
-        if (!Validator::isValidEmail(teacherEmail)) {
-            throw ValidationException("Invalid teacher email");
+        if (end == readPos || (end == buffer.size() && !inputClosed)) {
+            return false; // Token may continue in the next chunk
         }
-        this->courseName = courseName;
-        this->teacherEmail = teacherEmail;
+        token = buffer.substr(readPos, end - readPos);
+        readPos = end;
+        return true;
     }
 
-    void addContent(string content) {
-        if (!Validator::isValidString(content)) {
-            throw ValidationException("Invalid content");
+    bool parseInt(int& value) {
+        // Mirrors `cin >> int`: optional sign and digits; anything else reads as 0
+        skipWhitespace();
+        size_t end = readPos;
+        if (end < buffer.size() && (buffer[end] == '+' || buffer[end] == '-')) {
+            ++end;
         }
-        contents.push_back(content);
+        size_t digitsStart = end;
+        while (end < buffer.size() && isdigit(static_cast<unsigned char>(buffer[end]))) {
+            ++end;
+        }
+        if (end == buffer.size() && !inputClosed) {
+            return false;
+        }
+        if (end == digitsStart) {
+            // Not a number: drop the rest of the line like the old clear()/ignore() did
+            if (readPos == buffer.size()) {
+                return false;
+            }
+            size_t newline = buffer.find('\n', readPos);
+            readPos = newline == string::npos ? buffer.size() : newline + 1;
+            value = 0;
+            return true;
+        }
+        try {
+            value = stoi(buffer.substr(readPos, end - readPos));
+        } catch (const out_of_range&) {
+            value = 0;
+        }
+        readPos = end;
+        return true;
     }
 
-    void removeContent(int index) {
-        if (!Validator::isValidIndex(index, contents.size())) {
-            throw InvalidCourseIndexException();
+    bool parseChar(char& value) {
+        skipWhitespace();
+        if (readPos >= buffer.size()) {
+            return false;
         }
-        contents.erase(contents.begin() + index);
+        value = buffer[readPos++];
+        return true;
     }
 
-    void displayContents() const {
-        if (contents.empty()) {
-        cout << "No content available for this course.\n";
-        return;
+    bool parseLine(string& line) {
+        size_t newline = buffer.find('\n', readPos);
+        if (newline == string::npos) {
+            if (!inputClosed || readPos >= buffer.size()) {
+                return false;
+            }
+            newline = buffer.size();
+        }
+        line = buffer.substr(readPos, newline - readPos);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        readPos = min(buffer.size(), newline + 1);
+        return true;
     }
 
-    cout << "Course Contents:\n";
-    for (const auto& content : contents) {
-        cout << "- " << content << endl;
+    bool parseIgnore() {
+        if (readPos >= buffer.size()) {
+            return false;
+        }
+        ++readPos;
+        return true;
     }
-}
 
-    void addGrade(const string& studentEmail, int grade) {
-        if (!Validator::isValidEmail(studentEmail)) {
-            throw ValidationException("Invalid student email");
+    template <typename Value, bool (Session::*Parse)(Value&)>
+    struct InputAwaiter {
+        Session& session;
+        Value value{};
+        bool parsed = false;
+
+        bool await_ready() {
+            parsed = (session.*Parse)(value);
+            // Console sessions block for the next line instead of suspending
+            while (!parsed && session.blockingSource && !session.inputClosed) {
+                string line;
+                if (session.blockingSource(line)) {
+                    session.appendInput(line + '\n');
+                } else {
+                    session.inputClosed = true;
+                }
+                parsed = (session.*Parse)(value);
+            }
+            return parsed || session.inputClosed;
         }
-        if (!Validator::isValidGrade(grade)) {
-            throw ValidationException("Invalid grade");
+
+        void await_suspend(coroutine_handle<> reader) {
+            session.waiting = reader;
+            session.pendingRead = [this] { return parsed = (session.*Parse)(value); };
+        }
+
+        Value await_resume() {
+            if (!parsed && !(session.*Parse)(value)) {
+                throw SessionClosedException();
+            }
+            session.compact();
+            return value;
         }
-        grades.push_back({studentEmail, grade});
+    };
+
+public:
+    explicit Session(ostream& output, function<bool(string&)> blockingSource = nullptr)
+        : output(&output), blockingSource(move(blockingSource)) {}
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // A session reading standard input, as used by the console program
+    static function<bool(string&)> consoleSource() {
+        return [](string& line) { return static_cast<bool>(getline(cin, line)); };
     }
 
-    const vector<pair<string, int>>& getGrades() const {
-        return grades;
+    ostream& out() { return *output; }
+    bool isConsole() const { return static_cast<bool>(blockingSource); }
+    bool isWaitingForInput() const { return static_cast<bool>(waiting); }
+
+    // Deliver more input and resume the session if it was waiting for it
+    void feed(const string& text) {
+        appendInput(text);
+        resumeReader();
     }
-    
 
-    void displayGrades() const {
-        for (const auto& grade : grades) {
-            cout << grade.first << ": " << grade.second << "%" << endl;
-        }
+    void setRecorder(SessionRecorder* sessionRecorder) { recorder = sessionRecorder; }
+
+    void setSource(const string& name) { source = name; }
+    const string& getSource() const { return source; }
+
+    const string& currentScreen() const { return screen; }
+
+    // Returns the previous screen so callers can restore it
+    string enterScreen(const string& name) {
+        string previous = screen;
+        screen = name;
+        return previous;
     }
 
-    void enrollStudent(const string& studentEmail) {
-    if (!Validator::isValidEmail(studentEmail)) {
-        throw ValidationException("Invalid student email");
+    void closeInput() {
+        inputClosed = true;
+        resumeReader();
     }
 
-    // Manually check if the student is already enrolled
-    for (const auto& enrolledEmail : enrolledStudents) {
-        if (enrolledEmail == studentEmail) {
-            throw ValidationException("Student already enrolled");
+    // Console-only screen helpers; headless sessions skip them
+    void clear() {
+        if (isConsole()) {
+            system("cls");
         }
     }
 
-    enrolledStudents.push_back(studentEmail); // Enroll the student
-}
-
-   void removeStudent(const string& studentEmail) {
-    // Manually search for the studentEmail in the enrolledStudents vector
-    for (auto it = enrolledStudents.begin(); it != enrolledStudents.end(); ++it) {
-        if (*it == studentEmail) {
-            enrolledStudents.erase(it); // Remove the student
-            return; // Exit the function after removing
+    void pause() {
+        if (isConsole()) {
+            system("pause");
         }
     }
-    
-    // If we reach here, the student was not found
-    throw ValidationException("Student not found");
-}
 
-    void displayStudents() const {
-        for (const auto& student : enrolledStudents) {
-            cout << student << endl;
+    auto readToken() { return InputAwaiter<string, &Session::parseToken>{*this}; }
+    auto readInt() { return InputAwaiter<int, &Session::parseInt>{*this}; }
+    auto readChar() { return InputAwaiter<char, &Session::parseChar>{*this}; }
+    auto readLine() { return InputAwaiter<string, &Session::parseLine>{*this}; }
+    auto ignoreChar() { return InputAwaiter<char, &Session::parseIgnoreChar>{*this}; }
+
+private:
+    void resumeReader() {
+        // Only wake the reader once its read can complete (or never will)
+        if (waiting && (pendingRead() || inputClosed)) {
+            coroutine_handle<> reader = waiting;
+            waiting = nullptr;
+            pendingRead = nullptr;
+            reader.resume();
         }
     }
 
-    string getCourseName() const { return courseName; }
-    string getTeacherEmail() const { return teacherEmail; }
-    const vector<string>& getStudents() const { return enrolledStudents; }
-    const vector<string>& getContents() const { return contents; }
+    bool parseIgnoreChar(char& value) {
+        value = readPos < buffer.size() ? buffer[readPos] : '\0';
+        return parseIgnore();
+    }
 };
 
+ScreenScope::ScreenScope(Session& session, const string& name)
+    : session(session), previous(session.enterScreen(name)) {}
 
+ScreenScope::~ScreenScope() {
+    session.enterScreen(previous);
+}
 
-// LMSManager class (Singleton)
-class LMSManager {
-private:
-    vector<Course> courses;
-    static unique_ptr<LMSManager> instance;
-    LMSManager() = default;
+// Forward declarations
+class Admin;
+class Teacher;
+class Student;
 
+class InvalidCourseIndexException : public runtime_error {
 public:
-    static LMSManager* getInstance() {
-        if (!instance) {
-            instance = unique_ptr<LMSManager>(new LMSManager());
-        }
-        return instance.get();
+    InvalidCourseIndexException() : runtime_error("Invalid course index!") {}
+};
+class Validator {
+public:
+    static constexpr size_t MAX_EMAIL_LENGTH = 255; // Longest key of the email index
+
+    static bool isValidEmail(const string& email) {
+        // Basic email validation
+        size_t atPos = email.find('@');
+        size_t dotPos = email.rfind('.');
+        return email.size() <= MAX_EMAIL_LENGTH && atPos != string::npos && dotPos != string::npos && 
+               atPos < dotPos && atPos > 0 && 
+               dotPos < email.length() - 1;
     }
 
-    void addCourse(const Course& course) {
-        courses.push_back(course);
+    static bool isValidGrade(int grade) {
+        return grade >= 0 && grade <= 100;
     }
-    
 
-    Course& getCourse(int index) {
-        if (!Validator::isValidIndex(index, courses.size())) {
-            throw InvalidCourseIndexException();
-        }
-        return courses[index];
+    static bool isValidIndex(int index, int maxSize) {
+        return index >= 0 && index < maxSize;
     }
 
-    void removeCourse(int index) {
-        if (!Validator::isValidIndex(index, courses.size())) {
-            throw InvalidCourseIndexException();
+    static bool isValidString(const string& str) {
+        return !str.empty() && str.length() <= 100;  // Arbitrary max length
+    }
+
+    static Task<int> getValidatedIntInput(Session& session, const string& prompt, int min, int max) {
+        int input;
+        bool validInput = false;
+        do {
+            session.out() << prompt;
+            string token = co_await session.readToken();
+            size_t parsed = 0;
+            try {
+                input = stoi(token, &parsed);
+            } catch (const exception&) {
+                parsed = 0;
+            }
+            if (parsed > 0) {
+                if (input >= min && input <= max) {
+                    validInput = true;
+                } else {
+                    session.out() << "Please enter a number between " << min << " and " << max << ".\n";
+                }
+            } else {
+                session.out() << "Invalid input. Please enter a number.\n";
+                
+            }
+        } while (!validInput);
+        co_return input;
+    }
+
+    static Task<double> getValidatedDoubleInput(Session& session, const string& prompt, double min, double max) {
+        while (true) {
+            session.out() << prompt;
+            string token = co_await session.readToken();
+            size_t parsed = 0;
+            double input = 0.0;
+            try {
+                input = stod(token, &parsed);
+            } catch (const exception&) {
+                parsed = 0;
+            }
+            if (parsed == 0 || !isfinite(input)) {
+                session.out() << "Invalid input. Please enter a number.\n";
+            } else if (input < min || input > max) {
+                session.out() << "Please enter a number between " << min << " and " << max << ".\n";
+            } else {
+                co_return input;
+            }
         }
-        courses.erase(courses.begin() + index);
     }
+};
 
-    void displayCourses() const {
-        if (courses.empty()) {
-            cout << "There are no courses available.\n";
-            return;
+// SHA-256 (FIPS 180-4), used for password hashing
+class Sha256 {
+private:
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t block[64];
+    size_t blockLength = 0;
+    uint64_t totalBytes = 0;
+
+    static uint32_t rotateRight(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t* data) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16) |
+                   (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
         }
-        for (size_t i = 0; i < courses.size(); ++i) {
-            cout << i + 1 << ": " << courses[i].getCourseName()
-                 << " (Teacher: " << courses[i].getTeacherEmail() << ")" << endl;
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+            uint32_t choose = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + choose + k[i] + w[i];
+            uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + majority;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
         }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
     }
 
-    vector<Course>& getCourses() { return courses; }
+public:
+    static const size_t DIGEST_SIZE = 32;
+
+    void update(const uint8_t* data, size_t length) {
+        totalBytes += length;
+        while (length > 0) {
+            size_t take = min(length, 64 - blockLength);
+            memcpy(block + blockLength, data, take);
+            blockLength += take;
+            data += take;
+            length -= take;
+            if (blockLength == 64) {
+                compress(block);
+                blockLength = 0;
+            }
+        }
+    }
+
+    void update(const string& text) { update(reinterpret_cast<const uint8_t*>(text.data()), text.size()); }
+
+    void finish(uint8_t digest[DIGEST_SIZE]) {
+        uint64_t bits = totalBytes * 8;
+        uint8_t padding = 0x80;
+        update(&padding, 1);
+        padding = 0;
+        while (blockLength != 56) {
+            update(&padding, 1);
+        }
+        uint8_t length[8];
+        for (int i = 0; i < 8; ++i) {
+            length[i] = uint8_t(bits >> (56 - i * 8));
+        }
+        update(length, 8);
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4] = uint8_t(state[i] >> 24);
+            digest[i * 4 + 1] = uint8_t(state[i] >> 16);
+            digest[i * 4 + 2] = uint8_t(state[i] >> 8);
+            digest[i * 4 + 3] = uint8_t(state[i]);
+        }
+    }
 };
 
-// Initialize static member of LMSManager
-unique_ptr<LMSManager> LMSManager::instance;
+// Salted PBKDF2-HMAC-SHA256 password hashes, stored as
+// "pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>". The iteration count is
+// the work factor; it is recorded in each hash, so raising it only affects
+// passwords hashed afterwards.
+class PasswordHasher {
+private:
+    static inline atomic<uint32_t> iterations{10000};
+
+    static string toHex(const uint8_t* bytes, size_t length) {
+        static const char digits[] = "0123456789abcdef";
+        string hex;
+        for (size_t i = 0; i < length; ++i) {
+            hex += digits[bytes[i] >> 4];
+            hex += digits[bytes[i] & 15];
+        }
+        return hex;
+    }
+
+    // Empty unless the text is whole bytes of hex digits
+    static vector<uint8_t> fromHex(const string& hex) {
+        auto nibble = [](char digit) {
+            if (digit >= '0' && digit <= '9') return digit - '0';
+            if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+            if (digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+            return -1;
+        };
+        vector<uint8_t> bytes;
+        if (hex.size() % 2 != 0) {
+            return bytes;
+        }
+        for (size_t i = 0; i < hex.size(); i += 2) {
+            int high = nibble(hex[i]), low = nibble(hex[i + 1]);
+            if (high < 0 || low < 0) {
+                return {};
+            }
+            bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+        }
+        return bytes;
+    }
+
+    // PBKDF2 with one 32-byte output block. The HMAC inner and outer states
+    // for the password are computed once and copied for every iteration.
+    static void derive(const string& password, const vector<uint8_t>& salt, uint32_t rounds,
+                       uint8_t output[Sha256::DIGEST_SIZE]) {
+        uint8_t key[64] = {0};
+        if (password.size() > 64) {
+            Sha256 keyHash;
+            keyHash.update(password);
+            keyHash.finish(key);
+        } else {
+            memcpy(key, password.data(), password.size());
+        }
+        uint8_t innerPad[64], outerPad[64];
+        for (int i = 0; i < 64; ++i) {
+            innerPad[i] = key[i] ^ 0x36;
+            outerPad[i] = key[i] ^ 0x5c;
+        }
+        Sha256 inner, outer;
+        inner.update(innerPad, 64);
+        outer.update(outerPad, 64);
+
+        auto hmac = [&inner, &outer](const uint8_t* data, size_t length, uint8_t digest[Sha256::DIGEST_SIZE]) {
+            Sha256 innerHash = inner;
+            innerHash.update(data, length);
+            innerHash.finish(digest);
+            Sha256 outerHash = outer;
+            outerHash.update(digest, Sha256::DIGEST_SIZE);
+            outerHash.finish(digest);
+        };
+
+        vector<uint8_t> first = salt;
+        first.insert(first.end(), {0, 0, 0, 1}); // Block index 1
+        uint8_t u[Sha256::DIGEST_SIZE];
+        hmac(first.data(), first.size(), u);
+        memcpy(output, u, Sha256::DIGEST_SIZE);
+        for (uint32_t round = 1; round < rounds; ++round) {
+            hmac(u, Sha256::DIGEST_SIZE, u);
+            for (size_t i = 0; i < Sha256::DIGEST_SIZE; ++i) {
+                output[i] ^= u[i];
+            }
+        }
+    }
+
+public:
+    static void setIterations(uint32_t count) { iterations = max<uint32_t>(1, count); }
+    static uint32_t getIterations() { return iterations; }
+
+    static string hash(const string& password, uint32_t rounds = 0) {
+        if (rounds == 0) {
+            rounds = iterations;
+        }
+        static thread_local mt19937_64 random(random_device{}());
+        vector<uint8_t> salt(16);
+        for (auto& byte : salt) {
+            byte = static_cast<uint8_t>(random());
+        }
+        uint8_t derived[Sha256::DIGEST_SIZE];
+        derive(password, salt, rounds, derived);
+        return "pbkdf2-sha256$" + to_string(rounds) + "$" + toHex(salt.data(), salt.size()) + "$" +
+               toHex(derived, Sha256::DIGEST_SIZE);
+    }
+
+    // A stored hash in fixed-width binary form, for columnar storage
+    struct Credential {
+        static const size_t SALT_SIZE = 16;
+        uint32_t iterations = 0;
+        uint8_t salt[SALT_SIZE] = {};
+        uint8_t digest[Sha256::DIGEST_SIZE] = {};
+    };
+
+    // Parses the text form; returns false, never throws, if it is not a hash this class wrote
+    static bool pack(const string& stored, Credential& credential) {
+        size_t first = stored.find('$');
+        size_t second = stored.find('$', first + 1);
+        size_t third = stored.find('$', second + 1);
+        if (first == string::npos || second == string::npos || third == string::npos ||
+            stored.compare(0, first, "pbkdf2-sha256") != 0) {
+            return false;
+        }
+        string rounds = stored.substr(first + 1, second - first - 1);
+        if (rounds.empty() || rounds.size() > 9 ||
+            !all_of(rounds.begin(), rounds.end(), [](char digit) { return digit >= '0' && digit <= '9'; })) {
+            return false;
+        }
+        vector<uint8_t> salt = fromHex(stored.substr(second + 1, third - second - 1));
+        vector<uint8_t> digest = fromHex(stored.substr(third + 1));
+        if (salt.size() != Credential::SALT_SIZE || digest.size() != Sha256::DIGEST_SIZE) {
+            return false;
+        }
+        credential.iterations = static_cast<uint32_t>(stoul(rounds));
+        memcpy(credential.salt, salt.data(), Credential::SALT_SIZE);
+        memcpy(credential.digest, digest.data(), Sha256::DIGEST_SIZE);
+        return true;
+    }
+
+    // A credential no password matches, at the current work factor. Checking an
+    // unknown account against it makes that login cost as much as a wrong password.
+    static Credential dummy() {
+        Credential credential;
+        credential.iterations = iterations;
+        return credential;
+    }
+
+    static string unpack(const Credential& credential) {
+        return "pbkdf2-sha256$" + to_string(credential.iterations) + "$" +
+               toHex(credential.salt, Credential::SALT_SIZE) + "$" + toHex(credential.digest, Sha256::DIGEST_SIZE);
+    }
+
+    // Compares in constant time so the mismatch position does not leak
+    static bool verify(const string& password, const Credential& credential) {
+        vector<uint8_t> salt(credential.salt, credential.salt + Credential::SALT_SIZE);
+        uint8_t derived[Sha256::DIGEST_SIZE];
+        derive(password, salt, credential.iterations, derived);
+        uint8_t difference = 0;
+        for (size_t i = 0; i < Sha256::DIGEST_SIZE; ++i) {
+            difference |= derived[i] ^ credential.digest[i];
+        }
+        return difference == 0;
+    }
+
+    static bool verify(const string& password, const string& stored) {
+        Credential credential;
+        return pack(stored, credential) && verify(password, credential);
+    }
+};
+
+// Account fields shared by every role. Roles are plain value types held in a
+// UserRecord variant, so there are no virtual calls or shared ownership.
+class User {
+protected:
+    string username;
+    string email;
+    string passwordHash; // PasswordHasher format, never the plaintext
+
+public:
+    User(string username, string email, string passwordHash)
+        : username(username), email(email), passwordHash(passwordHash) {}
+
+    const string& getEmail() const { return email; }
+    const string& getPasswordHash() const { return passwordHash; }
+    const string& getUsername() const { return username; }
+};
+
+class ValidationException : public runtime_error {
+public:
+    ValidationException(const string& msg) : runtime_error(msg) {}
+};
+
+// One entry of the mutation log
+struct LogRecord {
+    uint64_t sequence = 0;
+    long long timestampMicros = 0; // Wall clock, so lag can be compared across processes
+    string operation;
+    vector<string> fields;
+
+    string serialize() const {
+        string line = to_string(sequence) + '\t' + to_string(timestampMicros) + '\t' + operation;
+        for (const auto& field : fields) {
+            line += '\t' + escapeField(field);
+        }
+        return line;
+    }
+
+    static LogRecord parse(const string& line) {
+        vector<string> parts;
+        size_t start = 0;
+        while (true) {
+            size_t tab = line.find('\t', start);
+            parts.push_back(line.substr(start, tab == string::npos ? string::npos : tab - start));
+            if (tab == string::npos) {
+                break;
+            }
+            start = tab + 1;
+        }
+        if (parts.size() < 3) {
+            throw runtime_error("Malformed log record: " + line);
+        }
+        LogRecord record;
+        record.sequence = stoull(parts[0]);
+        record.timestampMicros = stoll(parts[1]);
+        record.operation = parts[2];
+        for (size_t i = 3; i < parts.size(); ++i) {
+            record.fields.push_back(unescapeField(parts[i]));
+        }
+        return record;
+    }
+};
+
+long long wallClockMicros() {
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// How far a write must get before the caller that queued it continues
+enum class Durability {
+    Buffered,  // Queued for the I/O thread
+    Written,   // Handed to the operating system; survives the process dying
+    Synced     // On stable storage; survives a power loss
+};
+
+Durability parseDurability(const string& name) {
+    if (name == "buffered") {
+        return Durability::Buffered;
+    }
+    if (name == "written") {
+        return Durability::Written;
+    }
+    if (name == "synced") {
+        return Durability::Synced;
+    }
+    throw runtime_error("Unknown durability level: " + name);
+}
+
+#ifdef LMS_USE_IO_URING
+// The io_uring submission and completion rings, mapped straight from the
+// kernel. Only the AsyncIo thread uses them.
+class KernelRing {
+private:
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    void* cqMap = MAP_FAILED;
+    void* sqeMap = MAP_FAILED;
+    size_t sqMapSize = 0, cqMapSize = 0, sqeMapSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned entries = 0;
+    unsigned pushedTail = 0;   // Includes entries the kernel has not been told about
+    unsigned unsubmitted = 0;
+
+    int enter(unsigned toSubmit, unsigned minComplete) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                                        minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+    }
+
+    void release() {
+        if (sqeMap != MAP_FAILED) {
+            munmap(sqeMap, sqeMapSize);
+        }
+        if (cqMap != MAP_FAILED) {
+            munmap(cqMap, cqMapSize);
+        }
+        if (sqMap != MAP_FAILED) {
+            munmap(sqMap, sqMapSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        sqMap = cqMap = sqeMap = MAP_FAILED;
+        fd = -1;
+    }
+
+public:
+    KernelRing() = default;
+    KernelRing(const KernelRing&) = delete;
+    KernelRing& operator=(const KernelRing&) = delete;
+    ~KernelRing() { release(); }
+
+    // False when the kernel has no io_uring or refuses to create one
+    bool open(unsigned size) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, size, &params));
+        if (fd < 0) {
+            return false;
+        }
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqeMap = mmap(nullptr, sqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqMap == MAP_FAILED || cqMap == MAP_FAILED || sqeMap == MAP_FAILED) {
+            release();
+            return false;
+        }
+        char* sq = static_cast<char*>(sqMap);
+        char* cq = static_cast<char*>(cqMap);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqes = static_cast<io_uring_sqe*>(sqeMap);
+        entries = params.sq_entries;
+        pushedTail = *sqTail;
+        return true;
+    }
+
+    unsigned capacity() const { return entries; }
+
+    // A cleared submission entry; at most capacity() between submits
+    io_uring_sqe& push() {
+        unsigned index = pushedTail & *sqMask;
+        sqArray[index] = index;
+        ++pushedTail;
+        ++unsubmitted;
+        memset(&sqes[index], 0, sizeof(io_uring_sqe));
+        return sqes[index];
+    }
+
+    // Hands the pushed entries to the kernel and waits for that many completions.
+    // Returns 0 or a negative errno.
+    int submitAndWait() {
+        __atomic_store_n(sqTail, pushedTail, __ATOMIC_RELEASE);
+        unsigned waitFor = unsubmitted;
+        while (unsubmitted > 0) {
+            int submitted = enter(unsubmitted, waitFor);
+            if (submitted < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -errno;
+            }
+            unsubmitted -= submitted;
+        }
+        return 0;
+    }
+
+    // Next completion, waiting for one if none is ready. Returns 0 or a negative errno.
+    int next(io_uring_cqe& completion) {
+        while (true) {
+            unsigned head = *cqHead;
+            if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                completion = cqes[head & *cqMask];
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+            if (enter(0, 1) < 0 && errno != EINTR) {
+                return -errno;
+            }
+        }
+    }
+};
+#endif
+
+// File writes and syncs completed on one I/O thread. Callers queue requests
+// and get a ticket back. The thread takes everything queued since its last
+// pass as one batch, issues all of its writes together, then syncs each file
+// of the batch once, so concurrent committers share one fdatasync. Built with
+// LMS_USE_IO_URING, requests go through io_uring when the kernel allows it;
+// otherwise the thread issues plain pwrite and fdatasync calls.
+class AsyncIo {
+public:
+    using Ticket = uint64_t;
+
+    struct Stats {
+        uint64_t batches = 0;
+        uint64_t writes = 0;
+        uint64_t bytes = 0;
+        uint64_t syncRequests = 0;
+        uint64_t syncs = 0;      // Calls actually made after merging the requests of a batch
+    };
+
+private:
+    struct Request {
+        Ticket ticket;
+        int fd;
+        bool sync;           // Sync the file instead of writing
+        uint64_t offset;
+        string data;
+        string error;        // Set by the I/O thread when the request fails
+    };
+
+    mutex lock;
+    condition_variable queued;
+    condition_variable completed;
+    vector<Request> pending;    // Ticket order
+    Ticket nextTicket = 1;
+    Ticket writtenThrough = 0;  // Every write up to this ticket has completed
+    Ticket syncedThrough = 0;   // Every request up to this ticket has completed
+    // First failed request of each open file. It sticks until the file is
+    // closed: once a write is lost, nothing queued after it is safe either.
+    unordered_map<int, pair<Ticket, string>> fileErrors;
+    Stats counters;
+    thread worker;
+#ifdef LMS_USE_IO_URING
+    static const unsigned RING_ENTRIES = 256;
+    KernelRing ring;
+    atomic<bool> ringReady{false};  // Cleared for good if the ring ever fails
+#endif
+
+    static void writeFully(int fd, const string& data, size_t done, uint64_t offset) {
+        while (done < data.size()) {
+#ifdef _WIN32
+            _lseeki64(fd, static_cast<long long>(offset + done), SEEK_SET);
+            long long written = _write(fd, data.data() + done, static_cast<unsigned>(data.size() - done));
+#else
+            ssize_t written = pwrite(fd, data.data() + done, data.size() - done, static_cast<off_t>(offset + done));
+#endif
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw runtime_error(string("Write failed: ") + strerror(errno));
+            }
+            done += written;
+        }
+    }
+
+    static void syncFully(int fd) {
+#ifdef _WIN32
+        int result = _commit(fd);
+#elif defined(__APPLE__)
+        int result = fsync(fd);
+#else
+        int result = fdatasync(fd);
+#endif
+        if (result != 0) {
+            throw runtime_error(string("Sync failed: ") + strerror(errno));
+        }
+    }
+
+    static void runDirect(Request& request) {
+        try {
+            if (request.sync) {
+                syncFully(request.fd);
+            } else {
+                writeFully(request.fd, request.data, 0, request.offset);
+            }
+        } catch (const exception& e) {
+            request.error = e.what();
+        }
+    }
+
+#ifdef LMS_USE_IO_URING
+    // Submits up to a ring's worth of requests at a time and reaps their
+    // completions. A short write is finished with pwrite. If the ring itself
+    // fails, the rest of the requests run directly (writes at fixed offsets
+    // and syncs are safe to repeat) and the ring is not used again.
+    void runOnRing(vector<Request*>& requests) {
+        for (size_t first = 0; first < requests.size();) {
+            size_t last = min(requests.size(), first + ring.capacity());
+            for (size_t i = first; i < last; ++i) {
+                Request* request = requests[i];
+                io_uring_sqe& sqe = ring.push();
+                sqe.fd = request->fd;
+                if (request->sync) {
+                    sqe.opcode = IORING_OP_FSYNC;
+                    sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+                } else {
+                    sqe.opcode = IORING_OP_WRITE;
+                    sqe.addr = reinterpret_cast<uint64_t>(request->data.data());
+                    sqe.len = static_cast<uint32_t>(request->data.size());
+                    sqe.off = request->offset;
+                }
+                sqe.user_data = reinterpret_cast<uint64_t>(request);
+            }
+            bool failed = ring.submitAndWait() < 0;
+            for (size_t i = first; i < last && !failed; ++i) {
+                io_uring_cqe completion;
+                if (ring.next(completion) < 0) {
+                    failed = true;
+                    break;
+                }
+                Request& request = *reinterpret_cast<Request*>(completion.user_data);
+                if (completion.res == -EINVAL || completion.res == -EOPNOTSUPP) {
+                    runDirect(request); // Kernel older than the opcode
+                } else if (completion.res < 0) {
+                    request.error = string(request.sync ? "Sync" : "Write") + " failed: " + strerror(-completion.res);
+                } else if (!request.sync && static_cast<size_t>(completion.res) < request.data.size()) {
+                    try {
+                        writeFully(request.fd, request.data, completion.res, request.offset);
+                    } catch (const exception& e) {
+                        request.error = e.what();
+                    }
+                }
+            }
+            if (failed) {
+                ringReady = false;
+                for (size_t i = first; i < requests.size(); ++i) {
+                    requests[i]->error.clear();
+                    runDirect(*requests[i]);
+                }
+                return;
+            }
+            first = last;
+        }
+    }
+#endif
+
+    // Runs one phase of a batch: every write, or one sync per file
+    void runPhase(vector<Request*>& requests) {
+#ifdef LMS_USE_IO_URING
+        if (ringReady) {
+            runOnRing(requests);
+            return;
+        }
+#endif
+        for (Request* request : requests) {
+            runDirect(*request);
+        }
+    }
+
+    void run() {
+        vector<Request> batch;
+        while (true) {
+            {
+                unique_lock<mutex> guard(lock);
+                queued.wait(guard, [this] { return !pending.empty(); });
+                batch.swap(pending);
+            }
+
+            vector<Request*> writes, syncs;
+            uint64_t bytes = 0;
+            for (auto& request : batch) {
+                if (!request.sync) {
+                    writes.push_back(&request);
+                    bytes += request.data.size();
+                } else if (none_of(syncs.begin(), syncs.end(), [&request](Request* sync) { return sync->fd == request.fd; })) {
+                    syncs.push_back(&request);
+                }
+            }
+
+            // Failures are recorded before the watermark moves, so no waiter can miss
+            // one. Merged sync requests share the outcome of the call made for their file.
+            runPhase(writes);
+            {
+                lock_guard<mutex> guard(lock);
+                recordFailures(writes);
+                writtenThrough = batch.back().ticket;
+            }
+            completed.notify_all();
+
+            runPhase(syncs);
+            {
+                lock_guard<mutex> guard(lock);
+                recordFailures(syncs);
+                syncedThrough = batch.back().ticket;
+                ++counters.batches;
+                counters.writes += writes.size();
+                counters.bytes += bytes;
+                counters.syncRequests += batch.size() - writes.size();
+                counters.syncs += syncs.size();
+            }
+            completed.notify_all();
+            batch.clear();
+        }
+    }
+
+    // Caller holds the lock
+    void recordFailures(const vector<Request*>& requests) {
+        for (const Request* request : requests) {
+            if (!request->error.empty()) {
+                fileErrors.try_emplace(request->fd, request->ticket, request->error);
+            }
+        }
+    }
+
+    Ticket enqueue(Request request) {
+        Ticket ticket;
+        {
+            lock_guard<mutex> guard(lock);
+            ticket = request.ticket = nextTicket++;
+            pending.push_back(move(request));
+        }
+        queued.notify_one();
+        return ticket;
+    }
+
+    AsyncIo() {
+#ifdef LMS_USE_IO_URING
+        ringReady = ring.open(RING_ENTRIES);
+#endif
+        worker = thread(&AsyncIo::run, this);
+        worker.detach();
+    }
+
+public:
+    // Never destroyed, so logs can still drain through it during static destruction
+    static AsyncIo& shared() {
+        static AsyncIo* io = new AsyncIo();
+        return *io;
+    }
+
+    const char* backend() const {
+#ifdef LMS_USE_IO_URING
+        if (ringReady) {
+            return "io_uring";
+        }
+#endif
+        return "pwrite thread";
+    }
+
+    Ticket write(int fd, string data, uint64_t offset) {
+        return enqueue(Request{0, fd, false, offset, move(data), string()});
+    }
+
+    // Completes after every write queued before it
+    Ticket sync(int fd) {
+        return enqueue(Request{0, fd, true, 0, string(), string()});
+    }
+
+    // Blocks until the request on `fd` reaches the given durability, then throws
+    // if it or any earlier request on the file failed. Data is only on stable
+    // storage once a later sync of its file completes, so wait for Synced on the
+    // ticket of that sync request. Buffered returns at once; a failure of a
+    // request nobody waits for surfaces on the file's next sync or wait.
+    void wait(int fd, Ticket ticket, Durability durability) {
+        if (durability == Durability::Buffered) {
+            return;
+        }
+        unique_lock<mutex> guard(lock);
+        completed.wait(guard, [this, ticket, durability] {
+            return (durability == Durability::Written ? writtenThrough : syncedThrough) >= ticket;
+        });
+        auto failed = fileErrors.find(fd);
+        if (failed != fileErrors.end() && failed->second.first <= ticket) {
+            throw runtime_error(failed->second.second);
+        }
+    }
+
+    static int openFile(const string& path, bool truncate) {
+#ifdef _WIN32
+        int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : 0), _S_IREAD | _S_IWRITE);
+#else
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+#endif
+        if (fd < 0) {
+            throw runtime_error("Cannot open " + path + ": " + strerror(errno));
+        }
+        return fd;
+    }
+
+    // Call once nothing queued for the file is still outstanding
+    void closeFile(int fd) {
+        {
+            lock_guard<mutex> guard(lock);
+            fileErrors.erase(fd); // The descriptor number may be reused
+        }
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+
+    static void truncateFile(int fd, uint64_t size) {
+#ifdef _WIN32
+        int result = _chsize_s(fd, static_cast<long long>(size));
+#else
+        int result = ftruncate(fd, static_cast<off_t>(size));
+#endif
+        if (result != 0) {
+            throw runtime_error(string("Cannot truncate file: ") + strerror(errno));
+        }
+    }
+
+    // Replaces the file's contents. Waits at least until the data is written,
+    // since the file is closed afterwards.
+    void writeFile(const string& path, string data, Durability durability = Durability::Synced) {
+        int fd = openFile(path, true);
+        Ticket ticket = write(fd, move(data), 0);
+        if (durability == Durability::Synced) {
+            ticket = sync(fd);
+        }
+        try {
+            wait(fd, ticket, durability == Durability::Synced ? Durability::Synced : Durability::Written);
+        } catch (...) {
+            closeFile(fd);
+            throw;
+        }
+        closeFile(fd);
+    }
+
+    Stats stats() {
+        lock_guard<mutex> guard(lock);
+        return counters;
+    }
+};
+
+// Write-ahead log of every change to accounts, courses, enrollments and grades.
+// Records stay in memory so replication followers can be streamed the full history.
+// An attached file gets every new record appended through the I/O thread; the
+// change returns once the record reaches the log's durability level.
+class MutationLog {
+private:
+    vector<string> records;
+    uint64_t nextSequence = 1;
+    bool applying = false; // Set while replaying records so they are not logged twice
+    mutable mutex lock;
+    condition_variable appended;
+
+    int file = -1;
+    uint64_t fileSize = 0;                    // Offset of the next record
+    uint64_t restoredBytes = 0;               // Length of the snapshot prefix the records came from
+    AsyncIo::Ticket lastWrite = 0;
+    Durability durability = Durability::Written;
+
+public:
+    ~MutationLog() {
+        if (file >= 0) {
+            try {
+                AsyncIo::shared().wait(file, lastWrite, Durability::Written);
+            } catch (const exception& e) {
+                cerr << "Mutation log: " << e.what() << endl;
+            }
+            AsyncIo::shared().closeFile(file);
+        }
+    }
+
+    void append(const string& operation, const vector<string>& fields) {
+        if (applying) {
+            return;
+        }
+        LogRecord record;
+        record.timestampMicros = wallClockMicros();
+        record.operation = operation;
+        record.fields = fields;
+        AsyncIo::Ticket ticket = 0;
+        Durability level;
+        {
+            lock_guard<mutex> guard(lock);
+            record.sequence = nextSequence++;
+            records.push_back(record.serialize());
+            level = durability;
+            if (file >= 0) {
+                // Offsets follow sequence order, so the file never has a later record without an earlier one once synced
+                string line = records.back() + "\n";
+                uint64_t offset = fileSize;
+                fileSize += line.size();
+                ticket = lastWrite = AsyncIo::shared().write(file, move(line), offset);
+                if (level == Durability::Synced) {
+                    ticket = AsyncIo::shared().sync(file);
+                }
+            }
+        }
+        appended.notify_all();
+        if (ticket) {
+            AsyncIo::shared().wait(file, ticket, level);
+        }
+    }
+
+    // Appends every later record to the file, which must be the snapshot this
+    // log was loaded from, if any. Anything past the last record read back from
+    // it, such as a record torn by a crash, is cut off.
+    void attachFile(const string& path) {
+        lock_guard<mutex> guard(lock);
+        if (file >= 0) {
+            throw runtime_error("The mutation log already has a file");
+        }
+        uint64_t size = restoredBytes;
+        int fd = AsyncIo::openFile(path, false);
+        try {
+            AsyncIo::truncateFile(fd, size);
+        } catch (...) {
+            AsyncIo::shared().closeFile(fd);
+            throw;
+        }
+        file = fd;
+        fileSize = size;
+    }
+
+    void setDurability(Durability level) {
+        lock_guard<mutex> guard(lock);
+        durability = level;
+    }
+
+    enum class Wait {Record, Idle, Stopped};
+
+    // Waits up to `idle` for record `index`. Idle means every record appended
+    // before the call has an index below `index`.
+    Wait waitForRecord(size_t index, string& record, const atomic<bool>& stop, chrono::milliseconds idle) {
+        unique_lock<mutex> guard(lock);
+        if (index >= records.size() && !stop && idle.count() > 0) {
+            appended.wait_for(guard, idle);
+        }
+        if (index < records.size()) {
+            record = records[index];
+            return Wait::Record;
+        }
+        return stop ? Wait::Stopped : Wait::Idle;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> guard(lock);
+        return records.size();
+    }
+
+    void setApplying(bool value) { applying = value; }
+
+    // Writes every record, one per line, for a snapshot of the institution
+    void writeTo(ostream& out) const {
+        lock_guard<mutex> guard(lock);
+        for (const auto& record : records) {
+            out << record << "\n";
+        }
+    }
+
+    // Keeps a record read back from a snapshot, without appending a new one
+    void restore(const string& serialized, uint64_t sequence) {
+        {
+            lock_guard<mutex> guard(lock);
+            records.push_back(serialized);
+            nextSequence = max(nextSequence, sequence + 1);
+        }
+        appended.notify_all();
+    }
+
+    // Bytes of the snapshot read back, blank lines and line endings included,
+    // up to the end of its last complete record
+    void setRestoredBytes(uint64_t bytes) {
+        lock_guard<mutex> guard(lock);
+        restoredBytes = bytes;
+    }
+
+    void clear() {
+        lock_guard<mutex> guard(lock);
+        records.clear();
+        nextSequence = 1;
+        restoredBytes = 0;
+    }
+};
+
+// The mutation log of the institution bound to this thread (see Institution)
+MutationLog& mutationLog();
+
+// FNV-1a followed by a splitmix finalizer; shared by the probabilistic filters
+uint64_t hashString(string_view key) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// Blocked Bloom filter used as a prefilter for email lookups.
+// Every key lives inside a single 512-bit block, so a probe touches one cache line.
+class BloomFilter {
+private:
+    struct Block {
+        uint64_t words[8];
+    };
+
+    static const int BITS_PER_KEY = 10;
+    static const int HASHES = 6;
+
+    vector<Block> blocks;
+    size_t capacity = 0;
+    size_t count = 0;
+
+public:
+    explicit BloomFilter(size_t expectedKeys = 1024) { reset(expectedKeys); }
+
+    void reset(size_t expectedKeys) {
+        capacity = expectedKeys < 64 ? 64 : expectedKeys;
+        size_t blockCount = (capacity * BITS_PER_KEY + 511) / 512;
+        blocks.assign(blockCount, Block{});
+        count = 0;
+    }
+
+    void add(const string& key) {
+        uint64_t h = hashString(key);
+        Block& block = blocks[h % blocks.size()];
+        // Each 9-bit slice of a remixed hash picks one bit inside the block
+        uint64_t bits = ((h << 32) | (h >> 32)) * 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < HASHES; ++i) {
+            uint32_t bit = (bits >> (i * 9)) & 511;
+            block.words[bit >> 6] |= 1ULL << (bit & 63);
+        }
+        ++count;
+    }
+
+    bool mightContain(const string& key) const {
+        uint64_t h = hashString(key);
+        const Block& block = blocks[h % blocks.size()];
+        uint64_t bits = ((h << 32) | (h >> 32)) * 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < HASHES; ++i) {
+            uint32_t bit = (bits >> (i * 9)) & 511;
+            if (!(block.words[bit >> 6] & (1ULL << (bit & 63)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool isOverloaded() const { return count > capacity; }
+    size_t size() const { return count; }
+};
+
+// Counters for the email prefilter, shown in import summaries and reports
+struct UserLookupStats {
+    size_t checks = 0;          // total existence checks
+    size_t prefilterMisses = 0; // rejected by the Bloom filter without a probe
+    size_t probes = 0;          // checks that had to scan the user list
+    size_t falsePositives = 0;  // probes that found nothing
+
+    double prefilterHitRate() const {
+        return checks == 0 ? 0.0 : 100.0 * prefilterMisses / checks;
+    }
+};
+
+// Email prefilter and its counters of the institution bound to this thread
+BloomFilter& userEmailFilter();
+UserLookupStats& userLookupStats();
+
+void displayUserLookupStats(ostream& out = cout) {
+    out << "Email prefilter: " << userLookupStats().checks << " checks, "
+         << userLookupStats().prefilterMisses << " skipped by filter ("
+         << userLookupStats().prefilterHitRate() << "%), "
+         << userLookupStats().probes << " probes, "
+         << userLookupStats().falsePositives << " false positives\n";
+}
+
+// Count-min sketch whose counts halve every `halfLife` seconds. Instead of
+// touching every counter as time passes, new events are added with weight
+// 2^(t / halfLife) and estimates are divided by the current weight; counters
+// are rescaled only when that weight grows large. Updates are conservative:
+// an event raises a key's counters only as far as its new estimate, so keys
+// sharing a counter inflate each other far less than with plain increments.
+// Memory is fixed at DEPTH x width counters however many keys are seen, so the
+// width has to be chosen for the expected number of recent events: see load().
+class DecayingCountMinSketch {
+private:
+    static const size_t DEPTH = 4;
+
+    size_t width;
+    vector<double> counters;
+    double total = 0.0; // Sum of all counters
+    double halfLife;
+    double epoch = 0.0; // Time at which weights were last 1
+
+    double weightAt(double now) const { return exp2((now - epoch) / halfLife); }
+
+    size_t slot(uint64_t h, size_t row) const {
+        // Double hashing gives each row an independent column
+        uint64_t mixed = h + row * ((h >> 32) | 1);
+        return row * width + mixed % width;
+    }
+
+    double estimateWeighted(uint64_t h) const {
+        double smallest = counters[slot(h, 0)];
+        for (size_t row = 1; row < DEPTH; ++row) {
+            smallest = min(smallest, counters[slot(h, row)]);
+        }
+        return smallest;
+    }
+
+public:
+    explicit DecayingCountMinSketch(double halfLifeSeconds, size_t width = 4096)
+        : width(max<size_t>(width, 2)), counters(DEPTH * this->width, 0.0), halfLife(halfLifeSeconds) {}
+
+    void add(const string& key, double now) {
+        double weight = weightAt(now);
+        if (weight > 1e64) {
+            for (double& counter : counters) {
+                counter /= weight;
+            }
+            total /= weight;
+            epoch = now;
+            weight = 1.0;
+        }
+        uint64_t h = hashString(key);
+        double raised = estimateWeighted(h) + weight;
+        for (size_t row = 0; row < DEPTH; ++row) {
+            double& counter = counters[slot(h, row)];
+            if (counter < raised) {
+                total += raised - counter;
+                counter = raised;
+            }
+        }
+    }
+
+    // Never underestimates; collisions can only inflate the count
+    double estimate(const string& key, double now) const {
+        return estimateWeighted(hashString(key)) / weightAt(now);
+    }
+
+    // Mean recent count per counter. A key never seen is estimated at about
+    // this much from collisions, so it has to stay well below any limit checked
+    // against.
+    double load(double now) const { return total / weightAt(now) / counters.size(); }
+
+    double getHalfLife() const { return halfLife; }
+    size_t memoryBytes() const { return counters.size() * sizeof(double); }
+
+    void clear() {
+        fill(counters.begin(), counters.end(), 0.0);
+        total = 0.0;
+        epoch = 0.0;
+    }
+};
+
+// Failed-login throttling per email and per source (session origin). A login
+// is refused before the password is checked once either recent-failure
+// estimate reaches its limit. The email sketch is sized for a credential-
+// stuffing rate of about 50,000 failures per half-life. Estimates only ever
+// err high, so a flood beyond that can refuse accounts it never touched, but
+// it can never hide the failures against a targeted one; checks made while a
+// sketch is saturated are counted so the flood shows up in the stats.
+class LoginThrottle {
+private:
+    static constexpr double HALF_LIFE_SECONDS = 60.0;
+    static constexpr double EMAIL_LIMIT = 5.0;    // Failures against one account
+    static constexpr double SOURCE_LIMIT = 20.0;  // Failures from one source, any account
+    static constexpr size_t EMAIL_SKETCH_WIDTH = 32768;  // About 1.5 failures per counter at the expected rate
+
+    DecayingCountMinSketch emailFailures{HALF_LIFE_SECONDS, EMAIL_SKETCH_WIDTH};
+    DecayingCountMinSketch sourceFailures{HALF_LIFE_SECONDS};
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    double now() const { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+
+    // Seconds until `count` decays enough to allow another attempt. The half
+    // step of slack keeps a burst of exactly `limit` failures counted as such.
+    static double waitFor(double count, double limit) {
+        double allowed = limit - 0.5;
+        return count < allowed ? 0.0 : HALF_LIFE_SECONDS * log2(count / allowed) + 1.0;
+    }
+
+    double waitFor(const DecayingCountMinSketch& sketch, const string& key, double limit, double t) {
+        if (sketch.load(t) >= limit / 2) {
+            ++saturatedChecks; // Keys never seen may be refused until the flood decays
+        }
+        return waitFor(sketch.estimate(key, t), limit);
+    }
+
+public:
+    size_t failures = 0;
+    size_t blocked = 0;
+    size_t saturatedChecks = 0; // Checks made while their sketch was saturated
+
+    // Returns 0 if the attempt may proceed, otherwise the seconds to wait
+    double retryAfter(const string& email, const string& source) {
+        double t = now();
+        double wait = max(waitFor(emailFailures, email, EMAIL_LIMIT, t),
+                          waitFor(sourceFailures, source, SOURCE_LIMIT, t));
+        if (wait > 0.0) {
+            ++blocked;
+        }
+        return wait;
+    }
+
+    void recordFailure(const string& email, const string& source) {
+        double t = now();
+        emailFailures.add(email, t);
+        sourceFailures.add(source, t);
+        ++failures;
+    }
+
+    void clear() {
+        emailFailures.clear();
+        sourceFailures.clear();
+        start = chrono::steady_clock::now();
+        failures = blocked = saturatedChecks = 0;
+    }
+
+    size_t memoryBytes() const { return emailFailures.memoryBytes() + sourceFailures.memoryBytes(); }
+};
+
+LoginThrottle& loginThrottle();
+
+// Forward declarations
+class Course;
+class LMSManager;
+class ThreadPool;
+
+// Admin class
+class Admin : public User {
+public:
+     Admin(string username, string email, string passwordHash)
+        : User(username, email, passwordHash) {}
+
+    static constexpr const char* ROLE = "admin";
+    string getRole() const { return ROLE; }
+    Task<> manageCourses(Session& session);
+    Task<> addCourse(Session& session);
+    Task<> deleteCourse(Session& session);
+    Task<> editCourse(Session& session);
+    Task<> viewReports(Session& session);
+    Task<> enrollStudent(Session& session);    
+    Task<> removeStudent(Session& session);   
+    Task<> importStudents(Session& session);
+    Task<> setPrerequisites(Session& session);
+    Task<> editSchedule(Session& session, Course& course);
+    Task<> viewTimetableConflicts(Session& session);
+    Task<> enrollmentQueries(Session& session);
+    Task<> viewLeaderboard(Session& session);
+    Task<> manageTerms(Session& session);
+    Task<> findAccounts(Session& session);
+    Task<> removeAccount(Session& session);
+};
+
+// Teacher class
+class Teacher : public User {
+public:
+    Teacher(string username, string email, string passwordHash)
+        : User(username, email, passwordHash) {}
+
+    static constexpr const char* ROLE = "teacher";
+    string getRole() const { return ROLE; }
+    Task<> manageCourses(Session& session);
+    Task<> viewCourse(Session& session);
+    Task<> viewReports(Session& session);
+    Task<> addGrade(Session& session); 
+    Task<> addContent(Session& session); 
+    Task<> viewAssignedStudents(Session& session);
+    Task<> curveGrades(Session& session);
+};
+
+// Student class
+class Student : public User {
+public:
+    Student(string username, string email, string passwordHash)
+        : User(username, email, passwordHash) {}
+
+    static constexpr const char* ROLE = "student";
+    string getRole() const { return ROLE; }
+    Task<> viewEnrolledCourses(Session& session);
+    Task<> viewGrades(Session& session);
+    Task<> enrollInCourse(Session& session);
+};
+
+
+// A logged-in account as a value; sessions hold one, the table holds the rest
+using UserRecord = variant<Admin, Teacher, Student>;
+
+const User& userFields(const UserRecord& user) {
+    return visit([](const auto& account) -> const User& { return account; }, user);
+}
+
+string roleOf(const UserRecord& user) {
+    return visit([](const auto& account) { return account.getRole(); }, user);
+}
+
+enum class Role : uint8_t { Admin, Teacher, Student, Removed };
+
+// What an action needs; each role is granted a fixed set of these
+enum Permission : uint32_t {
+    CourseAdministration = 1u << 0,
+    EnrollmentAdministration = 1u << 1,
+    AccountImport = 1u << 2,
+    InstitutionReports = 1u << 3,
+    CourseTeaching = 1u << 4,
+    Grading = 1u << 5,
+    OwnRecords = 1u << 6,
+    SelfEnrollment = 1u << 7
+};
+
+// Indexed by Role; removed accounts hold no permissions
+constexpr uint32_t ROLE_PERMISSIONS[] = {
+    CourseAdministration | EnrollmentAdministration | AccountImport | InstitutionReports,
+    CourseTeaching | Grading,
+    OwnRecords | SelfEnrollment,
+    0
+};
+constexpr const char* ROLE_TITLES[] = {"Admin", "Teacher", "Student", "Removed"};
+
+constexpr bool isPermitted(Role role, uint32_t required) {
+    return (ROLE_PERMISSIONS[static_cast<size_t>(role)] & required) == required;
+}
+
+// The variant's alternatives are declared in Role's order
+Role roleId(const UserRecord& user) {
+    return static_cast<Role>(user.index());
+}
+
+// Calls a screen member function on the account held in the record
+template <typename Method>
+struct ScreenOwner;
+
+template <typename Account>
+struct ScreenOwner<Task<> (Account::*)(Session&)> {
+    using type = Account;
+};
+
+template <auto Screen>
+Task<> callScreen(UserRecord& user, Session& session) {
+    using Account = typename ScreenOwner<decltype(Screen)>::type;
+    return (get<Account>(user).*Screen)(session);
+}
+
+// One entry per role and action. The interactive menus list a role's entries
+// in table order, while batch files and the command socket look them up by name;
+// all of them authorize against the same permission column.
+struct MenuAction {
+    Role role;
+    const char* name;  // Used by batch files and the command socket
+    const char* label; // Shown in the menu
+    uint32_t required;
+    Task<> (*handler)(UserRecord&, Session&);
+    bool pauseAfter;
+};
+
+constexpr MenuAction MENU_ACTIONS[] = {
+    {Role::Admin, "manage-courses", "Manage Courses", CourseAdministration, &callScreen<&Admin::manageCourses>, false},
+    {Role::Admin, "view-reports", "View Reports", InstitutionReports, &callScreen<&Admin::viewReports>, false},
+    {Role::Admin, "enroll-student", "Enroll Student", EnrollmentAdministration, &callScreen<&Admin::enrollStudent>, false},
+    {Role::Admin, "remove-student", "Remove Student", EnrollmentAdministration, &callScreen<&Admin::removeStudent>, true},
+    {Role::Admin, "import-students", "Import Students", AccountImport, &callScreen<&Admin::importStudents>, false},
+    {Role::Admin, "timetable-conflicts", "Timetable Conflicts", InstitutionReports, &callScreen<&Admin::viewTimetableConflicts>, false},
+    {Role::Admin, "enrollment-queries", "Enrollment Queries", InstitutionReports, &callScreen<&Admin::enrollmentQueries>, false},
+    {Role::Admin, "leaderboard", "Leaderboard", InstitutionReports, &callScreen<&Admin::viewLeaderboard>, false},
+    {Role::Admin, "terms", "Academic Terms", CourseAdministration, &callScreen<&Admin::manageTerms>, false},
+    {Role::Admin, "find-accounts", "Find Accounts", InstitutionReports, &callScreen<&Admin::findAccounts>, false},
+    {Role::Admin, "remove-account", "Remove Account", AccountImport, &callScreen<&Admin::removeAccount>, true},
+    {Role::Teacher, "manage-courses", "Manage Courses", CourseTeaching | Grading, &callScreen<&Teacher::manageCourses>, false},
+    {Role::Teacher, "view-reports", "View Reports", CourseTeaching, &callScreen<&Teacher::viewReports>, false},
+    {Role::Student, "view-courses", "View Enrolled Courses", OwnRecords, &callScreen<&Student::viewEnrolledCourses>, false},
+    {Role::Student, "view-grades", "View Grades", OwnRecords, &callScreen<&Student::viewGrades>, true},
+    {Role::Student, "enroll", "Enroll in Course", SelfEnrollment, &callScreen<&Student::enrollInCourse>, true},
+};
+
+// A role's entries are contiguous, so its menu is a slice of the table
+constexpr span<const MenuAction> actionsOf(Role role) {
+    size_t first = 0;
+    while (first < size(MENU_ACTIONS) && MENU_ACTIONS[first].role != role) {
+        ++first;
+    }
+    size_t last = first;
+    while (last < size(MENU_ACTIONS) && MENU_ACTIONS[last].role == role) {
+        ++last;
+    }
+    return span<const MenuAction>(MENU_ACTIONS).subspan(first, last - first);
+}
+
+constexpr bool actionsGroupedByRole() {
+    size_t grouped = 0;
+    for (Role role : {Role::Admin, Role::Teacher, Role::Student, Role::Removed}) {
+        grouped += actionsOf(role).size();
+    }
+    return grouped == size(MENU_ACTIONS);
+}
+static_assert(actionsGroupedByRole(), "MENU_ACTIONS must list each role's actions together");
+
+constexpr const MenuAction* findAction(Role role, string_view name) {
+    for (const MenuAction& action : actionsOf(role)) {
+        if (name == action.name) {
+            return &action;
+        }
+    }
+    return nullptr;
+}
+
+// Disk-resident B+tree from email to user ID, in fixed-size pages of one
+// file. Page 0 holds the root and counts; every other page is a leaf, sorted
+// and chained to its right sibling for range scans, or an internal node whose
+// keys separate its children. Pages are decoded into a fixed number of
+// buffer-pool frames and written back when evicted, so memory stays bounded
+// however many accounts there are, and a lookup reads at most one page per
+// level it misses in the pool. Deleting only removes the leaf entry; pages are
+// never merged.
+//
+// The file is spill space for pages that do not fit the pool, not a durable
+// copy: pages are written in place with no journal, so a crash can leave it
+// torn. It is therefore created empty every time it is opened and filled from
+// the accounts, which the mutation log makes durable.
+class EmailBTree {
+public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t MAX_KEY = Validator::MAX_EMAIL_LENGTH;
+
+    struct Stats {
+        uint64_t pageReads = 0;  // Pages read from the file
+        uint64_t pageWrites = 0; // Pages written back
+        uint64_t poolHits = 0;
+    };
+
+private:
+    static constexpr char MAGIC[8] = {'L', 'M', 'S', 'B', 'T', 'R', 'E', 'E'};
+    static constexpr size_t HEADER_BYTES = 8; // type, unused, count, link
+
+    struct Node {
+        bool leaf = true;
+        uint32_t link = 0;        // Leaf: right sibling (0 = none). Internal: unused.
+        vector<string> keys;
+        vector<uint32_t> values;  // Leaf: user IDs. Internal: children, one more than keys.
+
+        size_t bytes() const {
+            size_t total = HEADER_BYTES + (leaf ? 0 : 4);
+            for (const auto& key : keys) {
+                total += 1 + key.size() + 4;
+            }
+            return total;
+        }
+    };
+
+    struct Frame {
+        uint32_t page;
+        Node node;
+        bool dirty;
+    };
+
+    fstream file;
+    uint32_t root = 1;
+    uint32_t pageCount = 2;  // Meta page and the first leaf
+    uint64_t entryCount = 0;
+    uint32_t height = 1;
+    size_t poolCapacity;
+    list<Frame> frames;      // Most recently used first
+    unordered_map<uint32_t, list<Frame>::iterator> framesByPage;
+    Stats counters;
+
+    static void putU32(char* out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<char>(value >> (8 * i));
+        }
+    }
+
+    static uint32_t getU32(const char* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    void writePage(uint32_t page, const Node& node) {
+        char buffer[PAGE_SIZE] = {};
+        buffer[0] = node.leaf ? 1 : 2;
+        buffer[2] = static_cast<char>(node.keys.size());
+        buffer[3] = static_cast<char>(node.keys.size() >> 8);
+        putU32(buffer + 4, node.link);
+        size_t pos = HEADER_BYTES;
+        if (!node.leaf) {
+            putU32(buffer + pos, node.values[0]);
+            pos += 4;
+        }
+        for (size_t i = 0; i < node.keys.size(); ++i) {
+            buffer[pos++] = static_cast<char>(node.keys[i].size());
+            memcpy(buffer + pos, node.keys[i].data(), node.keys[i].size());
+            pos += node.keys[i].size();
+            putU32(buffer + pos, node.values[node.leaf ? i : i + 1]);
+            pos += 4;
+        }
+        file.seekp(static_cast<streamoff>(page) * PAGE_SIZE);
+        file.write(buffer, PAGE_SIZE);
+        ++counters.pageWrites;
+    }
+
+    Node readPage(uint32_t page) {
+        char buffer[PAGE_SIZE];
+        file.seekg(static_cast<streamoff>(page) * PAGE_SIZE);
+        if (!file.read(buffer, PAGE_SIZE)) {
+            throw runtime_error("Cannot read index page " + to_string(page));
+        }
+        ++counters.pageReads;
+        Node node;
+        node.leaf = buffer[0] == 1;
+        size_t count = static_cast<uint8_t>(buffer[2]) | static_cast<uint8_t>(buffer[3]) << 8;
+        node.link = getU32(buffer + 4);
+        size_t pos = HEADER_BYTES;
+        if (!node.leaf) {
+            node.values.push_back(getU32(buffer + pos));
+            pos += 4;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t length = static_cast<uint8_t>(buffer[pos++]);
+            node.keys.emplace_back(buffer + pos, length);
+            pos += length;
+            node.values.push_back(getU32(buffer + pos));
+            pos += 4;
+        }
+        return node;
+    }
+
+    // Puts a page in the pool, writing back the least recently used frame if the pool is full
+    Frame& admit(uint32_t page, Node node, bool dirty) {
+        if (frames.size() >= poolCapacity) {
+            Frame& victim = frames.back();
+            if (victim.dirty) {
+                writePage(victim.page, victim.node);
+            }
+            framesByPage.erase(victim.page);
+            frames.pop_back();
+        }
+        frames.push_front(Frame{page, move(node), dirty});
+        framesByPage[page] = frames.begin();
+        return frames.front();
+    }
+
+    Frame& frame(uint32_t page) {
+        auto cached = framesByPage.find(page);
+        if (cached != framesByPage.end()) {
+            ++counters.poolHits;
+            frames.splice(frames.begin(), frames, cached->second);
+            return frames.front();
+        }
+        return admit(page, readPage(page), false);
+    }
+
+    // New pages reach the file when their frame is written back
+    uint32_t allocate(Node node) {
+        uint32_t page = pageCount++;
+        admit(page, move(node), true);
+        return page;
+    }
+
+    // Moves the upper half of an overfull node into a new page; returns its first key and page
+    pair<string, uint32_t> split(Node& node) {
+        size_t half = node.bytes() / 2, used = HEADER_BYTES, at = 0;
+        while (at + 1 < node.keys.size() && used < half) {
+            used += 1 + node.keys[at].size() + 4;
+            ++at;
+        }
+        Node right;
+        right.leaf = node.leaf;
+        string separator = node.keys[at];
+        if (node.leaf) {
+            right.keys.assign(node.keys.begin() + at, node.keys.end());
+            right.values.assign(node.values.begin() + at, node.values.end());
+            right.link = node.link;
+            node.keys.resize(at);
+            node.values.resize(at);
+        } else {
+            // The separator moves up; its right child starts the new node
+            right.keys.assign(node.keys.begin() + at + 1, node.keys.end());
+            right.values.assign(node.values.begin() + at + 1, node.values.end());
+            node.keys.resize(at);
+            node.values.resize(at + 1);
+        }
+        uint32_t rightPage = allocate(move(right));
+        if (node.leaf) {
+            node.link = rightPage;
+        }
+        return {separator, rightPage};
+    }
+
+    // Inserts below `page`; returns the separator and page of a new right sibling if it split.
+    // Frames are edited in place: the one being edited was just used, so admitting
+    // a page never evicts it, but recursing into the children might.
+    optional<pair<string, uint32_t>> insertBelow(uint32_t page, const string& email, uint32_t id) {
+        Frame* current = &frame(page);
+        size_t slot = upper_bound(current->node.keys.begin(), current->node.keys.end(), email) -
+                      current->node.keys.begin();
+        if (current->node.leaf) {
+            Node& leaf = current->node;
+            current->dirty = true;
+            if (slot > 0 && leaf.keys[slot - 1] == email) {
+                leaf.values[slot - 1] = id;
+                return nullopt;
+            }
+            leaf.keys.insert(leaf.keys.begin() + slot, email);
+            leaf.values.insert(leaf.values.begin() + slot, id);
+            ++entryCount;
+        } else {
+            auto grown = insertBelow(current->node.values[slot], email, id);
+            if (!grown) {
+                return nullopt;
+            }
+            current = &frame(page);
+            current->dirty = true;
+            current->node.keys.insert(current->node.keys.begin() + slot, grown->first);
+            current->node.values.insert(current->node.values.begin() + slot + 1, grown->second);
+        }
+        if (current->node.bytes() > PAGE_SIZE) {
+            return split(current->node);
+        }
+        return nullopt;
+    }
+
+    // Leaf page that would hold the key
+    uint32_t leafFor(const string& email) {
+        uint32_t page = root;
+        while (true) {
+            const Node& node = frame(page).node;
+            if (node.leaf) {
+                return page;
+            }
+            page = node.values[upper_bound(node.keys.begin(), node.keys.end(), email) - node.keys.begin()];
+        }
+    }
+
+    void writeMeta() {
+        char buffer[PAGE_SIZE] = {};
+        memcpy(buffer, MAGIC, sizeof(MAGIC));
+        putU32(buffer + 8, root);
+        putU32(buffer + 12, pageCount);
+        putU32(buffer + 16, static_cast<uint32_t>(entryCount));
+        putU32(buffer + 20, static_cast<uint32_t>(entryCount >> 32));
+        putU32(buffer + 24, height);
+        file.seekp(0);
+        file.write(buffer, PAGE_SIZE);
+    }
+
+public:
+    // Creates the index file, replacing whatever was there, holding an empty tree
+    explicit EmailBTree(const string& path, size_t poolPages = 256)
+        : file(path, ios::in | ios::out | ios::binary | ios::trunc), poolCapacity(max<size_t>(poolPages, 4)) {
+        if (!file) {
+            throw runtime_error("Cannot create email index: " + path);
+        }
+        writeMeta();
+        writePage(root, Node());
+    }
+
+    EmailBTree(const EmailBTree&) = delete;
+    EmailBTree& operator=(const EmailBTree&) = delete;
+
+    // Writes every dirty page and the meta page
+    void flush() {
+        for (auto& cached : frames) {
+            if (cached.dirty) {
+                writePage(cached.page, cached.node);
+                cached.dirty = false;
+            }
+        }
+        writeMeta();
+        file.flush();
+        if (!file) {
+            throw runtime_error("Cannot write the email index");
+        }
+    }
+
+    optional<uint32_t> find(const string& email) {
+        const Node& leaf = frame(leafFor(email)).node;
+        auto found = lower_bound(leaf.keys.begin(), leaf.keys.end(), email);
+        if (found == leaf.keys.end() || *found != email) {
+            return nullopt;
+        }
+        return leaf.values[found - leaf.keys.begin()];
+    }
+
+    void insert(const string& email, uint32_t id) {
+        if (email.size() > MAX_KEY) {
+            throw ValidationException("Email is too long for the index");
+        }
+        auto grown = insertBelow(root, email, id);
+        if (grown) {
+            Node newRoot;
+            newRoot.leaf = false;
+            newRoot.keys = {grown->first};
+            newRoot.values = {root, grown->second};
+            root = allocate(move(newRoot));
+            ++height;
+        }
+    }
+
+    bool erase(const string& email) {
+        Frame& target = frame(leafFor(email));
+        Node& leaf = target.node;
+        auto found = lower_bound(leaf.keys.begin(), leaf.keys.end(), email);
+        if (found == leaf.keys.end() || *found != email) {
+            return false;
+        }
+        size_t slot = found - leaf.keys.begin();
+        leaf.keys.erase(leaf.keys.begin() + slot);
+        leaf.values.erase(leaf.values.begin() + slot);
+        target.dirty = true;
+        --entryCount;
+        return true;
+    }
+
+    // Calls fn(email, id) in email order for up to `limit` emails starting with the prefix
+    template <typename Fn>
+    size_t scanPrefix(const string& prefix, size_t limit, Fn fn) {
+        size_t visited = 0;
+        uint32_t page = leafFor(prefix);
+        while (page != 0 && visited < limit) {
+            const Node& leaf = frame(page).node;
+            for (size_t i = lower_bound(leaf.keys.begin(), leaf.keys.end(), prefix) - leaf.keys.begin();
+                 i < leaf.keys.size(); ++i) {
+                if (leaf.keys[i].compare(0, prefix.size(), prefix) != 0 || visited == limit) {
+                    return visited;
+                }
+                fn(leaf.keys[i], leaf.values[i]);
+                ++visited;
+            }
+            page = leaf.link;
+        }
+        return visited;
+    }
+
+    // Empties the buffer pool so the next lookups start cold
+    void dropCache() {
+        flush();
+        frames.clear();
+        framesByPage.clear();
+    }
+
+    uint64_t size() const { return entryCount; }
+    uint32_t levels() const { return height; }
+    uint64_t fileBytes() const { return static_cast<uint64_t>(pageCount) * PAGE_SIZE; }
+    size_t poolBytes() const { return poolCapacity * PAGE_SIZE; }
+    const Stats& stats() const { return counters; }
+};
+
+// Every account as parallel columns addressed by a dense user ID: emails and
+// usernames packed into shared byte pools with offset columns, fixed-width
+// credentials and a one-byte role. Lookups by email go through an
+// open-addressing index of IDs, or through an EmailBTree file in its place
+// when one is attached, so the index no longer takes memory per account.
+// A session materializes a UserRecord value
+// from a row when it logs in. Removed accounts keep their ID with the
+// Removed role. Views returned by email()/username() are invalidated by add().
+class UserTable {
+private:
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t TOMBSTONE = UINT32_MAX;
+
+    vector<char> emailPool;
+    vector<char> usernamePool;
+    vector<uint32_t> emailOffsets{0};     // Row i spans [offsets[i], offsets[i + 1])
+    vector<uint32_t> usernameOffsets{0};
+    vector<PasswordHasher::Credential> credentials;
+    vector<Role> roles;
+    vector<uint32_t> slots;               // ID + 1, EMPTY or TOMBSTONE; empty while diskIndex is set
+    size_t liveCount = 0;
+    size_t usedSlots = 0;                 // Live entries plus tombstones
+    EmailBTree* diskIndex = nullptr;      // Owned by the institution
+
+    static string_view column(const vector<char>& pool, const vector<uint32_t>& offsets, uint32_t id) {
+        return string_view(pool.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    static void append(vector<char>& pool, vector<uint32_t>& offsets, string_view text) {
+        pool.insert(pool.end(), text.begin(), text.end());
+        offsets.push_back(static_cast<uint32_t>(pool.size()));
+    }
+
+    // Slot holding the email, or the empty slot where it would go
+    size_t probe(string_view email) const {
+        size_t mask = slots.size() - 1;
+        size_t reusable = SIZE_MAX;
+        for (size_t slot = hashString(email) & mask;; slot = (slot + 1) & mask) {
+            if (slots[slot] == EMPTY) {
+                return reusable == SIZE_MAX ? slot : reusable;
+            }
+            if (slots[slot] == TOMBSTONE) {
+                reusable = min(reusable, slot);
+            } else if (this->email(slots[slot] - 1) == email) {
+                return slot;
+            }
+        }
+    }
+
+    void rehash(size_t slotCount) {
+        if (diskIndex) {
+            return;
+        }
+        slots.assign(slotCount, EMPTY);
+        usedSlots = 0;
+        for (uint32_t id = 0; id < roles.size(); ++id) {
+            if (roles[id] != Role::Removed) {
+                slots[probe(email(id))] = id + 1;
+                ++usedSlots;
+            }
+        }
+    }
+
+public:
+    UserTable() { rehash(64); }
+
+    static Role roleFromName(const string& name) {
+        if (name == Admin::ROLE) return Role::Admin;
+        if (name == Teacher::ROLE) return Role::Teacher;
+        if (name == Student::ROLE) return Role::Student;
+        throw ValidationException("Unknown role: " + name);
+    }
+
+    uint32_t add(const UserRecord& user) {
+        const User& fields = userFields(user);
+        if (fields.getEmail().size() > Validator::MAX_EMAIL_LENGTH) {
+            throw ValidationException("Email is too long");
+        }
+        if (find(fields.getEmail())) {
+            throw ValidationException("A user with this email already exists");
+        }
+        PasswordHasher::Credential credential;
+        if (!PasswordHasher::pack(fields.getPasswordHash(), credential)) {
+            throw ValidationException("Invalid password hash");
+        }
+        Role role = roleFromName(roleOf(user));
+        uint32_t id = static_cast<uint32_t>(roles.size());
+        if (diskIndex) {
+            diskIndex->insert(fields.getEmail(), id);
+        } else if ((usedSlots + 1) * 2 > slots.size()) {
+            rehash(liveCount * 2 + 1 > slots.size() / 2 ? slots.size() * 2 : slots.size());
+        }
+        append(emailPool, emailOffsets, fields.getEmail());
+        append(usernamePool, usernameOffsets, fields.getUsername());
+        credentials.push_back(credential);
+        roles.push_back(role);
+        if (!diskIndex) {
+            size_t slot = probe(fields.getEmail());
+            usedSlots += slots[slot] == EMPTY;
+            slots[slot] = id + 1;
+        }
+        ++liveCount;
+        return id;
+    }
+
+    void remove(uint32_t id) {
+        if (diskIndex) {
+            diskIndex->erase(string(email(id)));
+        } else {
+            slots[probe(email(id))] = TOMBSTONE;
+        }
+        roles[id] = Role::Removed;
+        --liveCount;
+    }
+
+    optional<uint32_t> find(string_view email) const {
+        if (diskIndex) {
+            return diskIndex->find(string(email));
+        }
+        uint32_t entry = slots[probe(email)];
+        return entry == EMPTY || entry == TOMBSTONE ? nullopt : optional<uint32_t>(entry - 1);
+    }
+
+    // Builds the value a session works with
+    UserRecord load(uint32_t id) const {
+        string username(this->username(id)), email(this->email(id));
+        string hash = PasswordHasher::unpack(credentials[id]);
+        switch (roles[id]) {
+            case Role::Admin: return Admin(username, email, hash);
+            case Role::Teacher: return Teacher(username, email, hash);
+            case Role::Student: return Student(username, email, hash);
+            case Role::Removed: break;
+        }
+        throw ValidationException("User not found");
+    }
+
+    // Calls fn(id) for every account with the role, scanning only the role column
+    template <typename Fn>
+    void forEachWithRole(Role role, Fn fn) const {
+        for (uint32_t id = 0; id < roles.size(); ++id) {
+            if (roles[id] == role) {
+                fn(id);
+            }
+        }
+    }
+
+    size_t countWithRole(Role role) const { return count(roles.begin(), roles.end(), role); }
+
+    Role role(uint32_t id) const { return roles[id]; }
+    string_view email(uint32_t id) const { return column(emailPool, emailOffsets, id); }
+    string_view username(uint32_t id) const { return column(usernamePool, usernameOffsets, id); }
+    const PasswordHasher::Credential& credential(uint32_t id) const { return credentials[id]; }
+    uint32_t idLimit() const { return static_cast<uint32_t>(roles.size()); }
+    size_t size() const { return liveCount; }
+
+    // Heap bytes held by the columns and the index
+    size_t memoryUsage() const {
+        return emailPool.capacity() + usernamePool.capacity() +
+               (emailOffsets.capacity() + usernameOffsets.capacity() + slots.capacity()) * sizeof(uint32_t) +
+               credentials.capacity() * sizeof(PasswordHasher::Credential) +
+               roles.capacity() * sizeof(Role);
+    }
+
+    // Moves email lookups to `index`, filling it from the live accounts, and
+    // frees the in-memory slots; null moves them back to the slots
+    void useIndex(EmailBTree* index) {
+        diskIndex = index;
+        if (!index) {
+            size_t slotCount = 64;
+            while (slotCount < liveCount * 2 + 2) {
+                slotCount *= 2;
+            }
+            rehash(slotCount);
+            return;
+        }
+        for (uint32_t id = 0; id < roles.size(); ++id) {
+            if (roles[id] != Role::Removed) {
+                index->insert(string(email(id)), id);
+            }
+        }
+        vector<uint32_t>().swap(slots);
+        usedSlots = 0;
+    }
+
+    // Drops every account. An attached index is left to its owner, which truncates it.
+    void clear() {
+        emailPool.clear();
+        usernamePool.clear();
+        emailOffsets.assign(1, 0);
+        usernameOffsets.assign(1, 0);
+        credentials.clear();
+        roles.clear();
+        liveCount = 0;
+        rehash(64);
+    }
+};
+
+// Accounts of the institution bound to this thread
+UserTable& users();
+
+// Email index of the institution bound to this thread, or null when the
+// institution keeps no index file
+EmailBTree* userEmailIndex();
+
+void rebuildUserEmailFilter() {
+    userEmailFilter().reset(users().size() * 2);
+    for (uint32_t id = 0; id < users().idLimit(); ++id) {
+        if (users().role(id) != Role::Removed) {
+            userEmailFilter().add(string(users().email(id)));
+        }
+    }
+}
+
+optional<uint32_t> findUserByEmail(const string& email) {
+    ++userLookupStats().checks;
+    if (!userEmailFilter().mightContain(email)) {
+        ++userLookupStats().prefilterMisses; // Definitely not registered
+        return nullopt;
+    }
+
+    ++userLookupStats().probes;
+    optional<uint32_t> id = users().find(email);
+    if (!id) {
+        ++userLookupStats().falsePositives;
+    }
+    return id;
+}
+
+// Keeps the enrollment-query universe in step with the student accounts
+void registerStudentAccount(const string& email, bool registered);
+
+void addUser(const UserRecord& user) {
+    const User& fields = userFields(user);
+    users().add(user);
+    if (holds_alternative<Student>(user)) {
+        registerStudentAccount(fields.getEmail(), true);
+    }
+    mutationLog().append("ADD_USER", {roleOf(user), fields.getUsername(), fields.getEmail(), fields.getPasswordHash()});
+    userEmailFilter().add(fields.getEmail());
+    if (userEmailFilter().isOverloaded()) {
+        rebuildUserEmailFilter(); // Keep the false positive rate bounded as the list grows
+    }
+}
+
+void removeUser(const string& email) {
+    optional<uint32_t> id = users().find(email);
+    if (!id) {
+        throw ValidationException("User not found");
+    }
+    if (users().role(*id) == Role::Student) {
+        registerStudentAccount(email, false);
+    }
+    users().remove(*id);
+    mutationLog().append("REMOVE_USER", {email});
+    rebuildUserEmailFilter(); // Bloom filters cannot delete, so start over
+}
+
+// One weekly meeting of a course, in minutes from midnight
+struct TimeSlot {
+    int day = 0;          // 0 = Monday ... 6 = Sunday
+    int startMinute = 0;
+    int endMinute = 0;
+
+    static const int MINUTES_PER_DAY = 24 * 60;
+
+    TimeSlot() = default;
+    TimeSlot(int day, int startMinute, int endMinute)
+        : day(day), startMinute(startMinute), endMinute(endMinute) {
+        if (day < 0 || day > 6 || startMinute < 0 || endMinute > MINUTES_PER_DAY ||
+            startMinute >= endMinute) {
+            throw ValidationException("Invalid time slot");
+        }
+    }
+
+    // Minutes since Monday 00:00, so slots compare across the whole week
+    int weekStart() const { return day * MINUTES_PER_DAY + startMinute; }
+    int weekEnd() const { return day * MINUTES_PER_DAY + endMinute; }
+
+    // Parses "HH:MM"; returns -1 when the text is not a valid time of day
+    static int parseClock(const string& text) {
+        size_t colon = text.find(':');
+        if (colon == string::npos || colon == 0 || colon + 3 != text.size()) {
+            return -1;
+        }
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (i != colon && !isdigit(static_cast<unsigned char>(text[i]))) {
+                return -1;
+            }
+        }
+        int hours = stoi(text.substr(0, colon));
+        int minutes = stoi(text.substr(colon + 1));
+        if (hours > 24 || minutes > 59 || (hours == 24 && minutes != 0)) {
+            return -1;
+        }
+        return hours * 60 + minutes;
+    }
+
+    string toString() const {
+        static const char* dayNames[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+        char text[32];
+        snprintf(text, sizeof(text), "%s %02d:%02d-%02d:%02d", dayNames[day],
+                 startMinute / 60, startMinute % 60, endMinute / 60, endMinute % 60);
+        return text;
+    }
+};
+
+// Course class
+// A bulk change to every grade of a course. All four kinds reduce to
+// clamp(multiplier * x + offset, low, high), with x = sqrt(grade) for the curve.
+struct GradeTransform {
+    enum class Kind { Offset, Scale, SquareRoot, Clamp };
+
+    Kind kind = Kind::Offset;
+    double first = 0.0;   // Offset amount, scale factor, or lower bound
+    double second = 0.0;  // Scale shift or upper bound
+
+    static const char* kindName(Kind kind) {
+        switch (kind) {
+            case Kind::Offset: return "offset";
+            case Kind::Scale: return "scale";
+            case Kind::SquareRoot: return "sqrt";
+            case Kind::Clamp: return "clamp";
+        }
+        return "";
+    }
+
+    static Kind parseKind(const string& name) {
+        for (Kind kind : {Kind::Offset, Kind::Scale, Kind::SquareRoot, Kind::Clamp}) {
+            if (name == kindName(kind)) {
+                return kind;
+            }
+        }
+        throw runtime_error("Unknown grade transform: " + name);
+    }
+
+    string describe() const {
+        ostringstream text;
+        switch (kind) {
+            case Kind::Offset: text << (first >= 0 ? "+" : "") << first << " points"; break;
+            case Kind::Scale: text << "x" << first << (second >= 0 ? " +" : " ") << second; break;
+            case Kind::SquareRoot: text << "10 x sqrt(grade)"; break;
+            case Kind::Clamp: text << "clamp to " << first << "-" << second; break;
+        }
+        return text.str();
+    }
+};
+
+// Applies the transform to a column of grades in place. The SSE2 path handles
+// four grades per instruction; both paths round half to even.
+void applyGradeKernel(int* grades, size_t count, const GradeTransform& transform) {
+    bool squareRoot = transform.kind == GradeTransform::Kind::SquareRoot;
+    float multiplier = 1.0f, offset = 0.0f, low = 0.0f, high = 100.0f;
+    switch (transform.kind) {
+        case GradeTransform::Kind::Offset:
+            offset = static_cast<float>(transform.first);
+            break;
+        case GradeTransform::Kind::Scale:
+            multiplier = static_cast<float>(transform.first);
+            offset = static_cast<float>(transform.second);
+            break;
+        case GradeTransform::Kind::SquareRoot:
+            multiplier = 10.0f;
+            break;
+        case GradeTransform::Kind::Clamp:
+            low = max(low, static_cast<float>(transform.first));
+            high = min(high, static_cast<float>(transform.second));
+            break;
+    }
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 multiplierVector = _mm_set1_ps(multiplier);
+    const __m128 offsetVector = _mm_set1_ps(offset);
+    const __m128 lowVector = _mm_set1_ps(low);
+    const __m128 highVector = _mm_set1_ps(high);
+    for (; i + 4 <= count; i += 4) {
+        __m128i* lane = reinterpret_cast<__m128i*>(grades + i);
+        __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(lane));
+        if (squareRoot) {
+            x = _mm_sqrt_ps(x);
+        }
+        x = _mm_add_ps(_mm_mul_ps(x, multiplierVector), offsetVector);
+        x = _mm_min_ps(_mm_max_ps(x, lowVector), highVector);
+        _mm_storeu_si128(lane, _mm_cvtps_epi32(x));
+    }
+#endif
+    for (; i < count; ++i) {
+        float x = static_cast<float>(grades[i]);
+        if (squareRoot) {
+            x = sqrt(x);
+        }
+        x = min(max(x * multiplier + offset, low), high);
+        grades[i] = static_cast<int>(nearbyint(x));
+    }
+}
+
+// Best and worst K students of a course by their average grade in it, kept
+// sorted as grades arrive. A new grade moves the student's entry; only when a
+// student already in a full list falls back, so that someone outside might now
+// belong in it, is that list refilled from the per-student totals in O(n * K).
+// Curves reshape the averages unevenly, so they refill both lists.
+class GradeRanking {
+public:
+    using Entry = pair<double, string>; // average grade, student email
+
+private:
+    size_t limit;
+    unordered_map<string, pair<long long, size_t>> totals; // student -> grade sum, grade count
+    vector<Entry> top;     // Descending
+    vector<Entry> bottom;  // Ascending
+
+    // Ties go to the earlier email, so the lists depend only on the grades
+    static bool higher(const Entry& a, const Entry& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    }
+
+    static bool lower(const Entry& a, const Entry& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    }
+
+    static double average(const pair<long long, size_t>& total) {
+        return static_cast<double>(total.first) / total.second;
+    }
+
+    template <typename Better>
+    void offer(vector<Entry>& entries, const Entry& entry, Better better) {
+        if (entries.size() == limit && !better(entry, entries.back())) {
+            return;
+        }
+        entries.insert(lower_bound(entries.begin(), entries.end(), entry, better), entry);
+        if (entries.size() > limit) {
+            entries.pop_back();
+        }
+    }
+
+    template <typename Better>
+    void refill(vector<Entry>& entries, Better better) {
+        entries.clear();
+        for (const auto& [student, total] : totals) {
+            offer(entries, {average(total), student}, better);
+        }
+    }
+
+    template <typename Better>
+    void update(vector<Entry>& entries, const Entry& entry, Better better) {
+        auto current = find_if(entries.begin(), entries.end(),
+            [&entry](const Entry& kept) { return kept.second == entry.second; });
+        if (current != entries.end()) {
+            bool fellBack = better(*current, entry);
+            bool wasFull = entries.size() == limit;
+            entries.erase(current);
+            if (fellBack && wasFull && totals.size() > limit) {
+                refill(entries, better);
+                return;
+            }
+        }
+        offer(entries, entry, better);
+    }
+
+public:
+    explicit GradeRanking(size_t limit = 5) : limit(limit) {}
+
+    void addGrade(const string& studentEmail, int grade) {
+        auto& total = totals[studentEmail];
+        total.first += grade;
+        ++total.second;
+        Entry entry(average(total), studentEmail);
+        update(top, entry, higher);
+        update(bottom, entry, lower);
+    }
+
+    // Recomputes the totals from curved grade columns
+    void rebuild(const vector<int>& values, const vector<string>& students) {
+        totals.clear();
+        for (size_t i = 0; i < values.size(); ++i) {
+            auto& total = totals[students[i]];
+            total.first += values[i];
+            ++total.second;
+        }
+        refill(top, higher);
+        refill(bottom, lower);
+    }
+
+    const vector<Entry>& highest() const { return top; }
+    const vector<Entry>& lowest() const { return bottom; }
+};
+
+// Binary indexed tree of counts: point updates and prefix sums in O(log n),
+// and appends at the end in O(log n)
+class FenwickTree {
+private:
+    vector<int> tree; // tree[i - 1] sums the values in (i - lowbit(i), i]
+
+public:
+    size_t size() const { return tree.size(); }
+
+    void push_back(int value) {
+        size_t node = tree.size() + 1;
+        size_t low = node - (node & -node);
+        for (size_t child = node - 1; child > low; child -= child & -child) {
+            value += tree[child - 1];
+        }
+        tree.push_back(value);
+    }
+
+    void add(size_t index, int delta) {
+        for (size_t node = index + 1; node <= tree.size(); node += node & -node) {
+            tree[node - 1] += delta;
+        }
+    }
+
+    // Sum of the values at 0..index
+    int prefixSum(size_t index) const {
+        int sum = 0;
+        for (size_t node = index + 1; node > 0; node -= node & -node) {
+            sum += tree[node - 1];
+        }
+        return sum;
+    }
+
+    // Rebuilds from scratch in O(n)
+    void assign(size_t count, int value) {
+        tree.assign(count, value);
+        for (size_t node = 1; node <= tree.size(); ++node) {
+            size_t parent = node + (node & -node);
+            if (parent <= tree.size()) {
+                tree[parent - 1] += tree[node - 1];
+            }
+        }
+    }
+};
+
+// Variable-length integers: seven bits per byte, low bits first. Signed values
+// are zigzag-encoded so small negative numbers stay short.
+inline void appendVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline void appendSignedVarint(string& out, int64_t value) {
+    appendVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+inline uint64_t readVarint(const string& data, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) {
+            throw runtime_error("Truncated record");
+        }
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw runtime_error("Corrupt variable-length integer");
+}
+
+inline int64_t readSignedVarint(const string& data, size_t& pos) {
+    uint64_t value = readVarint(data, pos);
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// One (course, student) row of the grade store
+struct GradeRow {
+    bool enrolled = false;
+    vector<int> grades;
+};
+
+// Embedded log-structured merge store of enrollment and grade rows keyed by
+// (course ID, student number), so one course's rows sit next to each other.
+// Writes land in a sorted in-memory table. A full table is frozen and a
+// background thread writes it out as an immutable run file with a sparse
+// block index and a Bloom filter. Level 0 holds freshly written runs, which
+// may overlap; every deeper level is a single sorted run with ten times the
+// budget of the level above, and the background thread merges a level into
+// the next once it outgrows its budget. Reads go from the tables to the runs,
+// newest first, skipping runs whose filter rules the key out.
+//
+// Like the email index, the directory is spill space rather than a durable
+// copy: the mutation log is the record of every enrollment and grade, so the
+// store starts empty each time it is opened and removes its run files again
+// when it closes. Student numbers are the store's own, given out on a
+// student's first row.
+class GradeStore {
+public:
+    struct Stats {
+        size_t memtableRows = 0;
+        vector<size_t> runsPerLevel;
+        vector<uint64_t> rowsPerLevel;
+        vector<uint64_t> bytesPerLevel;
+        uint64_t flushes = 0;
+        uint64_t compactions = 0;
+        uint64_t filterSkips = 0; // Run lookups answered by a filter alone
+        uint64_t blockReads = 0;
+    };
+
+private:
+    static constexpr size_t BLOCK_ROWS = 64;
+    static constexpr size_t LEVEL0_RUNS = 4;   // Level 0 is merged down at this many runs
+    static constexpr size_t LEVEL_RATIO = 10;
+    static constexpr size_t FILTER_BITS_PER_KEY = 10;
+    static constexpr int FILTER_HASHES = 6;
+    static constexpr char RUN_MAGIC[8] = {'L', 'M', 'S', 'R', 'U', 'N', '0', '1'};
+
+    struct StoredRow {
+        bool deleted = false; // Tombstone hiding older versions of the row
+        GradeRow row;
+    };
+    using Table = map<uint64_t, StoredRow>;
+
+    static uint64_t makeKey(uint32_t courseId, uint32_t student) {
+        return static_cast<uint64_t>(courseId) << 32 | student;
+    }
+
+    static uint64_t mixKey(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        return key ^ (key >> 33);
+    }
+
+    static void encodeRow(string& out, uint64_t keyDelta, const StoredRow& stored) {
+        appendVarint(out, keyDelta);
+        out += static_cast<char>((stored.deleted ? 1 : 0) | (stored.row.enrolled ? 2 : 0));
+        appendVarint(out, stored.row.grades.size());
+        for (int grade : stored.row.grades) {
+            appendSignedVarint(out, grade);
+        }
+    }
+
+    static void appendFixed(string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out += static_cast<char>(value >> (8 * i));
+        }
+    }
+
+    static uint64_t readFixed(const string& data, size_t pos) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos + i])) << (8 * i);
+        }
+        return value;
+    }
+
+    // An immutable sorted file. Its block index and filter stay in memory;
+    // rows are read from disk one block at a time.
+    class Run {
+    private:
+        string path;
+        uint64_t rowCount = 0;
+        uint64_t fileBytes = 0;
+        vector<uint64_t> blockKeys;    // First key of each block
+        vector<uint64_t> blockOffsets; // Start of each block, plus the end of the last
+        vector<uint64_t> filter;
+        mutable mutex fileLock;
+        mutable ifstream file;
+
+    public:
+        atomic<bool> obsolete{false}; // Set once merged away; the file goes with the last reference
+
+        explicit Run(const string& filePath) : path(filePath), file(filePath, ios::binary) {
+            if (!file) {
+                throw runtime_error("Cannot open run: " + path);
+            }
+            file.seekg(0, ios::end);
+            fileBytes = file.tellg();
+            const size_t footerBytes = 24;
+            if (fileBytes < sizeof(RUN_MAGIC) + footerBytes) {
+                throw runtime_error("Truncated run: " + path);
+            }
+            string footer(footerBytes, '\0');
+            file.seekg(fileBytes - footerBytes);
+            file.read(&footer[0], footerBytes);
+            if (footer.compare(16, 8, RUN_MAGIC, sizeof(RUN_MAGIC)) != 0) {
+                throw runtime_error("Not a run file: " + path);
+            }
+            uint64_t indexStart = readFixed(footer, 0);
+            rowCount = readFixed(footer, 8);
+
+            string index(fileBytes - footerBytes - indexStart, '\0');
+            file.seekg(indexStart);
+            file.read(&index[0], index.size());
+            size_t pos = 0;
+            size_t blocks = readVarint(index, pos);
+            for (size_t i = 0; i < blocks; ++i) {
+                blockKeys.push_back(readVarint(index, pos));
+                blockOffsets.push_back(readVarint(index, pos));
+            }
+            blockOffsets.push_back(indexStart);
+            filter.resize(readVarint(index, pos));
+            for (auto& word : filter) {
+                word = readFixed(index, pos);
+                pos += 8;
+            }
+        }
+
+        ~Run() {
+            if (obsolete) {
+                file.close();
+                filesystem::remove(path);
+            }
+        }
+
+        // Writes rows delivered in key order by `next` until it returns false
+        static void write(const string& path, size_t expectedRows, const function<bool(uint64_t&, StoredRow&)>& next) {
+            ofstream out(path, ios::binary | ios::trunc);
+            vector<uint64_t> filterBits(max<size_t>(1, (expectedRows * FILTER_BITS_PER_KEY + 63) / 64), 0);
+            uint64_t filterSize = filterBits.size() * 64;
+            string index, block(RUN_MAGIC, sizeof(RUN_MAGIC));
+            uint64_t offset = 0, rows = 0, blocks = 0, previous = 0;
+            size_t inBlock = 0;
+            uint64_t key;
+            StoredRow stored;
+            while (next(key, stored)) {
+                if (inBlock == BLOCK_ROWS) {
+                    offset += block.size();
+                    out.write(block.data(), block.size());
+                    block.clear();
+                    inBlock = 0;
+                }
+                if (inBlock == 0) {
+                    appendVarint(index, key);
+                    appendVarint(index, offset + block.size());
+                    ++blocks;
+                    previous = 0;
+                }
+                encodeRow(block, key - previous, stored);
+                previous = key;
+                ++inBlock;
+                ++rows;
+                uint64_t hash = mixKey(key);
+                uint64_t step = (hash >> 32) | 1;
+                for (int i = 0; i < FILTER_HASHES; ++i) {
+                    uint64_t bit = (hash + i * step) % filterSize;
+                    filterBits[bit / 64] |= 1ULL << (bit % 64);
+                }
+            }
+            offset += block.size();
+            out.write(block.data(), block.size());
+
+            string tail;
+            appendVarint(tail, blocks);
+            tail += index;
+            appendVarint(tail, filterBits.size());
+            for (uint64_t word : filterBits) {
+                appendFixed(tail, word);
+            }
+            appendFixed(tail, offset);
+            appendFixed(tail, rows);
+            tail.append(RUN_MAGIC, sizeof(RUN_MAGIC));
+            out.write(tail.data(), tail.size());
+            if (!out.flush()) {
+                throw runtime_error("Cannot write run: " + path);
+            }
+        }
+
+        const string& getPath() const { return path; }
+        uint64_t rows() const { return rowCount; }
+        uint64_t bytes() const { return fileBytes; }
+        size_t blockCount() const { return blockKeys.size(); }
+
+        bool mightContain(uint64_t key) const {
+            uint64_t filterSize = filter.size() * 64;
+            uint64_t hash = mixKey(key);
+            uint64_t step = (hash >> 32) | 1;
+            for (int i = 0; i < FILTER_HASHES; ++i) {
+                uint64_t bit = (hash + i * step) % filterSize;
+                if (!(filter[bit / 64] >> (bit % 64) & 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Block that would hold the key, or blockCount() if the key is below them all
+        size_t blockFor(uint64_t key) const {
+            size_t after = upper_bound(blockKeys.begin(), blockKeys.end(), key) - blockKeys.begin();
+            return after == 0 ? blockKeys.size() : after - 1;
+        }
+
+        vector<pair<uint64_t, StoredRow>> readBlock(size_t blockIndex) const {
+            string data(blockOffsets[blockIndex + 1] - blockOffsets[blockIndex], '\0');
+            {
+                lock_guard<mutex> guard(fileLock);
+                file.clear();
+                file.seekg(blockOffsets[blockIndex]);
+                file.read(&data[0], data.size());
+            }
+            vector<pair<uint64_t, StoredRow>> rows;
+            size_t pos = 0;
+            uint64_t key = 0;
+            while (pos < data.size()) {
+                key += readVarint(data, pos);
+                StoredRow stored;
+                uint8_t flags = data.at(pos++);
+                stored.deleted = flags & 1;
+                stored.row.enrolled = flags & 2;
+                stored.row.grades.resize(readVarint(data, pos));
+                for (int& grade : stored.row.grades) {
+                    grade = static_cast<int>(readSignedVarint(data, pos));
+                }
+                rows.push_back({key, move(stored)});
+            }
+            return rows;
+        }
+    };
+
+    // Reads a run in key order, block by block
+    class RunCursor {
+    private:
+        shared_ptr<Run> run;
+        size_t block = 0;
+        vector<pair<uint64_t, StoredRow>> rows;
+        size_t position = 0;
+
+        void load() {
+            rows.clear();
+            position = 0;
+            while (rows.empty() && block < run->blockCount()) {
+                rows = run->readBlock(block++);
+            }
+        }
+
+    public:
+        explicit RunCursor(shared_ptr<Run> source, uint64_t from = 0) : run(move(source)) {
+            size_t start = run->blockFor(from);
+            block = start == run->blockCount() ? 0 : start;
+            load();
+            while (valid() && key() < from) {
+                next();
+            }
+        }
+
+        bool valid() const { return position < rows.size(); }
+        uint64_t key() const { return rows[position].first; }
+        StoredRow& row() { return rows[position].second; }
+
+        void next() {
+            if (++position == rows.size()) {
+                load();
+            }
+        }
+    };
+
+    string directory;
+    size_t memtableLimit;
+    mutable mutex lock;
+    condition_variable changed;
+    Table memtable;
+    shared_ptr<const Table> frozen;       // Full table waiting to be written
+    vector<vector<shared_ptr<Run>>> levels; // levels[0] newest first; deeper levels hold one run
+    unordered_map<string, uint32_t> studentNumbers;
+    vector<string> studentEmails;         // student number -> email
+    uint64_t nextFileNumber = 1;
+    bool stopping = false;
+    thread background;
+    Stats counters;
+    atomic<uint64_t> filterSkips{0};
+    atomic<uint64_t> blockReads{0};
+
+    static bool isRunFile(const filesystem::path& path) {
+        string name = path.filename().string();
+        return name.rfind("run-", 0) == 0 && path.extension() == ".sst";
+    }
+
+    string runPath(uint64_t number) const {
+        return directory + "/run-" + to_string(number) + ".sst";
+    }
+
+    uint64_t levelBudget(size_t level) const {
+        uint64_t budget = memtableLimit * LEVEL0_RUNS;
+        for (size_t i = 1; i < level; ++i) {
+            budget *= LEVEL_RATIO;
+        }
+        return budget * LEVEL_RATIO;
+    }
+
+    // Merges runs, newest first, into one new run. Tombstones are dropped when
+    // nothing older remains underneath.
+    shared_ptr<Run> merge(const vector<shared_ptr<Run>>& inputs, bool dropTombstones, uint64_t number) {
+        vector<RunCursor> cursors;
+        size_t expected = 0;
+        for (const auto& run : inputs) {
+            cursors.emplace_back(run);
+            expected += run->rows();
+        }
+        auto next = [&cursors, dropTombstones](uint64_t& key, StoredRow& stored) {
+            while (true) {
+                size_t newest = cursors.size();
+                for (size_t i = 0; i < cursors.size(); ++i) {
+                    if (cursors[i].valid() && (newest == cursors.size() || cursors[i].key() < cursors[newest].key())) {
+                        newest = i; // Lowest key; ties keep the earlier, newer input
+                    }
+                }
+                if (newest == cursors.size()) {
+                    return false;
+                }
+                key = cursors[newest].key();
+                stored = move(cursors[newest].row());
+                for (auto& cursor : cursors) {
+                    if (cursor.valid() && cursor.key() == key) {
+                        cursor.next();
+                    }
+                }
+                if (!(stored.deleted && dropTombstones)) {
+                    return true;
+                }
+            }
+        };
+        Run::write(runPath(number), expected, next);
+        return make_shared<Run>(runPath(number));
+    }
+
+    // Background thread: writes frozen tables and merges levels that outgrew their budget
+    void backgroundLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            changed.wait(guard, [this] { return frozen || stopping; });
+            if (stopping) {
+                return; // Nothing is kept past close, so a pending table is not written
+            }
+            shared_ptr<const Table> table = frozen;
+            uint64_t number = nextFileNumber++;
+            guard.unlock();
+            auto position = table->begin();
+            Run::write(runPath(number), table->size(), [&position, &table](uint64_t& key, StoredRow& stored) {
+                if (position == table->end()) {
+                    return false;
+                }
+                key = position->first;
+                stored = position->second;
+                ++position;
+                return true;
+            });
+            shared_ptr<Run> run = make_shared<Run>(runPath(number));
+            guard.lock();
+            if (levels.empty()) {
+                levels.resize(1);
+            }
+            levels[0].insert(levels[0].begin(), run);
+            frozen.reset();
+            ++counters.flushes;
+            changed.notify_all();
+
+            compactLocked(guard);
+        }
+    }
+
+    void compactLocked(unique_lock<mutex>& guard) {
+        for (size_t level = 0; level < levels.size(); ++level) {
+            uint64_t rows = 0;
+            for (const auto& run : levels[level]) {
+                rows += run->rows();
+            }
+            bool full = level == 0 ? levels[0].size() >= LEVEL0_RUNS : rows > levelBudget(level);
+            if (!full) {
+                continue;
+            }
+            if (levels.size() == level + 1) {
+                levels.resize(level + 2);
+            }
+            vector<shared_ptr<Run>> inputs = levels[level];
+            inputs.insert(inputs.end(), levels[level + 1].begin(), levels[level + 1].end());
+            bool bottom = level + 2 == levels.size();
+            uint64_t number = nextFileNumber++;
+            guard.unlock();
+            shared_ptr<Run> merged = merge(inputs, bottom, number);
+            guard.lock();
+
+            // Only this thread adds or removes runs, so the inputs are still the whole level.
+            // Readers that copied the old run list keep those files until they let go.
+            levels[level].clear();
+            levels[level + 1] = {merged};
+            for (auto& run : inputs) {
+                run->obsolete = true;
+            }
+            ++counters.compactions;
+        }
+    }
+
+    // Freezes the memtable for the background thread, waiting while the previous one is written
+    void freezeLocked(unique_lock<mutex>& guard) {
+        changed.wait(guard, [this] { return !frozen; });
+        frozen = make_shared<const Table>(move(memtable));
+        memtable = Table();
+        changed.notify_all();
+    }
+
+    // Caller holds the lock
+    uint32_t numberOf(const string& studentEmail) {
+        auto known = studentNumbers.find(studentEmail);
+        if (known != studentNumbers.end()) {
+            return known->second;
+        }
+        studentEmails.push_back(studentEmail);
+        return studentNumbers[studentEmail] = static_cast<uint32_t>(studentEmails.size() - 1);
+    }
+
+    optional<GradeRow> read(uint64_t key, unique_lock<mutex>& guard) {
+        const StoredRow* found = nullptr;
+        auto recent = memtable.find(key);
+        if (recent != memtable.end()) {
+            found = &recent->second;
+        } else if (frozen) {
+            auto pending = frozen->find(key);
+            if (pending != frozen->end()) {
+                found = &pending->second;
+            }
+        }
+        if (found) {
+            return found->deleted ? nullopt : optional<GradeRow>(found->row);
+        }
+        vector<shared_ptr<Run>> runs;
+        for (const auto& level : levels) {
+            runs.insert(runs.end(), level.begin(), level.end());
+        }
+        guard.unlock();
+
+        // Newest run first; the first version found wins
+        for (const auto& run : runs) {
+            if (!run->mightContain(key)) {
+                ++filterSkips;
+                continue;
+            }
+            size_t block = run->blockFor(key);
+            if (block == run->blockCount()) {
+                continue;
+            }
+            ++blockReads;
+            for (auto& entry : run->readBlock(block)) {
+                if (entry.first == key) {
+                    return entry.second.deleted ? nullopt : optional<GradeRow>(move(entry.second.row));
+                }
+            }
+        }
+        return nullopt;
+    }
+
+public:
+    explicit GradeStore(const string& directory, size_t memtableLimit = 1 << 16)
+        : directory(directory), memtableLimit(memtableLimit) {
+        filesystem::create_directories(directory);
+        for (const auto& entry : filesystem::directory_iterator(directory)) {
+            if (isRunFile(entry.path())) {
+                filesystem::remove(entry.path()); // Left by a store that did not close
+            }
+        }
+        background = thread(&GradeStore::backgroundLoop, this);
+    }
+
+    ~GradeStore() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            changed.notify_all();
+        }
+        background.join();
+        for (const auto& level : levels) {
+            for (const auto& run : level) {
+                run->obsolete = true;
+            }
+        }
+    }
+
+    GradeStore(const GradeStore&) = delete;
+    GradeStore& operator=(const GradeStore&) = delete;
+
+    const string& getDirectory() const { return directory; }
+    size_t getMemtableLimit() const { return memtableLimit; }
+
+    // Writes the row; a row that is neither enrolled nor graded is erased
+    void put(int courseId, const string& studentEmail, const GradeRow& row) {
+        unique_lock<mutex> guard(lock);
+        StoredRow& stored = memtable[makeKey(courseId, numberOf(studentEmail))];
+        stored.deleted = !row.enrolled && row.grades.empty();
+        stored.row = stored.deleted ? GradeRow() : row;
+        if (memtable.size() >= memtableLimit) {
+            freezeLocked(guard);
+        }
+    }
+
+    optional<GradeRow> get(int courseId, const string& studentEmail) {
+        unique_lock<mutex> guard(lock);
+        auto known = studentNumbers.find(studentEmail);
+        if (known == studentNumbers.end()) {
+            return nullopt;
+        }
+        return read(makeKey(courseId, known->second), guard);
+    }
+
+    // Every live row of one course, in student-number order
+    vector<pair<string, GradeRow>> scanCourse(int courseId) {
+        uint64_t first = makeKey(courseId, 0);
+        uint64_t last = makeKey(courseId, UINT32_MAX);
+        Table merged;
+        vector<shared_ptr<Run>> runs;
+        shared_ptr<const Table> pending;
+        Table recent;
+        {
+            lock_guard<mutex> guard(lock);
+            for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+                runs.insert(runs.end(), level->rbegin(), level->rend()); // Oldest first
+            }
+            pending = frozen;
+            recent.insert(memtable.lower_bound(first), memtable.upper_bound(last));
+        }
+        for (const auto& run : runs) {
+            for (RunCursor cursor(run, first); cursor.valid() && cursor.key() <= last; cursor.next()) {
+                merged[cursor.key()] = move(cursor.row());
+            }
+        }
+        if (pending) {
+            for (auto it = pending->lower_bound(first); it != pending->end() && it->first <= last; ++it) {
+                merged[it->first] = it->second;
+            }
+        }
+        for (auto& entry : recent) {
+            merged[entry.first] = move(entry.second);
+        }
+
+        vector<pair<string, GradeRow>> rows;
+        lock_guard<mutex> guard(lock);
+        for (auto& entry : merged) {
+            if (!entry.second.deleted) {
+                rows.push_back({studentEmails[static_cast<uint32_t>(entry.first)], move(entry.second.row)});
+            }
+        }
+        return rows;
+    }
+
+    void eraseCourse(int courseId) {
+        for (const auto& row : scanCourse(courseId)) {
+            put(courseId, row.first, GradeRow());
+        }
+    }
+
+    // Writes the memtable out and waits until it is on disk
+    void flush() {
+        unique_lock<mutex> guard(lock);
+        if (!memtable.empty()) {
+            freezeLocked(guard);
+        }
+        changed.wait(guard, [this] { return !frozen; });
+    }
+
+    Stats stats() const {
+        lock_guard<mutex> guard(lock);
+        Stats result = counters;
+        result.filterSkips = filterSkips;
+        result.blockReads = blockReads;
+        result.memtableRows = memtable.size() + (frozen ? frozen->size() : 0);
+        for (const auto& level : levels) {
+            uint64_t rows = 0, bytes = 0;
+            for (const auto& run : level) {
+                rows += run->rows();
+                bytes += run->bytes();
+            }
+            result.runsPerLevel.push_back(level.size());
+            result.rowsPerLevel.push_back(rows);
+            result.bytesPerLevel.push_back(bytes);
+        }
+        return result;
+    }
+
+    void displayStats(ostream& out) const {
+        Stats current = stats();
+        out << "Grade store: " << current.memtableRows << " rows in memory";
+        for (size_t level = 0; level < current.runsPerLevel.size(); ++level) {
+            out << ", L" << level << " " << current.runsPerLevel[level] << " runs/"
+                << current.rowsPerLevel[level] << " rows";
+        }
+        out << "; " << current.flushes << " flushes, " << current.compactions << " compactions, "
+            << current.filterSkips << " runs skipped by filters\n";
+    }
+};
+
+// One course's grades as parallel columns
+struct GradeColumns {
+    vector<string> students;
+    vector<int> values;
+
+    size_t size() const { return values.size(); }
+};
+
+class Course {
+private:
+    string courseName;
+    string teacherEmail;
+    vector<string> contents;
+    vector<string> gradeStudents;  // Grades are stored by column so bulk changes
+    vector<int> gradeValues;       // run over one contiguous array
+    GradeRanking ranking;          // Top and bottom students for reports
+    vector<string> enrolledStudents;
+    unordered_map<string, size_t> enrolledIndex; // Position of each student in enrolledStudents
+
+    // Once set, the roster and grades live in the store as one row per student
+    // and the columns above stay empty. Only the counts are kept in memory.
+    GradeStore* store = nullptr;   // Owned by the institution
+    size_t storedEnrollments = 0;
+    size_t storedGrades = 0;
+
+    // Seat limit and FIFO waitlist. Each join takes the next slot; leaving or
+    // being promoted clears it, and the slots are compacted once cleared ones
+    // outnumber the waiting students. A position is the count of waiting
+    // slots up to the student's own, kept in a Fenwick tree.
+    size_t capacity = 0; // 0 means unlimited
+
+    int courseId = -1;             // Assigned by LMSManager, never reused
+    string term;                   // Academic term; LMSManager fills in the active one
+    vector<int> prerequisiteIds;   // Direct prerequisites
+    vector<TimeSlot> schedule;     // Weekly meetings
+    vector<string> waitlistSlots;  // Empty once the student left or was promoted
+    size_t waitlistHead = 0;       // First slot not yet offered a seat
+    unordered_map<string, size_t> waitlistTickets; // student -> slot
+    FenwickTree waitingSlots;      // 1 for each slot whose student still waits
+
+    void addToRoster(const string& studentEmail) {
+        if (store) {
+            GradeRow row = store->get(courseId, studentEmail).value_or(GradeRow());
+            row.enrolled = true;
+            store->put(courseId, studentEmail, row);
+            ++storedEnrollments;
+            return;
+        }
+        enrolledIndex[studentEmail] = enrolledStudents.size();
+        enrolledStudents.push_back(studentEmail);
+    }
+
+    void clearWaitlistSlot(size_t slot) {
+        waitlistTickets.erase(waitlistSlots[slot]);
+        waitlistSlots[slot].clear();
+        waitingSlots.add(slot, -1);
+    }
+
+    // Drops cleared slots once they outnumber the waiting ones, so churn
+    // cannot grow the slots without bound
+    void compactWaitlist() {
+        size_t cleared = waitlistSlots.size() - waitlistTickets.size();
+        if (cleared < 64 || cleared <= waitlistTickets.size()) {
+            return;
+        }
+        vector<string> waiting;
+        waiting.reserve(waitlistTickets.size());
+        for (size_t slot = waitlistHead; slot < waitlistSlots.size(); ++slot) {
+            if (!waitlistSlots[slot].empty()) {
+                waitlistTickets[waitlistSlots[slot]] = waiting.size();
+                waiting.push_back(move(waitlistSlots[slot]));
+            }
+        }
+        waitlistSlots.swap(waiting);
+        waitlistHead = 0;
+        waitingSlots.assign(waitlistSlots.size(), 1);
+    }
+
+    // Moves waitlisted students into free seats; returns who was enrolled
+    vector<string> promoteFromWaitlist() {
+        vector<string> promoted;
+        while (!isFull() && waitlistHead < waitlistSlots.size()) {
+            size_t slot = waitlistHead++;
+            if (waitlistSlots[slot].empty()) {
+                continue; // Left the waitlist
+            }
+            addToRoster(waitlistSlots[slot]);
+            promoted.push_back(waitlistSlots[slot]);
+            clearWaitlistSlot(slot);
+        }
+        compactWaitlist();
+        return promoted;
+    }
+
+public:
+    Course(string courseName, string teacherEmail) {
+        if (!Validator::isValidString(courseName)) {
+            throw ValidationException("Invalid course name");
+        }
+        if (!Validator::isValidEmail(teacherEmail)) {
+            throw ValidationException("Invalid teacher email");
+        }
+        this->courseName = courseName;
+        this->teacherEmail = teacherEmail;
+    }
+
+    void addContent(string content) {
+        if (!Validator::isValidString(content)) {
+            throw ValidationException("Invalid content");
+        }
+        contents.push_back(content);
+    }
+
+    void removeContent(int index) {
+        if (!Validator::isValidIndex(index, contents.size())) {
+            throw InvalidCourseIndexException();
+        }
+        contents.erase(contents.begin() + index);
+    }
+
+    void displayContents(ostream& out = cout) const {
+        if (contents.empty()) {
+        out << "No content available for this course.\n";
+        return;
+    }
+
+    out << "Course Contents:\n";
+    for (const auto& content : contents) {
+        out << "- " << content << endl;
+    }
+}
+
+    void addGrade(const string& studentEmail, int grade) {
+        if (!Validator::isValidEmail(studentEmail)) {
+            throw ValidationException("Invalid student email");
+        }
+        if (!Validator::isValidGrade(grade)) {
+            throw ValidationException("Invalid grade");
+        }
+        if (store) {
+            GradeRow row = store->get(courseId, studentEmail).value_or(GradeRow());
+            row.grades.push_back(grade);
+            store->put(courseId, studentEmail, row);
+            ++storedGrades;
+        } else {
+            gradeStudents.push_back(studentEmail);
+            gradeValues.push_back(grade);
+        }
+        ranking.addGrade(studentEmail, grade);
+    }
+
+    const GradeRanking& getRanking() const { return ranking; }
+
+    // Every grade in the order it was given, or grouped by student once the
+    // store holds them. Read once and index the copy.
+    GradeColumns getGrades() const {
+        if (!store) {
+            return GradeColumns{gradeStudents, gradeValues};
+        }
+        GradeColumns grades;
+        grades.students.reserve(storedGrades);
+        grades.values.reserve(storedGrades);
+        for (const auto& [studentEmail, row] : store->scanCourse(courseId)) {
+            for (int grade : row.grades) {
+                grades.students.push_back(studentEmail);
+                grades.values.push_back(grade);
+            }
+        }
+        return grades;
+    }
+
+    // Calls visit(student, grade) for every grade, without copying the columns
+    template <typename Visit>
+    void forEachGrade(Visit visit) const {
+        if (!store) {
+            for (size_t i = 0; i < gradeValues.size(); ++i) {
+                visit(gradeStudents[i], gradeValues[i]);
+            }
+            return;
+        }
+        for (const auto& [studentEmail, row] : store->scanCourse(courseId)) {
+            for (int grade : row.grades) {
+                visit(studentEmail, grade);
+            }
+        }
+    }
+
+    // One student's grades, read from the store by key when it is attached
+    vector<int> getGradesOf(const string& studentEmail) const {
+        if (store) {
+            optional<GradeRow> row = store->get(courseId, studentEmail);
+            return row ? row->grades : vector<int>();
+        }
+        vector<int> grades;
+        for (size_t i = 0; i < gradeValues.size(); ++i) {
+            if (gradeStudents[i] == studentEmail) {
+                grades.push_back(gradeValues[i]);
+            }
+        }
+        return grades;
+    }
+
+    size_t getGradeCount() const { return store ? storedGrades : gradeValues.size(); }
+
+    // Transforms a copy of the grade column and swaps it in, so readers never
+    // see a half-curved course. With the store, the course's grades are
+    // gathered into one column for the kernel and written back row by row.
+    void transformGrades(const GradeTransform& transform) {
+        if (store) {
+            vector<pair<string, GradeRow>> rows = store->scanCourse(courseId);
+            GradeColumns curved;
+            for (const auto& [studentEmail, row] : rows) {
+                curved.students.insert(curved.students.end(), row.grades.size(), studentEmail);
+                curved.values.insert(curved.values.end(), row.grades.begin(), row.grades.end());
+            }
+            applyGradeKernel(curved.values.data(), curved.size(), transform);
+            auto next = curved.values.begin();
+            for (auto& [studentEmail, row] : rows) {
+                copy(next, next + row.grades.size(), row.grades.begin());
+                next += row.grades.size();
+                store->put(courseId, studentEmail, row);
+            }
+            ranking.rebuild(curved.values, curved.students);
+            return;
+        }
+        vector<int> curved = gradeValues;
+        applyGradeKernel(curved.data(), curved.size(), transform);
+        gradeValues.swap(curved);
+        ranking.rebuild(gradeValues, gradeStudents);
+    }
+
+    void displayGrades(ostream& out = cout) const {
+        GradeColumns grades = getGrades();
+        for (size_t i = 0; i < grades.size(); ++i) {
+            out << grades.students[i] << ": " << grades.values[i] << "%" << endl;
+        }
+    }
+
+    // Moves the roster and grades into `target` under this course's ID and
+    // frees the columns; null reads them back out of the current store. The
+    // course needs its ID first. Rows left in the old store are erased.
+    void useStore(GradeStore* target) {
+        if (target == store) {
+            return;
+        }
+        vector<string> roster = getStudents();
+        GradeColumns grades = getGrades();
+        if (store) {
+            store->eraseCourse(courseId);
+        }
+        store = target;
+        vector<string>().swap(enrolledStudents);
+        unordered_map<string, size_t>().swap(enrolledIndex);
+        vector<string>().swap(gradeStudents);
+        vector<int>().swap(gradeValues);
+        storedEnrollments = storedGrades = 0;
+        if (!store) {
+            for (const auto& studentEmail : roster) {
+                addToRoster(studentEmail);
+            }
+            gradeStudents = move(grades.students);
+            gradeValues = move(grades.values);
+            return;
+        }
+        // One write per student rather than one per grade
+        unordered_map<string, GradeRow> rows;
+        for (const auto& studentEmail : roster) {
+            rows[studentEmail].enrolled = true;
+        }
+        for (size_t i = 0; i < grades.size(); ++i) {
+            rows[grades.students[i]].grades.push_back(grades.values[i]);
+        }
+        for (const auto& [studentEmail, row] : rows) {
+            store->put(courseId, studentEmail, row);
+        }
+        storedEnrollments = roster.size();
+        storedGrades = grades.size();
+    }
+
+    void enrollStudent(const string& studentEmail) {
+    if (!Validator::isValidEmail(studentEmail)) {
+        throw ValidationException("Invalid student email");
+    }
+
+    if (isEnrolled(studentEmail)) {
+        throw ValidationException("Student already enrolled");
+    }
+    if (isFull()) {
+        throw ValidationException("Course is full");
+    }
+
+    addToRoster(studentEmail); // Enroll the student
+}
+
+   // Removes the student and hands the freed seat to the waitlist; returns who was promoted
+   vector<string> removeStudent(const string& studentEmail) {
+    if (store) {
+        optional<GradeRow> row = store->get(courseId, studentEmail);
+        if (!row || !row->enrolled) {
+            throw ValidationException("Student not found");
+        }
+        row->enrolled = false;
+        store->put(courseId, studentEmail, *row); // Erased unless grades remain
+        --storedEnrollments;
+        return promoteFromWaitlist();
+    }
+    auto entry = enrolledIndex.find(studentEmail);
+    if (entry == enrolledIndex.end()) {
+        throw ValidationException("Student not found");
+    }
+    // Fill the hole with the last student so removal is O(1)
+    size_t position = entry->second;
+    enrolledIndex.erase(entry);
+    if (position + 1 != enrolledStudents.size()) {
+        enrolledStudents[position] = move(enrolledStudents.back());
+        enrolledIndex[enrolledStudents[position]] = position;
+    }
+    enrolledStudents.pop_back();
+    return promoteFromWaitlist();
+}
+
+    bool isEnrolled(const string& studentEmail) const {
+        if (store) {
+            optional<GradeRow> row = store->get(courseId, studentEmail);
+            return row && row->enrolled;
+        }
+        return enrolledIndex.count(studentEmail) > 0;
+    }
+
+    bool isFull() const {
+        return capacity != 0 && getEnrollmentCount() >= capacity;
+    }
+
+    // Raising the limit promotes waitlisted students right away
+    vector<string> setCapacity(size_t newCapacity) {
+        capacity = newCapacity;
+        return promoteFromWaitlist();
+    }
+
+    // Returns the student's 1-based position on the waitlist
+    size_t joinWaitlist(const string& studentEmail) {
+        if (!Validator::isValidEmail(studentEmail)) {
+            throw ValidationException("Invalid student email");
+        }
+        if (isEnrolled(studentEmail)) {
+            throw ValidationException("Student already enrolled");
+        }
+        if (waitlistTickets.count(studentEmail)) {
+            throw ValidationException("Student already on the waitlist");
+        }
+        waitlistTickets[studentEmail] = waitlistSlots.size();
+        waitlistSlots.push_back(studentEmail);
+        waitingSlots.push_back(1);
+        return waitlistTickets.size();
+    }
+
+    void leaveWaitlist(const string& studentEmail) {
+        auto ticket = waitlistTickets.find(studentEmail);
+        if (ticket == waitlistTickets.end()) {
+            throw ValidationException("Student not on the waitlist");
+        }
+        clearWaitlistSlot(ticket->second);
+        compactWaitlist();
+    }
+
+    bool isWaitlisted(const string& studentEmail) const {
+        return waitlistTickets.count(studentEmail) > 0;
+    }
+
+    // 1-based position among the students still waiting, or 0 if not waitlisted
+    size_t waitlistPosition(const string& studentEmail) const {
+        auto ticket = waitlistTickets.find(studentEmail);
+        return ticket == waitlistTickets.end() ? 0 : waitingSlots.prefixSum(ticket->second);
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getWaitlistSize() const { return waitlistTickets.size(); }
+
+    void displayStudents(ostream& out = cout) const {
+        for (const auto& student : getStudents()) {
+            out << student << endl;
+        }
+    }
+
+    const vector<TimeSlot>& getSchedule() const { return schedule; }
+    void setSchedule(const vector<TimeSlot>& slots) { schedule = slots; }
+
+    string scheduleString() const {
+        if (schedule.empty()) {
+            return "no meeting times";
+        }
+        string text;
+        for (const auto& slot : schedule) {
+            text += (text.empty() ? "" : ", ") + slot.toString();
+        }
+        return text;
+    }
+
+    int getId() const { return courseId; }
+    void setId(int id) { courseId = id; }
+    const string& getTerm() const { return term; }
+    void setTerm(const string& name) { term = name; }
+    const vector<int>& getPrerequisites() const { return prerequisiteIds; }
+    void setPrerequisites(const vector<int>& ids) { prerequisiteIds = ids; }
+
+    string getCourseName() const { return courseName; }
+    string getTeacherEmail() const { return teacherEmail; }
+    const vector<string>& getContents() const { return contents; }
+
+    // The roster, scanned from the store when it holds it
+    vector<string> getStudents() const {
+        if (!store) {
+            return enrolledStudents;
+        }
+        vector<string> roster;
+        roster.reserve(storedEnrollments);
+        for (const auto& [studentEmail, row] : store->scanCourse(courseId)) {
+            if (row.enrolled) {
+                roster.push_back(studentEmail);
+            }
+        }
+        return roster;
+    }
+
+    size_t getEnrollmentCount() const { return store ? storedEnrollments : enrolledStudents.size(); }
+};
+
+
+
+inline int popcount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+inline int countTrailingZeros64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    for (; !(word & 1); word >>= 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Compressed bitmap of 32-bit IDs in the style of Roaring: values are grouped
+// by their high 16 bits, and each group is a sorted array while small
+// (<= 4096 values) or a 65536-bit bitmap once dense. Set operations work
+// chunk by chunk with word-wide AND/OR/ANDNOT and hardware popcount; the
+// plain word loops are left for the compiler to vectorize.
+class RoaringBitmap {
+private:
+    static const size_t ARRAY_LIMIT = 4096;
+    static const size_t BITMAP_WORDS = 1024;
+
+    struct Container {
+        vector<uint16_t> values;  // Sorted, used while the container is an array
+        vector<uint64_t> words;   // Used once the container is a bitmap
+        size_t cardinality = 0;
+
+        bool isBitmap() const { return !words.empty(); }
+
+        bool contains(uint16_t low) const {
+            if (isBitmap()) {
+                return (words[low >> 6] >> (low & 63)) & 1;
+            }
+            return binary_search(values.begin(), values.end(), low);
+        }
+
+        void toBitmap() {
+            words.assign(BITMAP_WORDS, 0);
+            for (uint16_t low : values) {
+                words[low >> 6] |= 1ULL << (low & 63);
+            }
+            values.clear();
+            values.shrink_to_fit();
+        }
+
+        // Switch back to an array when a bitmap becomes sparse
+        void normalize() {
+            if (isBitmap() && cardinality <= ARRAY_LIMIT) {
+                values.clear();
+                for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+                    for (uint64_t word = words[w]; word; word &= word - 1) {
+                        values.push_back(static_cast<uint16_t>(w * 64 + countTrailingZeros64(word)));
+                    }
+                }
+                words.clear();
+                words.shrink_to_fit();
+            } else if (!isBitmap() && cardinality > ARRAY_LIMIT) {
+                toBitmap();
+            }
+        }
+
+        bool add(uint16_t low) {
+            if (isBitmap()) {
+                uint64_t mask = 1ULL << (low & 63);
+                if (words[low >> 6] & mask) {
+                    return false;
+                }
+                words[low >> 6] |= mask;
+            } else {
+                auto it = lower_bound(values.begin(), values.end(), low);
+                if (it != values.end() && *it == low) {
+                    return false;
+                }
+                values.insert(it, low);
+            }
+            ++cardinality;
+            normalize();
+            return true;
+        }
+
+        bool remove(uint16_t low) {
+            if (isBitmap()) {
+                uint64_t mask = 1ULL << (low & 63);
+                if (!(words[low >> 6] & mask)) {
+                    return false;
+                }
+                words[low >> 6] &= ~mask;
+            } else {
+                auto it = lower_bound(values.begin(), values.end(), low);
+                if (it == values.end() || *it != low) {
+                    return false;
+                }
+                values.erase(it);
+            }
+            --cardinality;
+            normalize();
+            return true;
+        }
+
+        // Bitmap words of this container, converting arrays on the fly
+        const vector<uint64_t>& bitmapWords(vector<uint64_t>& scratch) const {
+            if (isBitmap()) {
+                return words;
+            }
+            scratch.assign(BITMAP_WORDS, 0);
+            for (uint16_t low : values) {
+                scratch[low >> 6] |= 1ULL << (low & 63);
+            }
+            return scratch;
+        }
+    };
+
+    enum class Operation { And, Or, AndNot };
+
+    vector<uint16_t> keys;          // Sorted high halves
+    vector<Container> containers;   // Parallel to keys
+
+    static Container combine(const Container& a, const Container& b, Operation operation) {
+        Container result;
+        if (!a.isBitmap() && !b.isBitmap()) {
+            // Two sorted arrays: merge directly
+            if (operation == Operation::And) {
+                set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                                 back_inserter(result.values));
+            } else if (operation == Operation::Or) {
+                set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                          back_inserter(result.values));
+            } else {
+                set_difference(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                               back_inserter(result.values));
+            }
+            result.cardinality = result.values.size();
+        } else {
+            vector<uint64_t> scratchA, scratchB;
+            const vector<uint64_t>& wordsA = a.bitmapWords(scratchA);
+            const vector<uint64_t>& wordsB = b.bitmapWords(scratchB);
+            result.words.resize(BITMAP_WORDS);
+            uint64_t* out = result.words.data();
+            const uint64_t* left = wordsA.data();
+            const uint64_t* right = wordsB.data();
+            if (operation == Operation::And) {
+                for (size_t i = 0; i < BITMAP_WORDS; ++i) out[i] = left[i] & right[i];
+            } else if (operation == Operation::Or) {
+                for (size_t i = 0; i < BITMAP_WORDS; ++i) out[i] = left[i] | right[i];
+            } else {
+                for (size_t i = 0; i < BITMAP_WORDS; ++i) out[i] = left[i] & ~right[i];
+            }
+            for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+                result.cardinality += popcount64(out[i]);
+            }
+        }
+        result.normalize();
+        return result;
+    }
+
+    static size_t andCardinality(const Container& a, const Container& b) {
+        if (a.isBitmap() && b.isBitmap()) {
+            size_t count = 0;
+            for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+                count += popcount64(a.words[i] & b.words[i]);
+            }
+            return count;
+        }
+        const Container& small = a.isBitmap() ? b : a;
+        const Container& other = a.isBitmap() ? a : b;
+        size_t count = 0;
+        for (uint16_t low : small.values) {
+            count += other.contains(low);
+        }
+        return count;
+    }
+
+    static RoaringBitmap combine(const RoaringBitmap& a, const RoaringBitmap& b, Operation operation) {
+        RoaringBitmap result;
+        size_t i = 0, j = 0;
+        while (i < a.keys.size() || j < b.keys.size()) {
+            bool takeA = j == b.keys.size() || (i < a.keys.size() && a.keys[i] < b.keys[j]);
+            bool takeB = i == a.keys.size() || (j < b.keys.size() && b.keys[j] < a.keys[i]);
+            if (takeA) {
+                if (operation != Operation::And) {
+                    result.keys.push_back(a.keys[i]);
+                    result.containers.push_back(a.containers[i]);
+                }
+                ++i;
+            } else if (takeB) {
+                if (operation == Operation::Or) {
+                    result.keys.push_back(b.keys[j]);
+                    result.containers.push_back(b.containers[j]);
+                }
+                ++j;
+            } else {
+                Container merged = combine(a.containers[i], b.containers[j], operation);
+                if (merged.cardinality > 0) {
+                    result.keys.push_back(a.keys[i]);
+                    result.containers.push_back(move(merged));
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    size_t findKey(uint16_t high) const {
+        return lower_bound(keys.begin(), keys.end(), high) - keys.begin();
+    }
+
+public:
+    void add(uint32_t value) {
+        uint16_t high = value >> 16;
+        size_t index = findKey(high);
+        if (index == keys.size() || keys[index] != high) {
+            keys.insert(keys.begin() + index, high);
+            containers.insert(containers.begin() + index, Container());
+        }
+        containers[index].add(value & 0xFFFF);
+    }
+
+    void remove(uint32_t value) {
+        uint16_t high = value >> 16;
+        size_t index = findKey(high);
+        if (index < keys.size() && keys[index] == high && containers[index].remove(value & 0xFFFF) &&
+            containers[index].cardinality == 0) {
+            keys.erase(keys.begin() + index);
+            containers.erase(containers.begin() + index);
+        }
+    }
+
+    bool contains(uint32_t value) const {
+        size_t index = findKey(value >> 16);
+        return index < keys.size() && keys[index] == (value >> 16) && containers[index].contains(value & 0xFFFF);
+    }
+
+    size_t cardinality() const {
+        size_t total = 0;
+        for (const auto& container : containers) {
+            total += container.cardinality;
+        }
+        return total;
+    }
+
+    static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b) { return combine(a, b, Operation::And); }
+    static RoaringBitmap unite(const RoaringBitmap& a, const RoaringBitmap& b) { return combine(a, b, Operation::Or); }
+    static RoaringBitmap subtract(const RoaringBitmap& a, const RoaringBitmap& b) { return combine(a, b, Operation::AndNot); }
+
+    // |a AND b| without building the intersection
+    static size_t intersectionSize(const RoaringBitmap& a, const RoaringBitmap& b) {
+        size_t count = 0;
+        size_t i = 0, j = 0;
+        while (i < a.keys.size() && j < b.keys.size()) {
+            if (a.keys[i] < b.keys[j]) {
+                ++i;
+            } else if (b.keys[j] < a.keys[i]) {
+                ++j;
+            } else {
+                count += andCardinality(a.containers[i++], b.containers[j++]);
+            }
+        }
+        return count;
+    }
+
+    vector<uint32_t> toVector(size_t limit = SIZE_MAX) const {
+        vector<uint32_t> values;
+        for (size_t c = 0; c < keys.size() && values.size() < limit; ++c) {
+            uint32_t high = static_cast<uint32_t>(keys[c]) << 16;
+            const Container& container = containers[c];
+            if (container.isBitmap()) {
+                for (size_t w = 0; w < BITMAP_WORDS && values.size() < limit; ++w) {
+                    for (uint64_t word = container.words[w]; word && values.size() < limit; word &= word - 1) {
+                        values.push_back(high | (w * 64 + countTrailingZeros64(word)));
+                    }
+                }
+            } else {
+                for (size_t v = 0; v < container.values.size() && values.size() < limit; ++v) {
+                    values.push_back(high | container.values[v]);
+                }
+            }
+        }
+        return values;
+    }
+};
+
+// Bitset over course IDs. Prerequisite closures and completed courses use it,
+// so an eligibility check is a few word-wide AND/compare operations.
+class CourseBitset {
+private:
+    vector<uint64_t> words;
+
+public:
+    void set(size_t bit) {
+        if (bit / 64 >= words.size()) {
+            words.resize(bit / 64 + 1, 0);
+        }
+        words[bit / 64] |= 1ULL << (bit % 64);
+    }
+
+    void reset(size_t bit) {
+        if (bit / 64 < words.size()) {
+            words[bit / 64] &= ~(1ULL << (bit % 64));
+        }
+    }
+
+    bool test(size_t bit) const {
+        return bit / 64 < words.size() && (words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    void orWith(const CourseBitset& other) {
+        if (other.words.size() > words.size()) {
+            words.resize(other.words.size(), 0);
+        }
+        for (size_t i = 0; i < other.words.size(); ++i) {
+            words[i] |= other.words[i];
+        }
+    }
+
+    // True when every bit set here is also set in other
+    bool isSubsetOf(const CourseBitset& other) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t otherWord = i < other.words.size() ? other.words[i] : 0;
+            if (words[i] & ~otherWord) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool none() const {
+        for (uint64_t word : words) {
+            if (word) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Bits set here but not in other
+    vector<int> missingFrom(const CourseBitset& other) const {
+        vector<int> missing;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t word = words[i] & ~(i < other.words.size() ? other.words[i] : 0);
+            for (int bit = 0; word; ++bit, word >>= 1) {
+                if (word & 1) {
+                    missing.push_back(i * 64 + bit);
+                }
+            }
+        }
+        return missing;
+    }
+};
+
+// Weekly intervals of one student's enrolled courses, sorted by start, with a
+// running maximum of end times. Since every interval before the first one
+// starting at or after `end` is a candidate, one binary search plus one
+// lookup answers "does [start, end) overlap anything?" even if the index
+// already holds overlapping intervals from later schedule changes.
+class StudentTimetable {
+private:
+    struct Interval {
+        int start;
+        int end;
+        int courseId;
+    };
+
+    vector<Interval> intervals;
+    vector<int> prefixMaxEnd;
+
+    void rebuildPrefix() {
+        prefixMaxEnd.resize(intervals.size());
+        int maxEnd = 0;
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            maxEnd = max(maxEnd, intervals[i].end);
+            prefixMaxEnd[i] = maxEnd;
+        }
+    }
+
+    size_t firstStartingAtOrAfter(int minute) const {
+        return lower_bound(intervals.begin(), intervals.end(), minute,
+            [](const Interval& interval, int value) { return interval.start < value; }) - intervals.begin();
+    }
+
+public:
+    // Returns the ID of a course overlapping [start, end), or -1, in O(log n).
+    // Intervals before `candidates` start before `end`; the first of them to push
+    // the running maximum end past `start` is itself such an interval.
+    int findConflict(int start, int end) const {
+        auto candidates = prefixMaxEnd.begin() + firstStartingAtOrAfter(end);
+        auto first = upper_bound(prefixMaxEnd.begin(), candidates, start);
+        return first == candidates ? -1 : intervals[first - prefixMaxEnd.begin()].courseId;
+    }
+
+    int findConflict(const vector<TimeSlot>& slots) const {
+        for (const auto& slot : slots) {
+            int conflict = findConflict(slot.weekStart(), slot.weekEnd());
+            if (conflict != -1) {
+                return conflict;
+            }
+        }
+        return -1;
+    }
+
+    void addCourse(int courseId, const vector<TimeSlot>& slots) {
+        for (const auto& slot : slots) {
+            Interval interval = {slot.weekStart(), slot.weekEnd(), courseId};
+            intervals.insert(intervals.begin() + firstStartingAtOrAfter(interval.start), interval);
+        }
+        rebuildPrefix();
+    }
+
+    void removeCourse(int courseId) {
+        intervals.erase(remove_if(intervals.begin(), intervals.end(),
+            [courseId](const Interval& interval) { return interval.courseId == courseId; }), intervals.end());
+        rebuildPrefix();
+    }
+
+    // Every pair of distinct courses whose meetings overlap
+    vector<pair<int, int>> conflictingPairs() const {
+        vector<pair<int, int>> pairs;
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            for (size_t j = i + 1; j < intervals.size() && intervals[j].start < intervals[i].end; ++j) {
+                if (intervals[i].courseId != intervals[j].courseId) {
+                    pairs.push_back({min(intervals[i].courseId, intervals[j].courseId),
+                                     max(intervals[i].courseId, intervals[j].courseId)});
+                }
+            }
+        }
+        sort(pairs.begin(), pairs.end());
+        pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+        return pairs;
+    }
+};
+
+// LMSManager class (Singleton)
+// Institution-wide ranking of students by their average over every grade,
+// archived terms included; only deleting a course takes its grades out.
+// Backed by a treap whose nodes carry subtree sizes, so inserting, removing,
+// "rank of S" and "the k-th student" are all O(log n). Ties rank by student ID.
+class Leaderboard {
+public:
+    struct Standing {
+        uint32_t studentId;
+        double average;
+    };
+
+private:
+    struct Node {
+        double average;
+        uint32_t studentId;
+        uint32_t priority;
+        int left = -1;
+        int right = -1;
+        uint32_t size = 1;
+    };
+
+    struct Totals {
+        long long sum = 0;
+        uint32_t count = 0;
+        double average() const { return double(sum) / count; }
+    };
+
+    vector<Node> nodes;         // Pooled nodes, linked by index
+    vector<int> freeNodes;
+    int root = -1;
+    vector<Totals> totals;      // student ID -> grade sum and count
+    mt19937 random{12345};
+
+    uint32_t sizeOf(int node) const { return node == -1 ? 0 : nodes[node].size; }
+
+    void update(int node) {
+        nodes[node].size = 1 + sizeOf(nodes[node].left) + sizeOf(nodes[node].right);
+    }
+
+    // True if the node ranks ahead of the (average, student) key
+    bool ahead(int node, double average, uint32_t studentId) const {
+        const Node& n = nodes[node];
+        return n.average > average || (n.average == average && n.studentId < studentId);
+    }
+
+    // Splits into nodes ranked ahead of the key and the rest
+    void split(int node, double average, uint32_t studentId, int& left, int& right) {
+        if (node == -1) {
+            left = right = -1;
+            return;
+        }
+        if (ahead(node, average, studentId)) {
+            split(nodes[node].right, average, studentId, nodes[node].right, right);
+            left = node;
+        } else {
+            split(nodes[node].left, average, studentId, left, nodes[node].left);
+            right = node;
+        }
+        update(node);
+    }
+
+    int merge(int left, int right) {
+        if (left == -1 || right == -1) {
+            return left == -1 ? right : left;
+        }
+        if (nodes[left].priority > nodes[right].priority) {
+            nodes[left].right = merge(nodes[left].right, right);
+            update(left);
+            return left;
+        }
+        nodes[right].left = merge(left, nodes[right].left);
+        update(right);
+        return right;
+    }
+
+    void insert(double average, uint32_t studentId) {
+        int node;
+        if (!freeNodes.empty()) {
+            node = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            node = static_cast<int>(nodes.size());
+            nodes.emplace_back();
+        }
+        nodes[node] = Node{average, studentId, static_cast<uint32_t>(random())};
+        int left, right;
+        split(root, average, studentId, left, right);
+        root = merge(merge(left, node), right);
+    }
+
+    int erase(int node, double average, uint32_t studentId) {
+        if (node == -1) {
+            return -1;
+        }
+        if (nodes[node].studentId == studentId && nodes[node].average == average) {
+            freeNodes.push_back(node);
+            return merge(nodes[node].left, nodes[node].right);
+        }
+        if (ahead(node, average, studentId)) {
+            nodes[node].right = erase(nodes[node].right, average, studentId);
+        } else {
+            nodes[node].left = erase(nodes[node].left, average, studentId);
+        }
+        update(node);
+        return node;
+    }
+
+    // Appends the standings at 1-based positions [first, last] within the subtree
+    void collect(int node, size_t offset, size_t first, size_t last, vector<Standing>& out) const {
+        if (node == -1 || offset + 1 > last || offset + sizeOf(node) < first) {
+            return;
+        }
+        collect(nodes[node].left, offset, first, last, out);
+        size_t position = offset + sizeOf(nodes[node].left) + 1;
+        if (position >= first && position <= last) {
+            out.push_back({nodes[node].studentId, nodes[node].average});
+        }
+        collect(nodes[node].right, position, first, last, out);
+    }
+
+    void adjust(uint32_t studentId, long long sumDelta, int countDelta) {
+        if (studentId >= totals.size()) {
+            totals.resize(studentId + 1);
+        }
+        Totals& student = totals[studentId];
+        if (student.count > 0) {
+            root = erase(root, student.average(), studentId);
+        }
+        student.sum += sumDelta;
+        student.count += countDelta;
+        if (student.count > 0) {
+            insert(student.average(), studentId);
+        }
+    }
+
+public:
+    void addGrade(uint32_t studentId, int grade) { adjust(studentId, grade, 1); }
+    void removeGrade(uint32_t studentId, int grade) { adjust(studentId, -grade, -1); }
+    void changeGrade(uint32_t studentId, int oldGrade, int newGrade) {
+        if (oldGrade != newGrade) {
+            adjust(studentId, newGrade - oldGrade, 0);
+        }
+    }
+
+    // Replaces every standing with the given grade sum and count per student ID
+    void load(const vector<pair<long long, uint32_t>>& studentTotals) {
+        nodes.clear();
+        freeNodes.clear();
+        root = -1;
+        totals.assign(studentTotals.size(), Totals());
+        for (uint32_t id = 0; id < studentTotals.size(); ++id) {
+            totals[id] = {studentTotals[id].first, studentTotals[id].second};
+            if (totals[id].count > 0) {
+                insert(totals[id].average(), id);
+            }
+        }
+    }
+
+    size_t size() const { return sizeOf(root); }
+
+    bool isRanked(uint32_t studentId) const {
+        return studentId < totals.size() && totals[studentId].count > 0;
+    }
+
+    double average(uint32_t studentId) const { return isRanked(studentId) ? totals[studentId].average() : 0.0; }
+
+    // 1-based rank, or 0 for a student without grades
+    size_t rank(uint32_t studentId) const {
+        if (!isRanked(studentId)) {
+            return 0;
+        }
+        double key = totals[studentId].average();
+        size_t before = 0;
+        for (int node = root; node != -1;) {
+            if (nodes[node].studentId == studentId && nodes[node].average == key) {
+                return before + sizeOf(nodes[node].left) + 1;
+            }
+            if (ahead(node, key, studentId)) {
+                before += sizeOf(nodes[node].left) + 1;
+                node = nodes[node].right;
+            } else {
+                node = nodes[node].left;
+            }
+        }
+        return 0;
+    }
+
+    // Students ranked first..last (1-based, inclusive)
+    vector<Standing> range(size_t first, size_t last) const {
+        vector<Standing> standings;
+        if (first >= 1 && first <= last) {
+            collect(root, 0, first, last, standings);
+        }
+        return standings;
+    }
+};
+
+// Sparse course x course co-occurrence counts: counts[x][y] is the number of
+// students enrolled in both x and y, i.e. the product of the course x student
+// enrollment matrix with its transpose. Enrollment changes adjust the counts
+// incrementally; rebuild() recomputes them row by row on the thread pool.
+class CoEnrollmentIndex {
+private:
+    vector<vector<int>> studentCourses;               // student ID -> enrolled course IDs
+    vector<unordered_map<int, uint32_t>> counts;      // course ID -> co-enrolled course ID -> students
+
+    void ensureCourse(int courseId) {
+        if (static_cast<size_t>(courseId) >= counts.size()) {
+            counts.resize(courseId + 1);
+        }
+    }
+
+public:
+    struct Recommendation {
+        int courseId;
+        uint32_t score;      // Co-enrollments summed over the student's courses
+        int becauseOf;       // The student's course contributing the most
+    };
+
+    void add(int courseId, uint32_t studentId) {
+        if (studentId >= studentCourses.size()) {
+            studentCourses.resize(studentId + 1);
+        }
+        ensureCourse(courseId);
+        vector<int>& enrolled = studentCourses[studentId];
+        if (find(enrolled.begin(), enrolled.end(), courseId) != enrolled.end()) {
+            return;
+        }
+        for (int other : enrolled) {
+            ++counts[courseId][other];
+            ++counts[other][courseId];
+        }
+        enrolled.push_back(courseId);
+    }
+
+    void remove(int courseId, uint32_t studentId) {
+        if (studentId >= studentCourses.size()) {
+            return;
+        }
+        vector<int>& enrolled = studentCourses[studentId];
+        auto it = find(enrolled.begin(), enrolled.end(), courseId);
+        if (it == enrolled.end()) {
+            return;
+        }
+        enrolled.erase(it);
+        for (int other : enrolled) {
+            if (--counts[courseId][other] == 0) {
+                counts[courseId].erase(other);
+            }
+            if (--counts[other][courseId] == 0) {
+                counts[other].erase(courseId);
+            }
+        }
+    }
+
+    // Recomputes every row from scratch, in parallel over courses
+    void rebuild();
+    void rebuild(ThreadPool& pool);
+
+    // Replaces every student's course list (student ID -> course IDs) and recomputes the rows
+    void load(vector<vector<int>> enrolledCourses, size_t courseCount, ThreadPool& pool) {
+        studentCourses = move(enrolledCourses);
+        counts.assign(courseCount, {});
+        rebuild(pool);
+    }
+
+    size_t nonZeroCount() const {
+        size_t total = 0;
+        for (const auto& row : counts) {
+            total += row.size();
+        }
+        return total;
+    }
+
+    uint32_t sharedStudents(int first, int second) const {
+        if (static_cast<size_t>(first) >= counts.size()) {
+            return 0;
+        }
+        auto it = counts[first].find(second);
+        return it == counts[first].end() ? 0 : it->second;
+    }
+
+    // Courses the student is not in, ranked by how often their classmates took them
+    vector<Recommendation> recommend(uint32_t studentId, size_t limit) const {
+        vector<Recommendation> ranked;
+        if (studentId >= studentCourses.size()) {
+            return ranked;
+        }
+        const vector<int>& enrolled = studentCourses[studentId];
+        unordered_map<int, Recommendation> scores;
+        for (int course : enrolled) {
+            for (const auto& entry : counts[course]) {
+                if (find(enrolled.begin(), enrolled.end(), entry.first) != enrolled.end()) {
+                    continue;
+                }
+                auto inserted = scores.try_emplace(entry.first, Recommendation{entry.first, 0, course});
+                Recommendation& recommendation = inserted.first->second;
+                recommendation.score += entry.second;
+                if (entry.second > sharedStudents(recommendation.becauseOf, entry.first)) {
+                    recommendation.becauseOf = course;
+                }
+            }
+        }
+        for (const auto& entry : scores) {
+            ranked.push_back(entry.second);
+        }
+        size_t kept = min(limit, ranked.size());
+        partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end(),
+                     [](const Recommendation& a, const Recommendation& b) {
+                         return a.score != b.score ? a.score > b.score : a.courseId < b.courseId;
+                     });
+        ranked.resize(kept);
+        return ranked;
+    }
+};
+
+// A closed course as read back from a term archive
+struct ArchivedCourse {
+    int id = -1;
+    string name;
+    string teacherEmail;
+    vector<string> contents;
+    vector<string> students;
+    vector<pair<string, int>> grades; // student email, grade
+};
+
+// Cold storage of one closed term: a single file holding its courses, rosters
+// and grades. Every email is stored once, in a sorted table where each entry
+// keeps only what differs from the one before it; rosters and grades refer to
+// emails by table index, and all numbers are variable-length integers. Nothing
+// stays in memory between queries: each query reads the file again.
+class TermArchive {
+private:
+    static constexpr char MAGIC[8] = {'L', 'M', 'S', 'T', 'E', 'R', 'M', '1'};
+
+    string data;
+    size_t pos = 0;
+    string term;
+    size_t rawBytes = 0;        // Size of the same data as plain strings
+    vector<string> emails;      // Sorted email table
+    vector<size_t> courseStarts; // Offset of each course record
+
+    static void putString(string& out, const string& text) {
+        appendVarint(out, text.size());
+        out += text;
+    }
+
+    uint64_t number() { return readVarint(data, pos); }
+    int64_t signedNumber() { return readSignedVarint(data, pos); }
+
+    string text() {
+        size_t length = number();
+        if (length > data.size() - pos) {
+            throw runtime_error("Truncated term archive");
+        }
+        string value = data.substr(pos, length);
+        pos += length;
+        return value;
+    }
+
+    void skipText() {
+        size_t length = number();
+        if (length > data.size() - pos) {
+            throw runtime_error("Truncated term archive");
+        }
+        pos += length;
+    }
+
+    ArchivedCourse readCourse(size_t start) {
+        pos = start;
+        ArchivedCourse course;
+        course.id = number();
+        course.name = text();
+        course.teacherEmail = text();
+        for (size_t i = number(); i > 0; --i) {
+            course.contents.push_back(text());
+        }
+        // Roster indexes ascend, so each is stored as the gap from the previous one
+        size_t index = 0;
+        for (size_t i = number(); i > 0; --i) {
+            index += number();
+            course.students.push_back(emails.at(index));
+        }
+        for (size_t i = number(); i > 0; --i) {
+            const string& email = emails.at(number());
+            course.grades.push_back({email, static_cast<int>(signedNumber())});
+        }
+        return course;
+    }
+
+public:
+    // Writes the courses of a term; they all must belong to it
+    static void write(const string& path, const string& term, const vector<const Course*>& courses) {
+        vector<string> table;
+        size_t raw = term.size();
+        for (const Course* course : courses) {
+            raw += course->getCourseName().size() + course->getTeacherEmail().size();
+            for (const auto& content : course->getContents()) {
+                raw += content.size();
+            }
+            for (const auto& student : course->getStudents()) {
+                table.push_back(student);
+                raw += student.size();
+            }
+            for (const auto& student : course->getGrades().students) {
+                table.push_back(student);
+                raw += student.size() + sizeof(int);
+            }
+        }
+        sort(table.begin(), table.end());
+        table.erase(unique(table.begin(), table.end()), table.end());
+        auto indexOf = [&table](const string& email) {
+            return static_cast<uint64_t>(lower_bound(table.begin(), table.end(), email) - table.begin());
+        };
+
+        string out(MAGIC, sizeof(MAGIC));
+        putString(out, term);
+        appendVarint(out, raw);
+        appendVarint(out, table.size());
+        for (size_t i = 0; i < table.size(); ++i) {
+            size_t shared = 0;
+            if (i > 0) {
+                size_t limit = min(table[i].size(), table[i - 1].size());
+                while (shared < limit && table[i][shared] == table[i - 1][shared]) {
+                    ++shared;
+                }
+            }
+            appendVarint(out, shared);
+            putString(out, table[i].substr(shared));
+        }
+
+        appendVarint(out, courses.size());
+        for (const Course* course : courses) {
+            string record;
+            appendVarint(record, course->getId());
+            putString(record, course->getCourseName());
+            putString(record, course->getTeacherEmail());
+            appendVarint(record, course->getContents().size());
+            for (const auto& content : course->getContents()) {
+                putString(record, content);
+            }
+            vector<uint64_t> roster;
+            for (const auto& student : course->getStudents()) {
+                roster.push_back(indexOf(student));
+            }
+            sort(roster.begin(), roster.end());
+            appendVarint(record, roster.size());
+            uint64_t previous = 0;
+            for (uint64_t index : roster) {
+                appendVarint(record, index - previous);
+                previous = index;
+            }
+            GradeColumns grades = course->getGrades();
+            appendVarint(record, grades.size());
+            for (size_t i = 0; i < grades.size(); ++i) {
+                appendVarint(record, indexOf(grades.students[i]));
+                appendSignedVarint(record, grades.values[i]);
+            }
+            appendVarint(out, record.size());
+            out += record;
+        }
+
+        // The term's courses are dropped from memory next, so the archive must be on disk first
+        AsyncIo::shared().writeFile(path, move(out), Durability::Synced);
+    }
+
+    // Reads the email table and the course offsets; courses decode on demand
+    explicit TermArchive(const string& path) {
+        ifstream file(path, ios::binary);
+        if (!file) {
+            throw runtime_error("Cannot open term archive: " + path);
+        }
+        data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        if (data.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+            throw runtime_error("Not a term archive: " + path);
+        }
+        pos = sizeof(MAGIC);
+        term = text();
+        rawBytes = number();
+        emails.resize(number());
+        for (size_t i = 0; i < emails.size(); ++i) {
+            size_t shared = number();
+            if (i == 0 ? shared != 0 : shared > emails[i - 1].size()) {
+                throw runtime_error("Corrupt term archive");
+            }
+            emails[i] = (i == 0 ? string() : emails[i - 1].substr(0, shared)) + text();
+        }
+        for (size_t i = number(); i > 0; --i) {
+            size_t length = number();
+            courseStarts.push_back(pos);
+            pos += length;
+        }
+    }
+
+    const string& getTerm() const { return term; }
+    size_t courseCount() const { return courseStarts.size(); }
+    size_t studentCount() const { return emails.size(); }
+    size_t storedBytes() const { return data.size(); }
+    size_t plainBytes() const { return rawBytes; }
+
+    ArchivedCourse course(size_t index) { return readCourse(courseStarts.at(index)); }
+
+    optional<ArchivedCourse> findCourse(const string& name) {
+        for (size_t start : courseStarts) {
+            ArchivedCourse course = readCourse(start);
+            if (course.name == name) {
+                return course;
+            }
+        }
+        return nullopt;
+    }
+
+    // Every grade the student received this term, as (course name, grade).
+    // Compares table indexes only, so rosters and contents are skipped unread.
+    vector<pair<string, int>> transcript(const string& email) {
+        vector<pair<string, int>> grades;
+        auto found = lower_bound(emails.begin(), emails.end(), email);
+        if (found == emails.end() || *found != email) {
+            return grades; // Not in any roster of this term
+        }
+        uint64_t wanted = found - emails.begin();
+        for (size_t start : courseStarts) {
+            pos = start;
+            number(); // Course ID
+            string name = text();
+            skipText();
+            for (size_t i = number(); i > 0; --i) {
+                skipText();
+            }
+            for (size_t i = number(); i > 0; --i) {
+                number();
+            }
+            for (size_t i = number(); i > 0; --i) {
+                uint64_t index = number();
+                int64_t grade = signedNumber();
+                if (index == wanted) {
+                    grades.push_back({name, static_cast<int>(grade)});
+                }
+            }
+        }
+        return grades;
+    }
+};
+
+class LMSManager {
+private:
+    vector<Course> courses;
+    friend class Institution; // Each institution owns exactly one manager
+    friend class LogRecovery; // Installs the courses and indexes of a parallel replay
+    LMSManager() = default;
+
+    int nextCourseId = 0;
+    vector<CourseBitset> prerequisiteClosure;              // course ID -> all courses required first
+    unordered_map<string, CourseBitset> completedCourses;  // student email -> passed course IDs
+    unordered_map<string, StudentTimetable> timetables;    // student email -> enrolled meeting times
+
+    // Dense student IDs and one enrollment bitmap per course ID for set-algebra queries
+    unordered_map<string, uint32_t> studentIds;
+    vector<string> studentEmails;       // student ID -> email
+    vector<RoaringBitmap> enrollmentBitmaps;
+    RoaringBitmap registeredStudents;   // every student account, the universe for "none of" queries
+    CoEnrollmentIndex coEnrollment;     // "students who took X also took Y"
+    Leaderboard leaderboard;            // Students ranked by average grade
+
+    // Academic terms. Only courses of open terms are kept in `courses`; a closed
+    // term lives in one archive file under archiveDirectory.
+    string activeTerm = "Term 1";                     // New courses are created in this term
+    vector<string> closedTerms;                       // Oldest first
+    unordered_map<int, string> archivedCourseNames;   // course ID -> name, still usable as a prerequisite
+    string archiveDirectory = "lms-archive";
+    GradeStore* gradeStore = nullptr; // Holds the open courses' rosters and grades when set
+
+    // Keeps the enrollment bitmaps and co-enrollment counts in step with the rosters
+    void trackEnrollment(int courseId, const string& studentEmail, bool enrolled) {
+        uint32_t id = studentId(studentEmail);
+        if (enrolled) {
+            enrollmentBitmaps[courseId].add(id);
+            coEnrollment.add(courseId, id);
+        } else {
+            enrollmentBitmaps[courseId].remove(id);
+            coEnrollment.remove(courseId, id);
+        }
+    }
+
+    void checkTimeConflict(const Course& course, const string& studentEmail) {
+        auto timetable = timetables.find(studentEmail);
+        if (timetable == timetables.end()) {
+            return;
+        }
+        int conflict = timetable->second.findConflict(course.getSchedule());
+        if (conflict != -1) {
+            Course* other = findCourseById(conflict);
+            throw ValidationException("Time conflict with " + (other ? other->getCourseName() : string("another course")));
+        }
+    }
+
+    void addPromoted(const Course& course, const vector<string>& promoted) {
+        for (const auto& studentEmail : promoted) {
+            timetables[studentEmail].addCourse(course.getId(), course.getSchedule());
+            trackEnrollment(course.getId(), studentEmail, true);
+        }
+    }
+
+    // Depth-first closure of one course; returns false on a cycle
+    bool buildClosure(int id, vector<Course*>& byId, vector<char>& state, vector<CourseBitset>& closure) {
+        if (state[id] == 2) {
+            return true;
+        }
+        if (state[id] == 1) {
+            return false; // Reached a course that is still being expanded
+        }
+        state[id] = 1;
+        for (int prerequisite : byId[id]->getPrerequisites()) {
+            if (!byId[prerequisite] && archivedCourseNames.count(prerequisite)) {
+                closure[prerequisite] = prerequisiteClosure[prerequisite]; // Fixed when its term closed
+                closure[id].set(prerequisite);
+                closure[id].orWith(closure[prerequisite]);
+                continue;
+            }
+            if (!byId[prerequisite] || !buildClosure(prerequisite, byId, state, closure)) {
+                return false;
+            }
+            closure[id].set(prerequisite);
+            closure[id].orWith(closure[prerequisite]);
+        }
+        state[id] = 2;
+        return true;
+    }
+
+    bool rebuildPrerequisiteClosure() {
+        vector<Course*> byId(nextCourseId, nullptr);
+        for (auto& course : courses) {
+            byId[course.getId()] = &course;
+        }
+        vector<char> state(nextCourseId, 0);
+        vector<CourseBitset> closure(nextCourseId);
+        for (auto& course : courses) {
+            if (!buildClosure(course.getId(), byId, state, closure)) {
+                return false;
+            }
+        }
+        prerequisiteClosure.swap(closure);
+        return true;
+    }
+
+public:
+    static const int PASSING_GRADE = 75; // A grade at or above this completes the course
+
+    // The manager of the institution bound to this thread
+    static LMSManager* getInstance();
+
+    // Drops every course of that institution, leaving an empty manager
+    static void resetInstance();
+
+    // Mutators: every change goes through these so it reaches the mutation log
+    void addCourse(const Course& course) {
+        if (findCourse(course.getCourseName())) {
+            throw ValidationException("A course with this name already exists");
+        }
+        courses.push_back(course);
+        courses.back().setId(nextCourseId++);
+        courses.back().setPrerequisites({});
+        if (course.getTerm().empty()) {
+            courses.back().setTerm(activeTerm);
+        } else if (find(closedTerms.begin(), closedTerms.end(), course.getTerm()) != closedTerms.end()) {
+            courses.pop_back();
+            --nextCourseId;
+            throw ValidationException("Term " + course.getTerm() + " is closed");
+        }
+        courses.back().useStore(gradeStore);
+        prerequisiteClosure.resize(nextCourseId);
+        enrollmentBitmaps.resize(nextCourseId);
+        for (const auto& studentEmail : course.getStudents()) {
+            timetables[studentEmail].addCourse(courses.back().getId(), course.getSchedule());
+            trackEnrollment(courses.back().getId(), studentEmail, true);
+        }
+        GradeColumns grades = course.getGrades();
+        for (size_t i = 0; i < grades.size(); ++i) {
+            leaderboard.addGrade(studentId(grades.students[i]), grades.values[i]);
+            if (grades.values[i] >= PASSING_GRADE) {
+                completedCourses[grades.students[i]].set(courses.back().getId());
+            }
+        }
+        mutationLog().append("ADD_COURSE", {course.getCourseName(), course.getTeacherEmail(), courses.back().getTerm()});
+        for (const auto& content : course.getContents()) {
+            mutationLog().append("ADD_CONTENT", {course.getCourseName(), content});
+        }
+        for (const auto& student : course.getStudents()) {
+            mutationLog().append("ENROLL", {course.getCourseName(), student});
+        }
+        for (size_t i = 0; i < grades.size(); ++i) {
+            mutationLog().append("GRADE", {course.getCourseName(), grades.students[i], to_string(grades.values[i])});
+        }
+        if (course.getCapacity() != 0) {
+            mutationLog().append("SET_CAPACITY", {course.getCourseName(), to_string(course.getCapacity())});
+        }
+    }
+
+    void addContent(Course& course, const string& content) {
+        course.addContent(content);
+        mutationLog().append("ADD_CONTENT", {course.getCourseName(), content});
+    }
+
+    void removeContent(Course& course, int index) {
+        course.removeContent(index);
+        mutationLog().append("REMOVE_CONTENT", {course.getCourseName(), to_string(index)});
+    }
+
+    void enrollStudent(Course& course, const string& studentEmail) {
+        checkTimeConflict(course, studentEmail);
+        course.enrollStudent(studentEmail);
+        timetables[studentEmail].addCourse(course.getId(), course.getSchedule());
+        trackEnrollment(course.getId(), studentEmail, true);
+        mutationLog().append("ENROLL", {course.getCourseName(), studentEmail});
+    }
+
+    // Promotions from the waitlist are deterministic, so only the drop is logged
+    vector<string> removeStudent(Course& course, const string& studentEmail) {
+        vector<string> promoted = course.removeStudent(studentEmail);
+        timetables[studentEmail].removeCourse(course.getId());
+        trackEnrollment(course.getId(), studentEmail, false);
+        addPromoted(course, promoted);
+        mutationLog().append("UNENROLL", {course.getCourseName(), studentEmail});
+        return promoted;
+    }
+
+    // Conflicts are checked when joining; a promotion later takes the seat as is
+    size_t joinWaitlist(Course& course, const string& studentEmail) {
+        checkTimeConflict(course, studentEmail);
+        size_t position = course.joinWaitlist(studentEmail);
+        studentId(studentEmail);
+        mutationLog().append("WAITLIST", {course.getCourseName(), studentEmail});
+        return position;
+    }
+
+    void leaveWaitlist(Course& course, const string& studentEmail) {
+        course.leaveWaitlist(studentEmail);
+        mutationLog().append("LEAVE_WAITLIST", {course.getCourseName(), studentEmail});
+    }
+
+    // An open course taught by, or enrolling or waitlisting, the account
+    const Course* findCourseUsing(const string& email) const {
+        for (const auto& course : courses) {
+            if (course.getTeacherEmail() == email || course.isEnrolled(email) || course.isWaitlisted(email)) {
+                return &course;
+            }
+        }
+        return nullptr;
+    }
+
+    // Enrolls the student, or queues them when the course is full.
+    // Returns 0 when enrolled, otherwise the waitlist position; a student
+    // already waiting keeps their place and gets it back.
+    size_t enrollOrWaitlist(Course& course, const string& studentEmail) {
+        if (size_t position = course.waitlistPosition(studentEmail)) {
+            return position;
+        }
+        checkPrerequisites(course, studentEmail);
+        if (course.isFull()) {
+            return joinWaitlist(course, studentEmail);
+        }
+        enrollStudent(course, studentEmail);
+        return 0;
+    }
+
+    vector<string> setCapacity(Course& course, size_t capacity) {
+        vector<string> promoted = course.setCapacity(capacity);
+        addPromoted(course, promoted);
+        mutationLog().append("SET_CAPACITY", {course.getCourseName(), to_string(capacity)});
+        return promoted;
+    }
+
+    void addGrade(Course& course, const string& studentEmail, int grade) {
+        course.addGrade(studentEmail, grade);
+        leaderboard.addGrade(studentId(studentEmail), grade);
+        if (grade >= PASSING_GRADE) {
+            completedCourses[studentEmail].set(course.getId());
+        }
+        mutationLog().append("GRADE", {course.getCourseName(), studentEmail, to_string(grade)});
+    }
+
+    // Transforms every grade of the course at once and logs it as one CURVE record
+    void curveGrades(Course& course, const GradeTransform& transform) {
+        vector<int> previous = course.getGrades().values;
+        course.transformGrades(transform);
+        GradeColumns curved = course.getGrades(); // Same order as before the curve
+        for (size_t i = 0; i < curved.size(); ++i) {
+            leaderboard.changeGrade(studentId(curved.students[i]), previous[i], curved.values[i]);
+            completedCourses[curved.students[i]].reset(course.getId());
+        }
+        // Reset first: a student with several grades passes if any of them does
+        for (size_t i = 0; i < curved.size(); ++i) {
+            if (curved.values[i] >= PASSING_GRADE) {
+                completedCourses[curved.students[i]].set(course.getId());
+            }
+        }
+        ostringstream first, second;
+        first << setprecision(17) << transform.first;
+        second << setprecision(17) << transform.second;
+        mutationLog().append("CURVE", {course.getCourseName(), GradeTransform::kindName(transform.kind),
+                                     first.str(), second.str()});
+    }
+
+    // Replaces the course's meeting times. Enrolled students keep their seat even
+    // if the new times clash; the conflicts report lists those cases.
+    void setSchedule(Course& course, const vector<TimeSlot>& slots) {
+        course.setSchedule(slots);
+        vector<string> fields = {course.getCourseName()};
+        for (const auto& slot : slots) {
+            fields.push_back(to_string(slot.day) + " " + to_string(slot.startMinute) + " " + to_string(slot.endMinute));
+        }
+        for (const auto& studentEmail : course.getStudents()) {
+            StudentTimetable& timetable = timetables[studentEmail];
+            timetable.removeCourse(course.getId());
+            timetable.addCourse(course.getId(), slots);
+        }
+        mutationLog().append("SET_SCHEDULE", fields);
+    }
+
+    const unordered_map<string, StudentTimetable>& getTimetables() const { return timetables; }
+
+    // Dense ID for a student email, assigned on first use. Every logged change
+    // that names a student (a student account, enrollment, waitlist or grade)
+    // uses it, and nothing else assigns one, so IDs follow the order students
+    // first appear in the log however it is replayed.
+    uint32_t studentId(const string& studentEmail) {
+        auto it = studentIds.find(studentEmail);
+        if (it != studentIds.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(studentEmails.size());
+        studentIds.emplace(studentEmail, id);
+        studentEmails.push_back(studentEmail);
+        return id;
+    }
+
+    // Lookup only; never assigns an ID
+    optional<uint32_t> findStudentId(const string& studentEmail) const {
+        auto it = studentIds.find(studentEmail);
+        return it == studentIds.end() ? nullopt : optional<uint32_t>(it->second);
+    }
+
+    void registerStudent(const string& studentEmail) { registeredStudents.add(studentId(studentEmail)); }
+    void unregisterStudent(const string& studentEmail) { registeredStudents.remove(studentId(studentEmail)); }
+
+    enum class EnrollmentQuery { Both, Either, FirstOnly, Neither };
+
+    // Students matching a set expression over two course rosters
+    RoaringBitmap queryEnrollment(const Course& first, const Course& second, EnrollmentQuery query) const {
+        const RoaringBitmap& a = enrollmentBitmaps[first.getId()];
+        const RoaringBitmap& b = enrollmentBitmaps[second.getId()];
+        switch (query) {
+            case EnrollmentQuery::Both:
+                return RoaringBitmap::intersect(a, b);
+            case EnrollmentQuery::Either:
+                return RoaringBitmap::unite(a, b);
+            case EnrollmentQuery::FirstOnly:
+                return RoaringBitmap::subtract(a, b);
+            case EnrollmentQuery::Neither:
+                return RoaringBitmap::subtract(registeredStudents, RoaringBitmap::unite(a, b));
+        }
+        return RoaringBitmap();
+    }
+
+    // Number of students each other course shares with this one, largest first
+    vector<pair<const Course*, size_t>> coEnrollmentCounts(const Course& course) const {
+        vector<pair<const Course*, size_t>> counts;
+        const RoaringBitmap& roster = enrollmentBitmaps[course.getId()];
+        for (const auto& other : courses) {
+            if (other.getId() == course.getId()) {
+                continue;
+            }
+            size_t shared = RoaringBitmap::intersectionSize(roster, enrollmentBitmaps[other.getId()]);
+            if (shared > 0) {
+                counts.push_back({&other, shared});
+            }
+        }
+        sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        return counts;
+    }
+
+    // Ranked courses this student is not in yet, from co-enrollment counts
+    vector<CoEnrollmentIndex::Recommendation> recommendCourses(const string& studentEmail, size_t limit) {
+        optional<uint32_t> id = findStudentId(studentEmail);
+        return id ? coEnrollment.recommend(*id, limit) : vector<CoEnrollmentIndex::Recommendation>();
+    }
+
+    // Full recomputation; normal changes keep the counts current incrementally
+    void refreshRecommendations() { coEnrollment.rebuild(); }
+
+    const Leaderboard& getLeaderboard() const { return leaderboard; }
+    // 0 when the student has no grades or is unknown
+    size_t rankOf(const string& studentEmail) const {
+        optional<uint32_t> id = findStudentId(studentEmail);
+        return id ? leaderboard.rank(*id) : 0;
+    }
+    const string& studentEmailById(uint32_t id) const { return studentEmails[id]; }
+
+    vector<string> studentEmailsOf(const RoaringBitmap& students, size_t limit = SIZE_MAX) const {
+        vector<string> emails;
+        for (uint32_t id : students.toVector(limit)) {
+            emails.push_back(studentEmails[id]);
+        }
+        return emails;
+    }
+
+    // Replaces the course's direct prerequisites; rejects unknown courses and cycles
+    void setPrerequisites(Course& course, const vector<int>& prerequisiteIds) {
+        vector<string> names = {course.getCourseName()};
+        for (int id : prerequisiteIds) {
+            Course* prerequisite = findCourseById(id);
+            if (!prerequisite || id == course.getId()) {
+                throw ValidationException("Invalid prerequisite course");
+            }
+            names.push_back(prerequisite->getCourseName());
+        }
+
+        vector<int> previous = course.getPrerequisites();
+        course.setPrerequisites(prerequisiteIds);
+        if (!rebuildPrerequisiteClosure()) {
+            course.setPrerequisites(previous);
+            rebuildPrerequisiteClosure();
+            throw ValidationException("Prerequisites would form a cycle");
+        }
+        mutationLog().append("SET_PREREQUISITES", names);
+    }
+
+    bool meetsPrerequisites(const Course& course, const string& studentEmail) const {
+        const CourseBitset& required = prerequisiteClosure[course.getId()];
+        if (required.none()) {
+            return true;
+        }
+        auto completed = completedCourses.find(studentEmail);
+        return completed != completedCourses.end() && required.isSubsetOf(completed->second);
+    }
+
+    // Throws with the names of every missing course, direct or transitive
+    void checkPrerequisites(const Course& course, const string& studentEmail) {
+        if (meetsPrerequisites(course, studentEmail)) {
+            return;
+        }
+        static const CourseBitset nothingCompleted;
+        auto completed = completedCourses.find(studentEmail);
+        vector<int> missing = prerequisiteClosure[course.getId()].missingFrom(
+            completed == completedCourses.end() ? nothingCompleted : completed->second);
+        string message = "Missing prerequisites:";
+        for (int id : missing) {
+            message += " " + courseName(id);
+        }
+        throw ValidationException(message);
+    }
+
+    Course* findCourseById(int id) {
+        for (auto& course : courses) {
+            if (course.getId() == id) {
+                return &course;
+            }
+        }
+        return nullptr;
+    }
+
+    Course* findCourse(const string& courseName) {
+        for (auto& course : courses) {
+            if (course.getCourseName() == courseName) {
+                return &course;
+            }
+        }
+        return nullptr;
+    }
+
+    Course& requireCourse(const string& courseName) {
+        Course* course = findCourse(courseName);
+        if (!course) {
+            throw ValidationException("Course not found: " + courseName);
+        }
+        return *course;
+    }
+
+    Course& getCourse(int index) {
+        if (!Validator::isValidIndex(index, courses.size())) {
+            throw InvalidCourseIndexException();
+        }
+        return courses[index];
+    }
+
+    void removeCourse(int index) {
+        if (!Validator::isValidIndex(index, courses.size())) {
+            throw InvalidCourseIndexException();
+        }
+        string courseName = courses[index].getCourseName();
+        dropCourse(index);
+        mutationLog().append("REMOVE_COURSE", {courseName});
+    }
+
+    void removeCourse(const string& courseName) {
+        for (size_t i = 0; i < courses.size(); ++i) {
+            if (courses[i].getCourseName() == courseName) {
+                removeCourse(i);
+                return;
+            }
+        }
+        throw ValidationException("Course not found: " + courseName);
+    }
+
+    const string& getActiveTerm() const { return activeTerm; }
+    const vector<string>& getClosedTerms() const { return closedTerms; }
+
+    // Terms that still have courses in memory, the active one first
+    vector<string> getOpenTerms() const {
+        vector<string> terms = {activeTerm};
+        for (const auto& course : courses) {
+            if (find(terms.begin(), terms.end(), course.getTerm()) == terms.end()) {
+                terms.push_back(course.getTerm());
+            }
+        }
+        return terms;
+    }
+
+    bool isClosedTerm(const string& term) const {
+        return find(closedTerms.begin(), closedTerms.end(), term) != closedTerms.end();
+    }
+
+    // Moves every open course's rows into the store, or back into memory for null
+    void setGradeStore(GradeStore* store) {
+        gradeStore = store;
+        for (auto& course : courses) {
+            course.useStore(store);
+        }
+    }
+
+    GradeStore* getGradeStore() const { return gradeStore; }
+
+    void setArchiveDirectory(const string& directory) { archiveDirectory = directory; }
+    const string& getArchiveDirectory() const { return archiveDirectory; }
+
+    string archivePath(const string& term) const {
+        string fileName;
+        for (char c : term) {
+            fileName += isalnum(static_cast<unsigned char>(c)) || c == '-' ? c : '_';
+        }
+        return archiveDirectory + "/" + fileName + ".term";
+    }
+
+    // Makes a new term the one new courses go into; earlier terms stay open
+    void startTerm(const string& term) {
+        if (!Validator::isValidString(term)) {
+            throw ValidationException("Invalid term name");
+        }
+        vector<string> open = getOpenTerms();
+        if (isClosedTerm(term) || find(open.begin(), open.end(), term) != open.end()) {
+            throw ValidationException("Term " + term + " already exists");
+        }
+        activeTerm = term;
+        mutationLog().append("START_TERM", {term});
+    }
+
+    // Writes every course of the term to its archive and drops them from memory,
+    // along with their rosters, grades, waitlists and index entries. Their
+    // grades still count on the leaderboard. Returns how many courses were
+    // archived.
+    size_t closeTerm(const string& term) {
+        if (term == activeTerm) {
+            throw ValidationException("Start the next term before closing the active one");
+        }
+        if (isClosedTerm(term)) {
+            throw ValidationException("Term " + term + " is already closed");
+        }
+        vector<const Course*> closing;
+        for (const auto& course : courses) {
+            if (course.getTerm() == term) {
+                closing.push_back(&course);
+            }
+        }
+        if (closing.empty()) {
+            throw ValidationException("Term " + term + " has no courses");
+        }
+
+        filesystem::create_directories(archiveDirectory);
+        TermArchive::write(archivePath(term), term, closing);
+
+        size_t archived = closing.size();
+        for (size_t i = courses.size(); i-- > 0;) {
+            if (courses[i].getTerm() == term) {
+                archivedCourseNames[courses[i].getId()] = courses[i].getCourseName();
+                dropCourse(i);
+            }
+        }
+        closedTerms.push_back(term);
+        mutationLog().append("CLOSE_TERM", {term});
+        return archived;
+    }
+
+    TermArchive openArchive(const string& term) const {
+        if (!isClosedTerm(term)) {
+            throw ValidationException("Term " + term + " is not closed");
+        }
+        return TermArchive(archivePath(term));
+    }
+
+    // Name of an open or archived course, for prerequisite lists
+    string courseName(int id) {
+        if (Course* course = findCourseById(id)) {
+            return course->getCourseName();
+        }
+        auto archived = archivedCourseNames.find(id);
+        return archived != archivedCourseNames.end() ? archived->second : "#" + to_string(id);
+    }
+
+private:
+    // Removes a course and its index entries without logging it
+    void dropCourse(int index) {
+        int removedId = courses[index].getId();
+        for (const auto& studentEmail : courses[index].getStudents()) {
+            timetables[studentEmail].removeCourse(removedId);
+            trackEnrollment(removedId, studentEmail, false);
+        }
+        bool archived = archivedCourseNames.count(removedId) > 0;
+        if (!archived) {
+            GradeColumns grades = courses[index].getGrades();
+            for (size_t i = 0; i < grades.size(); ++i) {
+                leaderboard.removeGrade(studentId(grades.students[i]), grades.values[i]);
+            }
+        }
+        courses[index].useStore(nullptr); // Erases its rows from the grade store
+        courses.erase(courses.begin() + index);
+
+        // An archived course keeps its closure, its leaderboard grades and stays
+        // a prerequisite of later courses; other courses can no longer require a
+        // deleted one
+        if (archived) {
+            return;
+        }
+        bool prerequisitesChanged = false;
+        for (auto& course : courses) {
+            vector<int> remaining;
+            for (int id : course.getPrerequisites()) {
+                if (id != removedId) {
+                    remaining.push_back(id);
+                }
+            }
+            if (remaining.size() != course.getPrerequisites().size()) {
+                course.setPrerequisites(remaining);
+                prerequisitesChanged = true;
+            }
+        }
+        if (prerequisitesChanged) {
+            rebuildPrerequisiteClosure();
+        } else {
+            prerequisiteClosure[removedId] = CourseBitset();
+        }
+    }
+
+public:
+
+    void displayCourses(ostream& out = cout) const {
+        if (courses.empty()) {
+            out << "There are no courses available.\n";
+            return;
+        }
+        for (size_t i = 0; i < courses.size(); ++i) {
+            out << i + 1 << ": " << courses[i].getCourseName()
+                 << " (Teacher: " << courses[i].getTeacherEmail() << ")" << endl;
+        }
+    }
+
+    vector<Course>& getCourses() { return courses; }
+};
+
+void registerStudentAccount(const string& email, bool registered) {
+    if (registered) {
+        LMSManager::getInstance()->registerStudent(email);
+    } else {
+        LMSManager::getInstance()->unregisterStudent(email);
+    }
+}
+
+// Meeting times of a SET_SCHEDULE record, one "day start end" field after the course name
+vector<TimeSlot> scheduleFromFields(const vector<string>& fields) {
+    vector<TimeSlot> slots;
+    for (size_t i = 1; i < fields.size(); ++i) {
+        istringstream slot(fields[i]);
+        int day, startMinute, endMinute;
+        slot >> day >> startMinute >> endMinute;
+        slots.push_back(TimeSlot(day, startMinute, endMinute));
+    }
+    return slots;
+}
+
+// The transform of a CURVE record: course name, kind and two parameters
+GradeTransform curveFromFields(const vector<string>& fields) {
+    GradeTransform transform;
+    transform.kind = GradeTransform::parseKind(fields[1]);
+    transform.first = stod(fields[2]);
+    transform.second = stod(fields[3]);
+    return transform;
+}
+
+// Applies one mutation log record to this process without logging it again
+void applyLogRecord(const LogRecord& record) {
+    const vector<string>& fields = record.fields;
+    auto requireFields = [&record, &fields](size_t count) {
+        if (fields.size() != count) {
+            throw runtime_error("Bad field count in log record " + to_string(record.sequence));
+        }
+    };
+
+    LMSManager* lms = LMSManager::getInstance();
+    mutationLog().setApplying(true);
+    try {
+        if (record.operation == "ADD_USER") {
+            requireFields(4);
+            if (fields[0] == "admin") {
+                addUser(Admin(fields[1], fields[2], fields[3]));
+            } else if (fields[0] == "teacher") {
+                addUser(Teacher(fields[1], fields[2], fields[3]));
+            } else {
+                addUser(Student(fields[1], fields[2], fields[3]));
+            }
+        } else if (record.operation == "REMOVE_USER") {
+            requireFields(1);
+            removeUser(fields[0]);
+        } else if (record.operation == "ADD_COURSE") {
+            if (fields.size() != 2) {
+                requireFields(3); // Logs from before terms have no term field
+            }
+            Course course(fields[0], fields[1]);
+            course.setTerm(fields.size() == 3 ? fields[2] : lms->getActiveTerm());
+            lms->addCourse(course);
+        } else if (record.operation == "REMOVE_COURSE") {
+            requireFields(1);
+            lms->removeCourse(fields[0]);
+        } else if (record.operation == "START_TERM") {
+            requireFields(1);
+            lms->startTerm(fields[0]);
+        } else if (record.operation == "CLOSE_TERM") {
+            requireFields(1);
+            lms->closeTerm(fields[0]);
+        } else if (record.operation == "ADD_CONTENT") {
+            requireFields(2);
+            lms->addContent(lms->requireCourse(fields[0]), fields[1]);
+        } else if (record.operation == "REMOVE_CONTENT") {
+            requireFields(2);
+            lms->removeContent(lms->requireCourse(fields[0]), stoi(fields[1]));
+        } else if (record.operation == "ENROLL") {
+            requireFields(2);
+            lms->enrollStudent(lms->requireCourse(fields[0]), fields[1]);
+        } else if (record.operation == "UNENROLL") {
+            requireFields(2);
+            lms->removeStudent(lms->requireCourse(fields[0]), fields[1]);
+        } else if (record.operation == "WAITLIST") {
+            requireFields(2);
+            lms->joinWaitlist(lms->requireCourse(fields[0]), fields[1]);
+        } else if (record.operation == "LEAVE_WAITLIST") {
+            requireFields(2);
+            lms->leaveWaitlist(lms->requireCourse(fields[0]), fields[1]);
+        } else if (record.operation == "SET_CAPACITY") {
+            requireFields(2);
+            lms->setCapacity(lms->requireCourse(fields[0]), stoul(fields[1]));
+        } else if (record.operation == "SET_PREREQUISITES") {
+            if (fields.empty()) {
+                throw runtime_error("Bad field count in log record " + to_string(record.sequence));
+            }
+            vector<int> prerequisiteIds;
+            for (size_t i = 1; i < fields.size(); ++i) {
+                prerequisiteIds.push_back(lms->requireCourse(fields[i]).getId());
+            }
+            lms->setPrerequisites(lms->requireCourse(fields[0]), prerequisiteIds);
+        } else if (record.operation == "SET_SCHEDULE") {
+            if (fields.empty()) {
+                throw runtime_error("Bad field count in log record " + to_string(record.sequence));
+            }
+            lms->setSchedule(lms->requireCourse(fields[0]), scheduleFromFields(fields));
+        } else if (record.operation == "GRADE") {
+            requireFields(3);
+            lms->addGrade(lms->requireCourse(fields[0]), fields[1], stoi(fields[2]));
+        } else if (record.operation == "CURVE") {
+            requireFields(4);
+            lms->curveGrades(lms->requireCourse(fields[0]), curveFromFields(fields));
+        } else {
+            throw runtime_error("Unknown log operation: " + record.operation);
+        }
+    } catch (...) {
+        mutationLog().setApplying(false);
+        throw;
+    }
+    mutationLog().setApplying(false);
+}
+
+// Where a parallel recovery spent its time. Partitioning is sequential, as
+// is part of install(); only parsing, the per-course replay and the index
+// rebuilds spread over the pool.
+struct RecoveryPhases {
+    double parseMs = 0;
+    double partitionMs = 0;
+    double replayMs = 0;
+    double installMs = 0;
+};
+
+// Replays serialized log records into the bound institution and keeps them in
+// its log, with the course records split across `pool` (see LogRecovery)
+RecoveryPhases recoverLog(const vector<string>& lines, ThreadPool& pool);
+
+// One tenant of the process: an institution's accounts, email prefilter,
+// login throttle, mutation log and LMSManager with its indexes and node pools.
+// Nothing is shared between institutions, so several can be served and
+// snapshotted on separate threads. Code reaches the institution bound to its
+// thread through the accessors below; threads that bind none use the default
+// institution, which is what the console program runs on.
+class Institution {
+private:
+    string name;
+    MutationLog log;
+    BloomFilter emailFilter;
+    UserLookupStats lookupStats;
+    LoginThrottle throttle;
+    UserTable accounts;
+    string emailIndexPath;
+    unique_ptr<EmailBTree> emailIndex;
+    unique_ptr<GradeStore> gradeStore; // Outlives the manager that writes to it
+    unique_ptr<LMSManager> lms;
+
+    static thread_local Institution* bound;
+
+    // Each institution archives its closed terms under its own directory
+    LMSManager* newManager() const {
+        LMSManager* manager = new LMSManager();
+        manager->setArchiveDirectory("lms-archive/" + name);
+        manager->setGradeStore(gradeStore.get());
+        return manager;
+    }
+
+    friend MutationLog& mutationLog();
+    friend BloomFilter& userEmailFilter();
+    friend UserLookupStats& userLookupStats();
+    friend LoginThrottle& loginThrottle();
+    friend UserTable& users();
+    friend EmailBTree* userEmailIndex();
+    friend class LMSManager;
+
+public:
+    explicit Institution(string name) : name(move(name)), lms(newManager()) {}
+
+    Institution(const Institution&) = delete;
+    Institution& operator=(const Institution&) = delete;
+
+    const string& getName() const { return name; }
+
+    static Institution& defaultInstitution() {
+        static Institution institution("default");
+        return institution;
+    }
+
+    static Institution& current() {
+        return bound ? *bound : defaultInstitution();
+    }
+
+    // Binds an institution to the calling thread until the scope ends
+    class Scope {
+    private:
+        Institution* previous;
+
+    public:
+        explicit Scope(Institution& institution) : previous(bound) { bound = &institution; }
+        ~Scope() { bound = previous; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Replaces the account table's in-memory email index with a B+tree file.
+    // The file is truncated, rebuilt from the current accounts and kept in step
+    // by the table afterwards. It is never synced: after a crash, startup
+    // rebuilds it from the accounts the log recovers.
+    void attachUserIndex(const string& path, size_t poolPages = 256) {
+        emailIndexPath = path;
+        accounts.useIndex(nullptr);
+        emailIndex.reset();
+        emailIndex.reset(new EmailBTree(path, poolPages));
+        accounts.useIndex(emailIndex.get());
+    }
+
+    // Moves every course's roster and grades into an LSM store under the
+    // directory, so they no longer have to fit in memory. Like the email index,
+    // the store starts empty and is filled from the courses, never reopened.
+    void attachGradeStore(const string& directory, size_t memtableRows = 1 << 16) {
+        lms->setGradeStore(nullptr);
+        gradeStore.reset();
+        gradeStore.reset(new GradeStore(directory, memtableRows));
+        lms->setGradeStore(gradeStore.get());
+    }
+
+    // Drops every account, course and log record. An attached email index file
+    // or grade store is emptied along with the rows it held.
+    void reset() {
+        accounts.clear();
+        if (emailIndex) {
+            accounts.useIndex(nullptr);
+            emailIndex.reset();
+            emailIndex.reset(new EmailBTree(emailIndexPath));
+            accounts.useIndex(emailIndex.get());
+        }
+        if (gradeStore) {
+            lms.reset();
+            string directory = gradeStore->getDirectory();
+            size_t memtableRows = gradeStore->getMemtableLimit();
+            gradeStore.reset();
+            gradeStore.reset(new GradeStore(directory, memtableRows));
+        }
+        lms.reset(newManager());
+        log.clear();
+        emailFilter.reset(0);
+        lookupStats = UserLookupStats();
+        throttle.clear();
+    }
+
+    // The mutation log is the whole state, so a snapshot is a copy of it
+    void saveSnapshot(const string& path) const {
+        ostringstream out;
+        log.writeTo(out);
+        AsyncIo::shared().writeFile(path, out.str(), Durability::Synced);
+    }
+
+    // Replays a snapshot into this institution, which should be empty. Given a
+    // pool, the whole file is read first and recovered course by course in
+    // parallel, and the time of each phase is returned.
+    RecoveryPhases loadSnapshot(const string& path, ThreadPool* pool = nullptr) {
+        ifstream file(path, ios::binary);
+        if (!file) {
+            throw runtime_error("Cannot open snapshot: " + path);
+        }
+        Scope scope(*this);
+        string line;
+        uint64_t bytes = 0;
+        // A record torn by a crash (no final newline, or zeros from a write that
+        // never completed) ends the log. Bytes are counted before a CR is dropped,
+        // so the log file is later cut exactly after the last good line.
+        auto readRecord = [&file, &line, &bytes] {
+            if (!getline(file, line) || file.eof() || line.find('\0') != string::npos) {
+                return false;
+            }
+            bytes += line.size() + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        };
+        if (!pool) {
+            while (readRecord()) {
+                if (line.empty()) {
+                    continue;
+                }
+                LogRecord record = LogRecord::parse(line);
+                applyLogRecord(record);
+                log.restore(line, record.sequence);
+            }
+            log.setRestoredBytes(bytes);
+            return RecoveryPhases();
+        }
+
+        vector<string> lines;
+        while (readRecord()) {
+            if (!line.empty()) {
+                lines.push_back(move(line));
+            }
+        }
+        RecoveryPhases phases = recoverLog(lines, *pool);
+        log.setRestoredBytes(bytes);
+        return phases;
+    }
+};
+
+thread_local Institution* Institution::bound = nullptr;
+
+MutationLog& mutationLog() { return Institution::current().log; }
+BloomFilter& userEmailFilter() { return Institution::current().emailFilter; }
+UserLookupStats& userLookupStats() { return Institution::current().lookupStats; }
+LoginThrottle& loginThrottle() { return Institution::current().throttle; }
+UserTable& users() { return Institution::current().accounts; }
+EmailBTree* userEmailIndex() { return Institution::current().emailIndex.get(); }
+
+LMSManager* LMSManager::getInstance() {
+    return Institution::current().lms.get();
+}
+
+void LMSManager::resetInstance() {
+    Institution& institution = Institution::current();
+    institution.lms.reset(institution.newManager());
+}
+
+// Work-stealing thread pool shared by every batch subsystem (imports, reports,
+// index rebuilds, benchmarks). Each worker owns a deque: it pops its own work
+// from the back and steals from the front of the others when it runs dry.
+class ThreadPool {
+private:
+    struct WorkerQueue {
+        deque<function<void()>> tasks;
+        mutex lock;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> workers;
+    atomic<bool> stopping{false};
+    atomic<size_t> queued{0};
+    atomic<size_t> nextQueue{0};
+    mutex sleepMutex;
+    condition_variable sleepReady;
+
+    static thread_local ThreadPool* currentPool;
+    static thread_local size_t currentWorker;
+
+    bool popLocal(size_t index, function<void()>& task) {
+        WorkerQueue& queue = *queues[index];
+        lock_guard<mutex> lock(queue.lock);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, function<void()>& task) {
+        for (size_t offset = 1; offset <= queues.size(); ++offset) {
+            WorkerQueue& victim = *queues[(thief + offset) % queues.size()];
+            lock_guard<mutex> lock(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        currentPool = this;
+        currentWorker = index;
+        while (true) {
+            if (tryRunOne()) {
+                continue;
+            }
+            unique_lock<mutex> lock(sleepMutex);
+            sleepReady.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threadCount = thread::hardware_concurrency()) {
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepReady.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    void submit(function<void()> task) {
+        // Workers push onto their own deque; outside threads spread work round-robin
+        size_t index = currentPool == this ? currentWorker : nextQueue++ % queues.size();
+        // Counted before it is visible, so a thief's decrement can never take the count below zero
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            ++queued;
+        }
+        {
+            lock_guard<mutex> lock(queues[index]->lock);
+            queues[index]->tasks.push_back(move(task));
+        }
+        sleepReady.notify_one();
+    }
+
+    // Run one queued task on the calling thread, if any. Used by waiting threads to help out.
+    bool tryRunOne() {
+        size_t index = currentPool == this ? currentWorker : 0;
+        function<void()> task;
+        if ((currentPool == this && popLocal(index, task)) || steal(index, task)) {
+            --queued;
+            task();
+            return true;
+        }
+        return false;
+    }
+};
+
+thread_local ThreadPool* ThreadPool::currentPool = nullptr;
+thread_local size_t ThreadPool::currentWorker = 0;
+
+// A set of tasks that can be waited on together. The waiting thread runs
+// queued tasks itself, so nested groups never deadlock the pool.
+class TaskGroup {
+private:
+    ThreadPool& pool;
+    atomic<size_t> outstanding{0};
+    mutex errorMutex;
+    exception_ptr firstError;
+
+public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::shared()) : pool(pool) {}
+
+    ~TaskGroup() {
+        while (outstanding > 0) {
+            if (!pool.tryRunOne()) {
+                this_thread::yield();
+            }
+        }
+    }
+
+    void run(function<void()> task) {
+        ++outstanding;
+        pool.submit([this, task] {
+            try {
+                task();
+            } catch (...) {
+                lock_guard<mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = current_exception();
+                }
+            }
+            --outstanding;
+        });
+    }
+
+    // Wait for every task, rethrowing the first exception one of them threw
+    void wait() {
+        while (outstanding > 0) {
+            if (!pool.tryRunOne()) {
+                this_thread::yield();
+            }
+        }
+        if (firstError) {
+            exception_ptr error = firstError;
+            firstError = nullptr;
+            rethrow_exception(error);
+        }
+    }
+};
+
+// Calls fn(i) for every i in [begin, end), in chunks of at least `grain` items
+template <typename Fn>
+void parallelFor(size_t begin, size_t end, Fn fn, size_t grain = 1,
+                 ThreadPool& pool = ThreadPool::shared()) {
+    if (begin >= end) {
+        return;
+    }
+    size_t chunks = pool.size() * 4;
+    size_t chunkSize = (end - begin + chunks - 1) / chunks;
+    if (chunkSize < grain) {
+        chunkSize = grain;
+    }
+
+    TaskGroup group(pool);
+    for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize) {
+        size_t chunkEnd = min(end, chunkBegin + chunkSize);
+        group.run([chunkBegin, chunkEnd, &fn] {
+            for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+                fn(i);
+            }
+        });
+    }
+    group.wait();
+}
+
+// Maps every i in [begin, end) and folds the results with combine
+template <typename T, typename Map, typename Combine>
+T parallelReduce(size_t begin, size_t end, T identity, Map map, Combine combine,
+                 size_t grain = 1, ThreadPool& pool = ThreadPool::shared()) {
+    if (begin >= end) {
+        return identity;
+    }
+    size_t chunks = pool.size() * 4;
+    size_t chunkSize = (end - begin + chunks - 1) / chunks;
+    if (chunkSize < grain) {
+        chunkSize = grain;
+    }
+
+    vector<T> partials((end - begin + chunkSize - 1) / chunkSize, identity);
+    TaskGroup group(pool);
+    for (size_t chunk = 0; chunk < partials.size(); ++chunk) {
+        group.run([chunk, begin, end, chunkSize, &partials, &map, &combine] {
+            size_t chunkBegin = begin + chunk * chunkSize;
+            size_t chunkEnd = min(end, chunkBegin + chunkSize);
+            T local = partials[chunk];
+            for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+                local = combine(local, map(i));
+            }
+            partials[chunk] = local;
+        });
+    }
+    group.wait();
+
+    T result = identity;
+    for (const T& partial : partials) {
+        result = combine(result, partial);
+    }
+    return result;
+}
+
+// Row-wise sparse product: course x's row sums, over x's students, the rows of
+// the student x course matrix. Each task accumulates into a dense scratch row.
+void CoEnrollmentIndex::rebuild() {
+    rebuild(ThreadPool::shared());
+}
+
+void CoEnrollmentIndex::rebuild(ThreadPool& pool) {
+    int courseCount = static_cast<int>(counts.size());
+    for (const auto& enrolled : studentCourses) {
+        for (int course : enrolled) {
+            courseCount = max(courseCount, course + 1);
+        }
+    }
+
+    // Transpose to course -> students
+    vector<vector<uint32_t>> courseStudents(courseCount);
+    for (uint32_t student = 0; student < studentCourses.size(); ++student) {
+        for (int course : studentCourses[student]) {
+            courseStudents[course].push_back(student);
+        }
+    }
+
+    vector<unordered_map<int, uint32_t>> rebuilt(courseCount);
+    parallelFor(0, courseCount, [this, &courseStudents, &rebuilt, courseCount](size_t course) {
+        thread_local vector<uint32_t> scratch;
+        thread_local vector<int> touched;
+        if (scratch.size() != static_cast<size_t>(courseCount)) {
+            scratch.assign(courseCount, 0);
+        }
+        touched.clear();
+        for (uint32_t student : courseStudents[course]) {
+            for (int other : studentCourses[student]) {
+                if (other != static_cast<int>(course) && scratch[other]++ == 0) {
+                    touched.push_back(other);
+                }
+            }
+        }
+        unordered_map<int, uint32_t>& row = rebuilt[course];
+        row.reserve(touched.size());
+        for (int other : touched) {
+            row.emplace(other, scratch[other]);
+            scratch[other] = 0;
+        }
+    }, 16, pool);
+    counts.swap(rebuilt);
+}
+
+// Startup recovery split by course. One sequential pass applies the account
+// and term records, numbers courses the way addCourse does and appends every
+// other course record to that course's stream. The streams are then replayed
+// concurrently, each into its own Course, and the manager's cross-course
+// indexes are rebuilt from the finished courses. Records passed validation
+// when they were first applied, so the streams skip the manager's checks.
+class LogRecovery {
+private:
+    // One course from its ADD_COURSE to its removal, archival or the end of the log
+    struct CourseStream {
+        const LogRecord* created = nullptr;
+        string term;
+        vector<const LogRecord*> records;
+        vector<int> prerequisites;     // Kept by the sequential pass, which sees removals
+        bool removed = false;
+        bool archived = false;
+        optional<Course> course;       // Filled in by the replay
+    };
+
+    LMSManager& lms;
+    ThreadPool& pool;
+    vector<CourseStream> streams;             // Course ID -> stream
+    unordered_map<string, int> openCourses;   // Course name -> ID, for courses not removed or archived
+    string activeTerm;
+    vector<string> closedTerms;
+    vector<CourseBitset> frozenClosure;       // Archived course ID -> closure when its term closed
+
+    static void requireFields(const LogRecord& record, size_t count) {
+        if (record.fields.size() < count) {
+            throw runtime_error("Bad field count in log record " + to_string(record.sequence));
+        }
+    }
+
+    int openCourse(const string& courseName) const {
+        auto it = openCourses.find(courseName);
+        if (it == openCourses.end()) {
+            throw ValidationException("Course not found: " + courseName);
+        }
+        return it->second;
+    }
+
+    // Same walk as LMSManager::buildClosure, over the prerequisite lists as they stand
+    void expandClosure(int id, vector<char>& expanded, vector<CourseBitset>& closure) const {
+        if (expanded[id]) {
+            return;
+        }
+        expanded[id] = 1;
+        for (int prerequisite : streams[id].prerequisites) {
+            if (!streams[prerequisite].archived) {
+                expandClosure(prerequisite, expanded, closure);
+            }
+            closure[id].set(prerequisite);
+            closure[id].orWith(streams[prerequisite].archived ? frozenClosure[prerequisite] : closure[prerequisite]);
+        }
+    }
+
+    void closeTerm(const string& term) {
+        vector<int> closing;
+        for (const auto& entry : openCourses) {
+            if (streams[entry.second].term == term) {
+                closing.push_back(entry.second);
+            }
+        }
+        if (closing.empty()) {
+            throw ValidationException("Term " + term + " has no courses");
+        }
+        vector<char> expanded(streams.size(), 0);
+        vector<CourseBitset> closure(streams.size());
+        frozenClosure.resize(streams.size());
+        for (int id : closing) {
+            expandClosure(id, expanded, closure);
+        }
+        for (int id : closing) {
+            frozenClosure[id] = closure[id];
+            streams[id].archived = true;
+            openCourses.erase(streams[id].created->fields[0]);
+        }
+        closedTerms.push_back(term);
+    }
+
+    // Sequential pass over the whole log
+    void partition(const vector<LogRecord>& records) {
+        for (const auto& record : records) {
+            const string& operation = record.operation;
+            const vector<string>& fields = record.fields;
+            if (operation == "ADD_USER" || operation == "REMOVE_USER") {
+                applyLogRecord(record);
+            } else if (operation == "ADD_COURSE") {
+                requireFields(record, 2);
+                if (openCourses.count(fields[0])) {
+                    throw ValidationException("A course with this name already exists");
+                }
+                openCourses[fields[0]] = static_cast<int>(streams.size());
+                streams.emplace_back();
+                streams.back().created = &record;
+                streams.back().term = fields.size() == 3 ? fields[2] : activeTerm;
+            } else if (operation == "REMOVE_COURSE") {
+                requireFields(record, 1);
+                int removedId = openCourse(fields[0]);
+                streams[removedId].removed = true;
+                openCourses.erase(fields[0]);
+                for (const auto& entry : openCourses) {
+                    vector<int>& prerequisites = streams[entry.second].prerequisites;
+                    prerequisites.erase(remove(prerequisites.begin(), prerequisites.end(), removedId), prerequisites.end());
+                }
+            } else if (operation == "START_TERM") {
+                requireFields(record, 1);
+                activeTerm = fields[0];
+            } else if (operation == "CLOSE_TERM") {
+                requireFields(record, 1);
+                closeTerm(fields[0]);
+            } else if (operation == "SET_PREREQUISITES") {
+                requireFields(record, 1);
+                vector<int> prerequisiteIds;
+                for (size_t i = 1; i < fields.size(); ++i) {
+                    prerequisiteIds.push_back(openCourse(fields[i]));
+                }
+                streams[openCourse(fields[0])].prerequisites = prerequisiteIds;
+            } else if (operation == "ADD_CONTENT" || operation == "REMOVE_CONTENT" || operation == "SET_CAPACITY" ||
+                       operation == "SET_SCHEDULE" || operation == "CURVE") {
+                requireFields(record, 1);
+                streams[openCourse(fields[0])].records.push_back(&record);
+            } else if (operation == "ENROLL" || operation == "UNENROLL" || operation == "WAITLIST" ||
+                       operation == "LEAVE_WAITLIST" || operation == "GRADE") {
+                requireFields(record, 2);
+                streams[openCourse(fields[0])].records.push_back(&record);
+                lms.studentId(fields[1]); // Where the sequential replay of this record assigns it
+            } else {
+                throw runtime_error("Unknown log operation: " + operation);
+            }
+        }
+    }
+
+    // Runs on a worker; touches nothing but the stream
+    static void replay(CourseStream& stream, int id) {
+        const vector<string>& created = stream.created->fields;
+        Course& course = stream.course.emplace(created[0], created[1]);
+        course.setId(id);
+        course.setTerm(stream.term);
+        course.setPrerequisites(stream.prerequisites);
+        for (const LogRecord* record : stream.records) {
+            const string& operation = record->operation;
+            const vector<string>& fields = record->fields;
+            if (operation == "ADD_CONTENT") {
+                requireFields(*record, 2);
+                course.addContent(fields[1]);
+            } else if (operation == "REMOVE_CONTENT") {
+                requireFields(*record, 2);
+                course.removeContent(stoi(fields[1]));
+            } else if (operation == "ENROLL") {
+                course.enrollStudent(fields[1]);
+            } else if (operation == "UNENROLL") {
+                course.removeStudent(fields[1]);
+            } else if (operation == "WAITLIST") {
+                course.joinWaitlist(fields[1]);
+            } else if (operation == "LEAVE_WAITLIST") {
+                course.leaveWaitlist(fields[1]);
+            } else if (operation == "SET_CAPACITY") {
+                requireFields(*record, 2);
+                course.setCapacity(stoul(fields[1]));
+            } else if (operation == "SET_SCHEDULE") {
+                course.setSchedule(scheduleFromFields(fields));
+            } else if (operation == "GRADE") {
+                requireFields(*record, 3);
+                course.addGrade(fields[1], stoi(fields[2]));
+            } else if (operation == "CURVE") {
+                requireFields(*record, 4);
+                course.transformGrades(curveFromFields(fields));
+            }
+        }
+    }
+
+    // Writes the archives and moves the open courses into the manager, then
+    // rebuilds every index that spans courses
+    void install() {
+        size_t courseCount = streams.size();
+        lms.nextCourseId = static_cast<int>(courseCount);
+        lms.activeTerm = activeTerm;
+        lms.closedTerms = closedTerms;
+
+        if (!closedTerms.empty()) {
+            filesystem::create_directories(lms.archiveDirectory);
+        }
+        TaskGroup archives(pool);
+        for (const auto& term : closedTerms) {
+            vector<const Course*> closing;
+            for (const auto& stream : streams) {
+                if (stream.archived && stream.term == term) {
+                    closing.push_back(&*stream.course);
+                }
+            }
+            string path = lms.archivePath(term);
+            archives.run([path, term, closing] { TermArchive::write(path, term, closing); });
+        }
+        archives.wait();
+
+        for (size_t id = 0; id < courseCount; ++id) {
+            CourseStream& stream = streams[id];
+            if (stream.archived) {
+                lms.archivedCourseNames[id] = stream.course->getCourseName();
+            } else if (!stream.removed) {
+                lms.courses.push_back(move(*stream.course));
+            }
+            // Completion follows the course's final grades, which outlive its removal
+            const Course& course = stream.archived || stream.removed ? *stream.course : lms.courses.back();
+            GradeColumns grades = course.getGrades();
+            for (size_t i = 0; i < grades.size(); ++i) {
+                if (grades.values[i] >= LMSManager::PASSING_GRADE) {
+                    lms.completedCourses[grades.students[i]].set(id);
+                }
+            }
+        }
+
+        lms.prerequisiteClosure.assign(courseCount, CourseBitset());
+        for (size_t id = 0; id < frozenClosure.size(); ++id) {
+            if (streams[id].archived) {
+                lms.prerequisiteClosure[id] = frozenClosure[id];
+            }
+        }
+        lms.rebuildPrerequisiteClosure();
+
+        // Every student was given an ID in partition(), so the workers only read the map
+        vector<Course>& courses = lms.courses;
+        vector<vector<uint32_t>> rosters(courses.size());
+        vector<vector<uint32_t>> gradedIds(courses.size());
+        vector<vector<int>> gradeValues(courses.size());
+        lms.enrollmentBitmaps.assign(courseCount, RoaringBitmap());
+        parallelFor(0, courses.size(), [this, &courses, &rosters, &gradedIds, &gradeValues](size_t i) {
+            for (const auto& studentEmail : courses[i].getStudents()) {
+                rosters[i].push_back(lms.studentIds.at(studentEmail));
+                lms.enrollmentBitmaps[courses[i].getId()].add(rosters[i].back());
+            }
+            GradeColumns grades = courses[i].getGrades();
+            for (const auto& studentEmail : grades.students) {
+                gradedIds[i].push_back(lms.studentIds.at(studentEmail));
+            }
+            gradeValues[i] = move(grades.values);
+        }, 1, pool);
+
+        size_t studentCount = lms.studentEmails.size();
+        vector<vector<int>> enrolledCourses(studentCount);
+        vector<vector<size_t>> enrolledIndexes(studentCount);
+        vector<pair<long long, uint32_t>> totals(studentCount, {0, 0});
+        for (size_t i = 0; i < courses.size(); ++i) {
+            for (uint32_t student : rosters[i]) {
+                enrolledCourses[student].push_back(courses[i].getId());
+                enrolledIndexes[student].push_back(i);
+            }
+            for (size_t g = 0; g < gradedIds[i].size(); ++g) {
+                totals[gradedIds[i][g]].first += gradeValues[i][g];
+                ++totals[gradedIds[i][g]].second;
+            }
+        }
+        for (const auto& stream : streams) {
+            if (stream.archived) {
+                GradeColumns grades = stream.course->getGrades();
+                for (size_t g = 0; g < grades.size(); ++g) {
+                    auto& total = totals[lms.studentIds.at(grades.students[g])];
+                    total.first += grades.values[g];
+                    ++total.second;
+                }
+            }
+        }
+        lms.coEnrollment.load(move(enrolledCourses), courseCount, pool);
+        lms.leaderboard.load(totals);
+
+        vector<StudentTimetable> timetables(studentCount);
+        parallelFor(0, studentCount, [&courses, &enrolledIndexes, &timetables](size_t student) {
+            for (size_t i : enrolledIndexes[student]) {
+                timetables[student].addCourse(courses[i].getId(), courses[i].getSchedule());
+            }
+        }, 64, pool);
+        for (size_t student = 0; student < studentCount; ++student) {
+            if (!enrolledIndexes[student].empty()) {
+                lms.timetables.emplace(lms.studentEmails[student], move(timetables[student]));
+            }
+        }
+    }
+
+public:
+    LogRecovery(LMSManager& lms, ThreadPool& pool) : lms(lms), pool(pool), activeTerm(lms.getActiveTerm()) {}
+
+    void run(const vector<LogRecord>& records, RecoveryPhases& phases) {
+        auto elapsedMs = [](chrono::steady_clock::time_point& since) {
+            auto now = chrono::steady_clock::now();
+            double ms = chrono::duration<double, milli>(now - since).count();
+            since = now;
+            return ms;
+        };
+        auto start = chrono::steady_clock::now();
+        partition(records);
+        phases.partitionMs = elapsedMs(start);
+        parallelFor(0, streams.size(), [this](size_t id) { replay(streams[id], static_cast<int>(id)); }, 1, pool);
+        phases.replayMs = elapsedMs(start);
+        install();
+        phases.installMs = elapsedMs(start);
+    }
+};
+
+RecoveryPhases recoverLog(const vector<string>& lines, ThreadPool& pool) {
+    RecoveryPhases phases;
+    auto start = chrono::steady_clock::now();
+    vector<LogRecord> records(lines.size());
+    parallelFor(0, lines.size(), [&lines, &records](size_t i) { records[i] = LogRecord::parse(lines[i]); }, 256, pool);
+    phases.parseMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // The streams assume an empty manager, and would hold every row in memory
+    // that a grade store is meant to keep on disk
+    LMSManager* lms = LMSManager::getInstance();
+    if (!lms->getCourses().empty() || lms->getGradeStore()) {
+        for (const auto& record : records) {
+            applyLogRecord(record);
+        }
+    } else {
+        LogRecovery(*lms, pool).run(records, phases);
+    }
+    for (size_t i = 0; i < lines.size(); ++i) {
+        mutationLog().restore(lines[i], records[i].sequence);
+    }
+    return phases;
+}
+
+// Builds a synthetic enrollment matrix and times the parallel rebuild
+void benchmarkRecommendations(size_t studentCount, size_t courseCount) {
+    const size_t coursesPerStudent = 5;
+    cout << "Co-enrollment rebuild (" << studentCount << " students, " << courseCount
+         << " courses, " << coursesPerStudent << " courses each)\n";
+
+    CoEnrollmentIndex index;
+    mt19937 random(7);
+    for (uint32_t student = 0; student < studentCount; ++student) {
+        // Students cluster around a "major" so the matrix has structure to find
+        size_t major = random() % courseCount;
+        for (size_t k = 0; k < coursesPerStudent; ++k) {
+            index.add(static_cast<int>((major + random() % 20) % courseCount), student);
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    index.rebuild();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "  rebuild on " << ThreadPool::shared().size() << " thread(s): " << seconds * 1000
+         << " ms, " << index.nonZeroCount() << " non-zero pairs\n";
+
+    start = chrono::steady_clock::now();
+    size_t recommended = 0;
+    for (uint32_t student = 0; student < 1000 && student < studentCount; ++student) {
+        recommended += index.recommend(student, 5).size();
+    }
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    cout << "  recommendations: " << micros / min<size_t>(1000, studentCount) << " us per student ("
+         << recommended << " suggestions)\n";
+}
+
+// Helpers over the courses of the shared manager
+template <typename Fn>
+void parallelForCourses(vector<Course>& courses, Fn fn) {
+    parallelFor(0, courses.size(), [&courses, &fn](size_t i) { fn(courses[i]); });
+}
+
+template <typename T, typename Map, typename Combine>
+T parallelReduceCourses(const vector<Course>& courses, T identity, Map map, Combine combine) {
+    return parallelReduce(0, courses.size(), identity,
+                          [&courses, &map](size_t i) { return map(courses[i]); }, combine);
+}
+
+// Grade totals over every course, computed on the shared pool
+struct GradeSummary {
+    size_t enrollments = 0;
+    size_t gradeCount = 0;
+    long long gradeTotal = 0;
+
+    double average() const { return gradeCount == 0 ? 0.0 : double(gradeTotal) / gradeCount; }
+};
+
+GradeSummary summarizeGrades(const vector<Course>& courses) {
+    return parallelReduceCourses(courses, GradeSummary(),
+        [](const Course& course) {
+            GradeSummary summary;
+            summary.enrollments = course.getEnrollmentCount();
+            course.forEachGrade([&summary](const string&, int grade) { summary.gradeTotal += grade; });
+            summary.gradeCount += course.getGradeCount();
+            return summary;
+        },
+        [](GradeSummary a, const GradeSummary& b) {
+            a.enrollments += b.enrollments;
+            a.gradeCount += b.gradeCount;
+            a.gradeTotal += b.gradeTotal;
+            return a;
+        });
+}
+
+// One student's pair of courses whose meeting times overlap
+struct TimetableConflict {
+    string studentEmail;
+    int firstCourseId;
+    int secondCourseId;
+};
+
+// Finds every clashing course pair of every student, one student per pool task
+vector<TimetableConflict> findTimetableConflicts(LMSManager& lms) {
+    vector<pair<const string*, const StudentTimetable*>> students;
+    for (const auto& entry : lms.getTimetables()) {
+        students.push_back({&entry.first, &entry.second});
+    }
+
+    vector<vector<pair<int, int>>> pairsPerStudent(students.size());
+    parallelFor(0, students.size(), [&students, &pairsPerStudent](size_t i) {
+        pairsPerStudent[i] = students[i].second->conflictingPairs();
+    }, 64);
+
+    vector<TimetableConflict> conflicts;
+    for (size_t i = 0; i < students.size(); ++i) {
+        for (const auto& clash : pairsPerStudent[i]) {
+            conflicts.push_back({*students[i].first, clash.first, clash.second});
+        }
+    }
+    sort(conflicts.begin(), conflicts.end(), [](const TimetableConflict& a, const TimetableConflict& b) {
+        return a.studentEmail < b.studentEmail;
+    });
+    return conflicts;
+}
+
+// Times a grade summary over synthetic courses with 1..maxThreads workers
+void benchmarkThreadPool(size_t maxThreads) {
+    const int courseCount = 2000;
+    const int gradesPerCourse = 2000;
+    vector<Course> courses;
+    for (int c = 0; c < courseCount; ++c) {
+        Course course("Course " + to_string(c), "teacher@example.com");
+        for (int g = 0; g < gradesPerCourse; ++g) {
+            course.addGrade("student" + to_string(g) + "@example.com", (c + g) % 101);
+        }
+        courses.push_back(course);
+    }
+    cout << "Thread pool scaling (" << courseCount << " courses, "
+         << courseCount * gradesPerCourse << " grades)\n";
+
+    double baseline = 0;
+    for (size_t threads = 1; threads <= maxThreads; ++threads) {
+        ThreadPool pool(threads);
+        auto start = chrono::steady_clock::now();
+        long long total = 0;
+        for (int round = 0; round < 10; ++round) {
+            total += parallelReduce(0, courses.size(), 0LL,
+                [&courses](size_t i) {
+                    long long sum = 0;
+                    courses[i].forEachGrade([&sum](const string&, int grade) { sum += grade; });
+                    return sum;
+                },
+                [](long long a, long long b) { return a + b; }, 1, pool);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (threads == 1) {
+            baseline = seconds;
+        }
+        cout << threads << " thread(s): " << seconds * 1000 << " ms, speedup "
+             << baseline / seconds << "x (checksum " << total << ")\n";
+    }
+}
+
+// One partition of the sharded write benchmark. Only the shard's worker
+// thread touches its courses, so commands run against a course without
+// taking any lock.
+class CourseShard {
+private:
+    vector<Course> courses;
+    unordered_map<string, size_t> courseIndex; // course name -> position in courses
+
+    deque<function<void()>> commands;
+    mutex commandMutex;
+    condition_variable commandReady;
+    bool stopping = false;
+    thread worker;
+
+    void run() {
+        deque<function<void()>> batch;
+        while (true) {
+            {
+                unique_lock<mutex> lock(commandMutex);
+                commandReady.wait(lock, [this] { return stopping || !commands.empty(); });
+                if (commands.empty()) {
+                    return; // Stopping and fully drained
+                }
+                batch.swap(commands); // Take the whole queue at once
+            }
+            for (auto& command : batch) {
+                command();
+            }
+            batch.clear();
+        }
+    }
+
+public:
+    CourseShard() : worker(&CourseShard::run, this) {}
+
+    CourseShard(const CourseShard&) = delete;
+    CourseShard& operator=(const CourseShard&) = delete;
+
+    ~CourseShard() {
+        {
+            lock_guard<mutex> lock(commandMutex);
+            stopping = true;
+        }
+        commandReady.notify_one();
+        worker.join();
+    }
+
+    // Queue a command for the worker. The command receives this shard and runs on its thread.
+    template <typename Fn>
+    auto submit(Fn fn) -> future<decltype(fn(*this))> {
+        using Result = decltype(fn(*this));
+        auto task = make_shared<packaged_task<Result()>>([this, fn]() mutable { return fn(*this); });
+        future<Result> result = task->get_future();
+        {
+            lock_guard<mutex> lock(commandMutex);
+            commands.emplace_back([task] { (*task)(); });
+        }
+        commandReady.notify_one();
+        return result;
+    }
+
+    // The following are only called from the worker thread
+    void addCourse(const Course& course) {
+        if (courseIndex.count(course.getCourseName())) {
+            throw ValidationException("Course already exists");
+        }
+        courseIndex[course.getCourseName()] = courses.size();
+        courses.push_back(course);
+    }
+
+    Course& getCourse(const string& courseName) {
+        auto it = courseIndex.find(courseName);
+        if (it == courseIndex.end()) {
+            throw ValidationException("Course not found: " + courseName);
+        }
+        return courses[it->second];
+    }
+
+    const vector<Course>& getCourses() const { return courses; }
+};
+
+// Courses hash-distributed over shards, each owned by its own worker thread
+// (actor style), to measure how roster writes scale without locks. Only
+// --bench-shards uses it: the shards hold bare Course objects outside
+// LMSManager, so nothing is logged or indexed and capacity, waitlist and
+// prerequisite rules do not apply. Single-course commands go to one shard;
+// cross-course queries scatter to every shard and gather the results.
+class PartitionedLMS {
+private:
+    vector<unique_ptr<CourseShard>> shards;
+
+    CourseShard& shardFor(const string& courseName) {
+        return *shards[hash<string>()(courseName) % shards.size()];
+    }
+
+public:
+    explicit PartitionedLMS(size_t shardCount) {
+        if (shardCount == 0) {
+            shardCount = 1;
+        }
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards.push_back(unique_ptr<CourseShard>(new CourseShard()));
+        }
+    }
+
+    size_t shardCount() const { return shards.size(); }
+
+    future<void> addCourse(const Course& course) {
+        return shardFor(course.getCourseName()).submit([course](CourseShard& shard) {
+            shard.addCourse(course);
+        });
+    }
+
+    future<void> enrollStudent(const string& courseName, const string& studentEmail) {
+        return shardFor(courseName).submit([courseName, studentEmail](CourseShard& shard) {
+            shard.getCourse(courseName).enrollStudent(studentEmail);
+        });
+    }
+
+    // Scatter a read-only query to every shard and gather the per-shard results
+    template <typename Fn>
+    auto scatterGather(Fn query) -> vector<decltype(query(declval<const vector<Course>&>()))> {
+        using Result = decltype(query(declval<const vector<Course>&>()));
+        vector<future<Result>> pending;
+        for (auto& shard : shards) {
+            pending.push_back(shard->submit([query](CourseShard& owner) {
+                return query(owner.getCourses());
+            }));
+        }
+        vector<Result> results;
+        for (auto& partial : pending) {
+            results.push_back(partial.get());
+        }
+        return results;
+    }
+
+    size_t enrollmentCount() {
+        auto partials = scatterGather([](const vector<Course>& courses) {
+            size_t enrolled = 0;
+            for (const auto& course : courses) {
+                enrolled += course.getEnrollmentCount();
+            }
+            return enrolled;
+        });
+        return accumulate(partials.begin(), partials.end(), size_t(0));
+    }
+};
+
+// Measures enrollment throughput of PartitionedLMS for 1..maxShards shards
+void benchmarkPartitionedLMS(size_t maxShards) {
+    const int courseCount = 512;
+    const int studentsPerCourse = 200;
+    cout << "Partitioned LMS write throughput (" << courseCount << " courses, "
+         << courseCount * studentsPerCourse << " enrollments)\n";
+
+    // Powers of two, always finishing with the requested maximum
+    vector<size_t> shardCounts;
+    for (size_t count = 1; count < maxShards; count *= 2) {
+        shardCounts.push_back(count);
+    }
+    shardCounts.push_back(maxShards);
+
+    for (size_t shardCount : shardCounts) {
+        PartitionedLMS lms(shardCount);
+        vector<future<void>> pending;
+        for (int c = 0; c < courseCount; ++c) {
+            pending.push_back(lms.addCourse(Course("Course " + to_string(c), "teacher@example.com")));
+        }
+        for (auto& done : pending) {
+            done.get();
+        }
+        pending.clear();
+
+        auto start = chrono::steady_clock::now();
+        for (int s = 0; s < studentsPerCourse; ++s) {
+            for (int c = 0; c < courseCount; ++c) {
+                pending.push_back(lms.enrollStudent("Course " + to_string(c),
+                                                    "student" + to_string(s) + "@example.com"));
+            }
+        }
+        for (auto& done : pending) {
+            done.get();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << shardCount << " shard(s): " << seconds * 1000 << " ms, "
+             << static_cast<long long>(pending.size() / seconds) << " enrollments/s"
+             << (lms.enrollmentCount() == pending.size() ? "" : " (MISSING ENROLLMENTS)") << "\n";
+    }
+}
+
+// Compares roster set operations on compressed bitmaps against hash sets
+void benchmarkEnrollmentBitmaps(size_t studentCount) {
+    const int repetitions = 100;
+    cout << "Enrollment set algebra (" << studentCount << " students, two rosters of ~40%)\n";
+
+    RoaringBitmap physics, mathematics;
+    unordered_set<uint32_t> physicsSet, mathematicsSet;
+    mt19937 random(42);
+    for (uint32_t id = 0; id < studentCount; ++id) {
+        if (random() % 5 < 2) {
+            physics.add(id);
+            physicsSet.insert(id);
+        }
+        if (random() % 5 < 2) {
+            mathematics.add(id);
+            mathematicsSet.insert(id);
+        }
+    }
+
+    auto time = [repetitions](const string& label, auto query) {
+        size_t result = 0;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            result = query();
+        }
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repetitions;
+        cout << "  " << left << setw(28) << label << right << setw(10) << fixed << setprecision(1)
+             << micros << " us  (" << result << " students)\n";
+    };
+
+    time("bitmap AND", [&] { return RoaringBitmap::intersect(physics, mathematics).cardinality(); });
+    time("bitmap AND count only", [&] { return RoaringBitmap::intersectionSize(physics, mathematics); });
+    time("bitmap OR", [&] { return RoaringBitmap::unite(physics, mathematics).cardinality(); });
+    time("bitmap ANDNOT", [&] { return RoaringBitmap::subtract(physics, mathematics).cardinality(); });
+    time("hash set intersection", [&] {
+        size_t count = 0;
+        for (uint32_t id : physicsSet) {
+            count += mathematicsSet.count(id);
+        }
+        return count;
+    });
+    time("hash set difference", [&] {
+        size_t count = 0;
+        for (uint32_t id : physicsSet) {
+            count += !mathematicsSet.count(id);
+        }
+        return count;
+    });
+}
+
+// Times each bulk transform over one large grade column
+void benchmarkGradeCurves(size_t gradeCount) {
+    const int repetitions = 100;
+    cout << "Bulk grade transforms (" << gradeCount << " grades)\n";
+
+    vector<int> grades(gradeCount);
+    mt19937 random(11);
+    for (int& grade : grades) {
+        grade = random() % 101;
+    }
+
+    GradeTransform transforms[4];
+    transforms[0] = {GradeTransform::Kind::Offset, 5.0, 0.0};
+    transforms[1] = {GradeTransform::Kind::Scale, 0.8, 20.0};
+    transforms[2] = {GradeTransform::Kind::SquareRoot, 0.0, 0.0};
+    transforms[3] = {GradeTransform::Kind::Clamp, 40.0, 95.0};
+    for (const auto& transform : transforms) {
+        vector<int> column;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            column = grades;
+            applyGradeKernel(column.data(), column.size(), transform);
+        }
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repetitions;
+        cout << "  " << left << setw(20) << transform.describe() << right << setw(10) << fixed
+             << setprecision(1) << micros << " us\n";
+    }
+}
+
+// Builds a leaderboard of synthetic students and times updates and rank queries
+void benchmarkLeaderboard(size_t studentCount) {
+    const int queries = 100000;
+    cout << "Leaderboard (" << studentCount << " students)\n";
+    Leaderboard leaderboard;
+    mt19937 random(3);
+
+    auto start = chrono::steady_clock::now();
+    for (uint32_t student = 0; student < studentCount; ++student) {
+        leaderboard.addGrade(student, random() % 101);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "  build: " << seconds * 1000 << " ms\n";
+
+    auto time = [queries](const string& label, auto operation) {
+        auto begin = chrono::steady_clock::now();
+        size_t checksum = 0;
+        for (int q = 0; q < queries; ++q) {
+            checksum += operation();
+        }
+        double nanos = chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / queries;
+        cout << "  " << left << setw(24) << label << right << setw(10) << fixed << setprecision(0)
+             << nanos << " ns  (checksum " << checksum << ")\n";
+    };
+    time("grade update", [&] {
+        leaderboard.addGrade(random() % studentCount, random() % 101);
+        return size_t(0);
+    });
+    time("rank of student", [&] { return leaderboard.rank(random() % studentCount); });
+    time("ranks 100-150", [&] { return leaderboard.range(100, 150).size(); });
+}
+
+// Simulates credential stuffing: many distinct emails from one source plus
+// repeated guesses against one account, timing each throttling decision
+void benchmarkLoginThrottle(size_t attempts) {
+    LoginThrottle throttle;
+    cout << "Login throttle (" << attempts << " failed attempts, "
+         << throttle.memoryBytes() / 1024 << " KiB of sketches)\n";
+    size_t refused = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < attempts; ++i) {
+        string email = "user" + to_string(i) + "@example.com";
+        string source = "client-" + to_string(i % 1000);
+        if (throttle.retryAfter(email, source) > 0.0) {
+            ++refused;
+        } else {
+            throttle.recordFailure(email, source);
+        }
+    }
+    double nanos = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / attempts;
+    cout << "  distinct emails: " << nanos << " ns per attempt, " << refused << " refused\n";
+
+    // After the flood, accounts and sources never seen before must still get in
+    refused = 0;
+    for (int i = 0; i < 1000; ++i) {
+        refused += throttle.retryAfter("fresh" + to_string(i) + "@example.com", "fresh-client-" + to_string(i)) > 0.0;
+    }
+    cout << "  first attempt for 1000 fresh accounts after the flood: " << refused << " refused"
+         << (throttle.saturatedChecks > 0 ? " (a sketch saturated)" : "") << "\n";
+
+    auto guessAtVictim = [](LoginThrottle& target) {
+        size_t refusedGuesses = 0;
+        for (int i = 0; i < 100; ++i) {
+            if (target.retryAfter("victim@example.com", "attacker-" + to_string(i)) > 0.0) {
+                ++refusedGuesses;
+            } else {
+                target.recordFailure("victim@example.com", "attacker-" + to_string(i));
+            }
+        }
+        return refusedGuesses;
+    };
+    cout << "  100 guesses at one account from 100 sources: " << guessAtVictim(throttle) << " refused\n";
+
+    // A botnet spraying one guess per account, each from its own source, is
+    // never held back by the source limit, so every failure lands in the
+    // email sketch. The targeted account has to stay throttled anyway.
+    LoginThrottle sprayed;
+    for (size_t i = 0; i < attempts; ++i) {
+        sprayed.recordFailure("user" + to_string(i) + "@example.com", "bot-" + to_string(i));
+    }
+    refused = 0;
+    for (int i = 0; i < 1000; ++i) {
+        refused += sprayed.retryAfter("fresh" + to_string(i) + "@example.com", "fresh-client-" + to_string(i)) > 0.0;
+    }
+    cout << "  after " << attempts << " sprayed failures from distinct sources: " << refused
+         << " of 1000 fresh accounts refused" << (sprayed.saturatedChecks > 0 ? " (email sketch saturated)" : "")
+         << ", " << guessAtVictim(sprayed) << " of 100 guesses at one account refused\n";
+}
+
+// Compares the columnar user table and an array of variant values with the
+// original heap hierarchy (shared_ptr to a virtual base, dynamic_cast by role)
+void benchmarkUserModels(size_t userCount) {
+    struct LegacyUser {
+        string username, email, passwordHash;
+        LegacyUser(string username, string email, string passwordHash)
+            : username(move(username)), email(move(email)), passwordHash(move(passwordHash)) {}
+        virtual ~LegacyUser() = default;
+        virtual string getRole() const = 0;
+    };
+    struct LegacyAdmin : LegacyUser {
+        using LegacyUser::LegacyUser;
+        string getRole() const override { return "admin"; }
+    };
+    struct LegacyTeacher : LegacyUser {
+        using LegacyUser::LegacyUser;
+        string getRole() const override { return "teacher"; }
+    };
+    struct LegacyStudent : LegacyUser {
+        using LegacyUser::LegacyUser;
+        string getRole() const override { return "student"; }
+    };
+
+    // One admin and one teacher per hundred accounts, like a real institution
+    vector<shared_ptr<LegacyUser>> legacy;
+    vector<UserRecord> records;
+    UserTable table;
+    const string hash = PasswordHasher::hash("password", 1);
+    for (size_t i = 0; i < userCount; ++i) {
+        string name = "user" + to_string(i);
+        string email = name + "@example.com";
+        if (i % 100 == 0) {
+            legacy.push_back(make_shared<LegacyAdmin>(name, email, hash));
+            records.push_back(Admin(name, email, hash));
+        } else if (i % 100 == 1) {
+            legacy.push_back(make_shared<LegacyTeacher>(name, email, hash));
+            records.push_back(Teacher(name, email, hash));
+        } else {
+            legacy.push_back(make_shared<LegacyStudent>(name, email, hash));
+            records.push_back(Student(name, email, hash));
+        }
+    }
+    // Both models list the accounts in the same shuffled order, the way years of
+    // sign-ups and removals would leave them. The heap objects stay where they
+    // were allocated, so only the pointer model pays for scattered memory.
+    vector<size_t> order(userCount);
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), mt19937(5));
+    {
+        vector<shared_ptr<LegacyUser>> shuffledLegacy;
+        vector<UserRecord> shuffledRecords;
+        for (size_t i : order) {
+            shuffledLegacy.push_back(move(legacy[i]));
+            shuffledRecords.push_back(move(records[i]));
+            table.add(shuffledRecords.back());
+        }
+        legacy.swap(shuffledLegacy);
+        records.swap(shuffledRecords);
+    }
+
+    cout << "User models (" << userCount << " accounts)\n";
+    auto time = [](const string& label, auto scan) {
+        const int rounds = 20;
+        size_t result = 0;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            result += scan();
+        }
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / rounds;
+        cout << "  " << left << setw(36) << label << right << setw(10) << fixed << setprecision(1)
+             << micros << " us  (" << result / rounds << ")\n";
+    };
+    time("hierarchy: teachers via dynamic_cast", [&legacy] {
+        size_t count = 0;
+        for (const auto& user : legacy) {
+            count += dynamic_cast<LegacyTeacher*>(user.get()) != nullptr;
+        }
+        return count;
+    });
+    time("hierarchy: role via virtual call", [&legacy] {
+        size_t count = 0;
+        for (const auto& user : legacy) {
+            count += user->getRole() == "teacher";
+        }
+        return count;
+    });
+    time("variant: teachers via index", [&records] {
+        size_t count = 0;
+        for (const auto& user : records) {
+            count += holds_alternative<Teacher>(user);
+        }
+        return count;
+    });
+    time("variant: email lengths via visit", [&records] {
+        size_t total = 0;
+        for (const auto& user : records) {
+            total += userFields(user).getEmail().size();
+        }
+        return total;
+    });
+    time("table: teachers via role column", [&table] { return table.countWithRole(Role::Teacher); });
+    time("table: list teacher emails", [&table] {
+        size_t total = 0;
+        table.forEachWithRole(Role::Teacher, [&table, &total](uint32_t id) { total += table.email(id).size(); });
+        return total;
+    });
+    cout.unsetf(ios::floatfield);
+
+    // Heap estimate: each string longer than the small-string buffer is its own
+    // allocation, and every allocation pays about 16 bytes of allocator overhead
+    const size_t allocationOverhead = 16;
+    auto stringHeap = [allocationOverhead](const string& text) {
+        return text.size() < sizeof(string) ? size_t(0) : text.capacity() + 1 + allocationOverhead;
+    };
+    size_t legacyBytes = legacy.capacity() * sizeof(shared_ptr<LegacyUser>);
+    for (const auto& user : legacy) {
+        legacyBytes += sizeof(LegacyStudent) + 16 + allocationOverhead; // Object and control block
+        legacyBytes += stringHeap(user->username) + stringHeap(user->email) + stringHeap(user->passwordHash);
+    }
+    size_t variantBytes = records.capacity() * sizeof(UserRecord);
+    for (const auto& user : records) {
+        const User& fields = userFields(user);
+        variantBytes += stringHeap(fields.getUsername()) + stringHeap(fields.getEmail()) +
+                        stringHeap(fields.getPasswordHash());
+    }
+    cout << "  bytes per user: hierarchy ~" << legacyBytes / userCount << ", variant array ~"
+         << variantBytes / userCount << ", table ~" << table.memoryUsage() / userCount
+         << " (including its email index)\n";
+}
 
 // Admin class implementation
-void Admin::displayMenu() {
+Task<> Admin::enrollStudent(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::enrollStudent");
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    if (courses.empty()) {
+        out << "There are no courses available for enrollment.\n";
+        co_return;
+    }
+
+    LMSManager::getInstance()->displayCourses(out);
+    int userIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter course index to enroll student (1-" + to_string(courses.size()) + "): ",
+        1, courses.size());
+
+    try {
+        Course& course = LMSManager::getInstance()->getCourse(userIndex - 1);
+        
+        string studentEmail;
+        string studentPassword;
+        bool validEmail = false;
+        
+        // Email validation
+        do {
+            out << "Enter student's email: ";
+            studentEmail = co_await session.readToken();
+            if (Validator::isValidEmail(studentEmail)) {
+                
+                // Check if student already exists
+                if (findUserByEmail(studentEmail)) {
+                    out << "Student with this email already exists. Cannot create a duplicate account.\n";
+                    co_return;
+                }
+
+                // A new account has no completed courses, so check before creating it
+                LMSManager::getInstance()->checkPrerequisites(course, studentEmail);
+                
+                validEmail = true;
+            } else {
+                out << "Invalid email format. Please try again.\n";
+            }
+        } while (!validEmail);
+        
+        // Password input
+        out << "Enter password for the student: ";
+        studentPassword = co_await session.readToken();
+        
+        // Create new student
+        Student newStudent(
+            studentEmail.substr(0, studentEmail.find('@')),  // Use email prefix as username
+            studentEmail, 
+            PasswordHasher::hash(studentPassword)
+        );
+        
+        // Add to users list
+        addUser(newStudent);
+        
+        // Enroll in the course, or queue them if it is full
+        size_t position = LMSManager::getInstance()->enrollOrWaitlist(course, studentEmail);
+        
+        if (position == 0) {
+            out << "Student enrolled successfully and account created.\n";
+        } else {
+            out << "Account created. The course is full, so the student is number "
+                 << position << " on the waitlist.\n";
+        }
+        out << "Username: " << newStudent.getEmail() << endl;
+        session.pause();
+    } catch (const exception& e) {
+        out << e.what() << endl;
+        session.pause();
+    }
+}
+
+Task<> Admin::importStudents(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::importStudents");
+    session.clear();
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    if (courses.empty()) {
+        out << "There are no courses available for enrollment.\n";
+        session.pause();
+        co_return;
+    }
+
+    LMSManager::getInstance()->displayCourses(out);
+    int userIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter course index to import students into (1-" + to_string(courses.size()) + "): ",
+        1, courses.size());
+    Course& course = LMSManager::getInstance()->getCourse(userIndex - 1);
+
+    // Each line of the file holds "email password"
+    string path;
+    out << "Enter path of the student list: ";
+    path = co_await session.readToken();
+    ifstream file(path);
+    if (!file) {
+        out << "Could not open file: " << path << endl;
+        session.pause();
+        co_return;
+    }
+
+    vector<pair<string, string>> rows;
+    string studentEmail, studentPassword;
+    while (file >> studentEmail >> studentPassword) {
+        rows.push_back({studentEmail, studentPassword});
+    }
+
+    // Validate and hash passwords on the shared pool; account creation below stays sequential
+    vector<char> validRows(rows.size());
+    vector<string> passwordHashes(rows.size());
+    parallelFor(0, rows.size(), [&rows, &validRows, &passwordHashes](size_t i) {
+        validRows[i] = Validator::isValidEmail(rows[i].first);
+        if (validRows[i]) {
+            passwordHashes[i] = PasswordHasher::hash(rows[i].second);
+        }
+    }, 4);
+
+    UserLookupStats before = userLookupStats();
+    size_t created = 0, duplicates = 0, invalid = 0, waitlisted = 0, unqualified = 0, notEnrolled = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!validRows[i]) {
+            ++invalid;
+            continue;
+        }
+        if (findUserByEmail(rows[i].first)) {
+            ++duplicates;
+            continue;
+        }
+        // Checked before the account exists, so a rejected row leaves nothing behind
+        if (!LMSManager::getInstance()->meetsPrerequisites(course, rows[i].first)) {
+            ++unqualified;
+            continue;
+        }
+        addUser(Student(
+            rows[i].first.substr(0, rows[i].first.find('@')), rows[i].first, passwordHashes[i]));
+        ++created;
+        try {
+            if (LMSManager::getInstance()->enrollOrWaitlist(course, rows[i].first) != 0) {
+                ++waitlisted;
+            }
+        } catch (const ValidationException&) {
+            ++notEnrolled;
+        }
+    }
+
+    // Only report the lookups made by this import
+    UserLookupStats importStats;
+    importStats.checks = userLookupStats().checks - before.checks;
+    importStats.prefilterMisses = userLookupStats().prefilterMisses - before.prefilterMisses;
+    importStats.probes = userLookupStats().probes - before.probes;
+    importStats.falsePositives = userLookupStats().falsePositives - before.falsePositives;
+
+    out << "Import summary for " << course.getCourseName() << ":\n";
+    out << "Created: " << created << " (waitlisted: " << waitlisted << ", not enrolled: " << notEnrolled << ")\n";
+    out << "Skipped duplicates: " << duplicates << endl;
+    out << "Skipped invalid emails: " << invalid << endl;
+    out << "Skipped for missing prerequisites: " << unqualified << endl;
+    out << "Existence checks: " << importStats.checks << ", answered by filter: "
+         << importStats.prefilterMisses << " (" << importStats.prefilterHitRate() << "%)\n";
+    out << "Index probes: " << importStats.probes << " (false positives: "
+         << importStats.falsePositives << ")\n";
+    session.pause();
+}
+
+Task<> Admin::removeStudent(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::removeStudent");
+    // Check if there are courses available
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    if (courses.empty()) {
+        out << "There are no courses available.\n";
+        co_return;
+    }
+
+    LMSManager::getInstance()->displayCourses(out);
+    int userIndex;
+    out << "Enter course index to remove student (1-" << courses.size() << "): ";
+    userIndex = co_await session.readInt();
+
+    try {
+        // Convert 1-based user input to 0-based index
+        int systemIndex = userIndex - 1;
+        Course& course = LMSManager::getInstance()->getCourse(systemIndex);
+
+        // Check if the course has any students
+        if (course.getEnrollmentCount() == 0) {
+            out << "There is no student here.\n";
+            co_return;
+        }
+
+        string studentEmail;
+        out << "Enter student's email to remove: ";
+        studentEmail = co_await session.readToken();
+
+        try {
+            vector<string> promoted = LMSManager::getInstance()->removeStudent(course, studentEmail);
+            out << "Student removed successfully.\n";
+            for (const auto& promotedEmail : promoted) {
+                out << "Enrolled from the waitlist: " << promotedEmail << endl;
+            }
+        } catch (const runtime_error&) {
+            out << "Student not found in the course.\n";
+        }
+    } catch (InvalidCourseIndexException&) {
+        out << "Invalid course index. Please enter a number between 1 and " 
+             << courses.size() << ".\n";
+    }
+}
+
+Task<> Admin::manageCourses(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::manageCourses");
+    int choice;
+    do {
+        session.clear();
+        out << "\nManage Courses:\n";
+        out << "1. Add Course\n";
+        out << "2. Delete Course\n";
+        out << "3. Edit Course\n";
+        out << "4. Display Courses\n";
+        out << "5. Set Prerequisites\n";
+        out << "6. Back\n";
+
+        choice = co_await Validator::getValidatedIntInput(session, "Enter choice (1-6): ", 1, 6);
+
+        switch (choice) {
+            case 1:
+                co_await addCourse(session);
+                break;
+            case 2:
+                co_await deleteCourse(session);
+                session.pause();
+                break;
+            case 3:
+                co_await editCourse(session);
+                break;
+            case 4:
+                LMSManager::getInstance()->displayCourses(out);
+                session.pause();
+                break;
+            case 5:
+                co_await setPrerequisites(session);
+                break;
+            case 6:
+                out << "Returning...\n";
+                session.pause();
+                break;
+        }
+    } while (choice != 6);
+}
+
+Task<> Admin::addCourse(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::addCourse");
+    session.clear();
+    string courseName, teacherEmail;
+    
+    out << "Enter course name: ";
+    co_await session.ignoreChar();
+    courseName = co_await session.readLine();
+    
+    out << "Enter teacher's email: ";
+    teacherEmail = co_await session.readToken();
+
+    // Check if the teacher's email exists among the registered users
+    bool teacherExists = findUserByEmail(teacherEmail).has_value();
+
+    if (!teacherExists) {
+        char addTeacher;
+        out << "Error: The email does not belong to a registered teacher.\n";
+        out << "Would you like to register this teacher? (y/n): ";
+        addTeacher = co_await session.readChar();
+        co_await session.ignoreChar(); 
+
+        if (addTeacher == 'y' || addTeacher == 'Y') {
+            string teacherName, teacherPassword;
+
+            out << "Enter teacher's name: ";
+            teacherName = co_await session.readLine();
+            out << "Enter teacher's password: ";
+            teacherPassword = co_await session.readLine();
+
+            // Create a new Teacher object and add to the users
+            addUser(Teacher(teacherName, teacherEmail, PasswordHasher::hash(teacherPassword)));
+            out << "Teacher registered successfully: " << teacherName << " (" << teacherEmail << ")\n";
+        } else {
+            out << "Course addition canceled.\n";
+            session.pause(); // Wait for user to see the message
+            co_return; // Exit the function if the admin does not want to register the teacher
+        }
+    }
+
+    // Ensure teacher is not managing multiple subjects
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    for (const auto& course : courses) {
+        if (course.getTeacherEmail() == teacherEmail) {
+            out << "Error: Teacher is already assigned to another course.\n";
+            session.pause();
+            co_return;
+        }
+    }
+
+    int capacity = co_await Validator::getValidatedIntInput(session,
+        "Enter course capacity (0 for unlimited): ", 0, 100000);
+
+    // Proceed to add the course
+    try {
+        Course newCourse(courseName, teacherEmail);
+        newCourse.setCapacity(capacity);
+        LMSManager::getInstance()->addCourse(newCourse);
+        out << "Course added successfully.\n";
+    } catch (const ValidationException& e) {
+        out << "Error: " << e.what() << endl;
+    }
+    session.pause();
+}
+Task<> Admin::deleteCourse(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::deleteCourse");
+    // Check if there are any courses
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    if (courses.empty()) {
+        out << "There are no courses to delete.\n";
+        session.pause();  // Wait for the user to see the message
+        co_return;  // Exit the function if there are no courses
+    }
+    
+    // Display the list of courses if there are courses
+    LMSManager::getInstance()->displayCourses(out);
+    int index;
+    out << "Enter course index to delete: ";
+    index = co_await session.readInt();
+    
+     try {
+        // Validate user input and adjust for 0-based indexing
+        if (index < 1 || index > courses.size()) {
+            throw out_of_range("Invalid index");
+        }
+        
+        // Subtract 1 to convert to 0-based index
+        Course courseToDelete = courses[index - 1];  // Get a copy of the course
+        
+        LMSManager::getInstance()->removeCourse(index - 1);  // Pass 0-based indexad
+        out << "Successfully deleted course: " << courseToDelete.getCourseName() << endl;
+    } catch (InvalidCourseIndexException&) {
+        out << "Invalid course index.\n";
+    } catch (out_of_range&) {
+        // Handle case where index is out of vector bounds
+        out << "Invalid course index.\n";
+    }
+}
+
+Task<> Admin::setPrerequisites(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::setPrerequisites");
+    session.clear();
+    LMSManager* lms = LMSManager::getInstance();
+    vector<Course>& courses = lms->getCourses();
+    if (courses.size() < 2) {
+        out << "At least two courses are needed to set prerequisites.\n";
+        session.pause();
+        co_return;
+    }
+
+    lms->displayCourses(out);
+    int userIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter course index to set prerequisites for (1-" + to_string(courses.size()) + "): ",
+        1, courses.size());
+    Course& course = lms->getCourse(userIndex - 1);
+
+    out << "Current prerequisites of " << course.getCourseName() << ":";
+    if (course.getPrerequisites().empty()) {
+        out << " none";
+    }
+    for (int id : course.getPrerequisites()) {
+        out << " " << lms->courseName(id);
+    }
+    out << endl;
+
+    // The new list replaces the old one
+    vector<int> prerequisiteIds;
+    while (true) {
+        int prerequisiteIndex = co_await Validator::getValidatedIntInput(session,
+            "Enter a prerequisite course index (or 0 to finish): ", 0, courses.size());
+        if (prerequisiteIndex == 0) {
+            break;
+        }
+        prerequisiteIds.push_back(lms->getCourse(prerequisiteIndex - 1).getId());
+    }
+
+    try {
+        lms->setPrerequisites(course, prerequisiteIds);
+        out << "Prerequisites updated.\n";
+    } catch (const ValidationException& e) {
+        out << "Error: " << e.what() << endl;
+    }
+    session.pause();
+}
+
+Task<> Admin::viewTimetableConflicts(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::viewTimetableConflicts");
+    session.clear();
+    LMSManager* lms = LMSManager::getInstance();
+    vector<TimetableConflict> conflicts = findTimetableConflicts(*lms);
+
+    if (conflicts.empty()) {
+        out << "No timetable conflicts found.\n";
+    } else {
+        out << "Timetable Conflicts:\n";
+        for (const auto& conflict : conflicts) {
+            out << conflict.studentEmail << ": " << lms->findCourseById(conflict.firstCourseId)->getCourseName()
+                << " clashes with " << lms->findCourseById(conflict.secondCourseId)->getCourseName() << endl;
+        }
+        out << conflicts.size() << " conflicting pair(s).\n";
+    }
+    session.pause();
+    co_return;
+}
+
+// Institution-wide standings by average grade
+Task<> Admin::viewLeaderboard(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::viewLeaderboard");
+    LMSManager* lms = LMSManager::getInstance();
+    const Leaderboard& leaderboard = lms->getLeaderboard();
+    StreamFormatScope format(out);
+    out << fixed << setprecision(2); // Averages
+    int choice;
+    do {
+        session.clear();
+        out << "Leaderboard (" << leaderboard.size() << " ranked students, all terms)\n";
+        size_t shown = 0;
+        for (const auto& standing : leaderboard.range(1, 10)) {
+            out << "  " << ++shown << ". " << lms->studentEmailById(standing.studentId)
+                << " - " << standing.average << "%\n";
+        }
+        out << "1. Rank of a student\n";
+        out << "2. Students in a rank range\n";
+        out << "3. Back\n";
+        choice = co_await Validator::getValidatedIntInput(session, "Enter choice (1-3): ", 1, 3);
+
+        if (choice == 1) {
+            out << "Enter student's email: ";
+            string studentEmail = co_await session.readToken();
+            size_t rank = lms->rankOf(studentEmail);
+            if (rank == 0) {
+                out << studentEmail << " is not ranked (no grades yet).\n";
+            } else {
+                out << studentEmail << " is ranked " << rank << " of " << leaderboard.size()
+                    << " with an average of " << leaderboard.average(*lms->findStudentId(studentEmail)) << "%\n";
+            }
+            session.pause();
+        } else if (choice == 2 && leaderboard.size() > 0) {
+            int size = static_cast<int>(min<size_t>(leaderboard.size(), numeric_limits<int>::max()));
+            int first = co_await Validator::getValidatedIntInput(session,
+                "First rank (1-" + to_string(size) + "): ", 1, size);
+            int last = co_await Validator::getValidatedIntInput(session,
+                "Last rank (" + to_string(first) + "-" + to_string(size) + "): ", first, size);
+            size_t position = first;
+            for (const auto& standing : leaderboard.range(first, last)) {
+                out << "  " << position++ << ". " << lms->studentEmailById(standing.studentId)
+                    << " - " << standing.average << "%\n";
+            }
+            session.pause();
+        }
+    } while (choice != 3);
+}
+
+// Starts and closes academic terms and answers queries on archived ones
+Task<> Admin::manageTerms(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::manageTerms");
+    LMSManager* lms = LMSManager::getInstance();
+    int choice;
+    do {
+        session.clear();
+        out << "Academic Terms\n";
+        for (const auto& term : lms->getOpenTerms()) {
+            size_t courseCount = count_if(lms->getCourses().begin(), lms->getCourses().end(),
+                                          [&term](const Course& course) { return course.getTerm() == term; });
+            out << "  " << term << (term == lms->getActiveTerm() ? " (active)" : " (open)")
+                << ": " << courseCount << " courses\n";
+        }
+        for (const auto& term : lms->getClosedTerms()) {
+            out << "  " << term << " (archived)\n";
+        }
+        out << "1. Start a new term\n";
+        out << "2. Close a term\n";
+        out << "3. Archived courses of a term\n";
+        out << "4. Student transcript from archives\n";
+        out << "5. Back\n";
+        choice = co_await Validator::getValidatedIntInput(session, "Enter choice (1-5): ", 1, 5);
+        if (choice == 5) {
+            break;
+        }
+
+        string text;
+        if (choice == 4) {
+            out << "Enter student's email: ";
+            text = co_await session.readToken();
+        } else {
+            out << "Enter term name: ";
+            co_await session.ignoreChar();
+            text = co_await session.readLine();
+        }
+
+        try {
+            if (choice == 1) {
+                lms->startTerm(text);
+                out << "New courses now go into " << text << ".\n";
+            } else if (choice == 2) {
+                size_t archived = lms->closeTerm(text);
+                out << "Archived " << archived << " courses to " << lms->archivePath(text) << ".\n";
+            } else if (choice == 3) {
+                TermArchive archive = lms->openArchive(text);
+                out << archive.courseCount() << " courses, " << archive.studentCount() << " students, "
+                    << archive.storedBytes() << " bytes on disk (" << archive.plainBytes() << " as plain text)\n";
+                for (size_t i = 0; i < archive.courseCount(); ++i) {
+                    ArchivedCourse course = archive.course(i);
+                    out << "Course: " << course.name << " (Teacher: " << course.teacherEmail << ")\n";
+                    out << "  Enrolled: " << course.students.size() << ", grades:";
+                    for (const auto& grade : course.grades) {
+                        out << " " << grade.first << "=" << grade.second;
+                    }
+                    out << endl;
+                }
+            } else {
+                bool found = false;
+                for (const auto& term : lms->getClosedTerms()) {
+                    TermArchive archive = lms->openArchive(term);
+                    for (const auto& grade : archive.transcript(text)) {
+                        out << term << " - " << grade.first << ": " << grade.second << endl;
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    out << "No archived grades for " << text << ".\n";
+                }
+            }
+        } catch (const exception& e) {
+            out << "Error: " << e.what() << endl;
+        }
+        session.pause();
+    } while (choice != 5);
+}
+
+// Lists accounts whose email starts with a prefix, in email order
+Task<> Admin::findAccounts(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::findAccounts");
+    const size_t limit = 20;
+    out << "Enter the start of the email: ";
+    string prefix = co_await session.readToken();
+
+    vector<pair<string, uint32_t>> matches;
+    if (EmailBTree* index = userEmailIndex()) {
+        index->scanPrefix(prefix, limit + 1, [&matches](const string& email, uint32_t id) {
+            matches.push_back({email, id});
+        });
+    } else {
+        for (uint32_t id = 0; id < users().idLimit(); ++id) {
+            if (users().role(id) != Role::Removed && users().email(id).substr(0, prefix.size()) == prefix) {
+                matches.push_back({string(users().email(id)), id});
+            }
+        }
+        sort(matches.begin(), matches.end());
+    }
+
+    if (matches.empty()) {
+        out << "No accounts start with " << prefix << ".\n";
+    }
+    for (size_t i = 0; i < matches.size() && i < limit; ++i) {
+        out << "  " << matches[i].first << " (" << ROLE_TITLES[static_cast<size_t>(users().role(matches[i].second))]
+            << ")\n";
+    }
+    if (matches.size() > limit) {
+        out << "  ... showing the first " << limit << "\n";
+    }
+    session.pause();
+}
+
+// Accounts still teaching, enrolled or waitlisted in an open course are kept,
+// so no roster ever names a missing account
+Task<> Admin::removeAccount(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::removeAccount");
+    out << "Enter the email of the account to remove: ";
+    string email = co_await session.readToken();
+
+    if (email == getEmail()) {
+        out << "You cannot remove your own account.\n";
+        co_return;
+    }
+    if (!findUserByEmail(email)) {
+        out << "No account uses " << email << ".\n";
+        co_return;
+    }
+    if (const Course* course = LMSManager::getInstance()->findCourseUsing(email)) {
+        out << email << " is still part of " << course->getCourseName() << " and cannot be removed.\n";
+        co_return;
+    }
+    removeUser(email);
+    out << "Account " << email << " removed.\n";
+}
+
+// Set-algebra queries over course rosters, answered from the enrollment bitmaps
+Task<> Admin::enrollmentQueries(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::enrollmentQueries");
+    session.clear();
+    LMSManager* lms = LMSManager::getInstance();
+    vector<Course>& courses = lms->getCourses();
+    if (courses.empty()) {
+        out << "There are no courses available.\n";
+        session.pause();
+        co_return;
+    }
+
+    out << "Enrollment Queries:\n";
+    out << "1. Students in both of two courses\n";
+    out << "2. Students in either of two courses\n";
+    out << "3. Students in the first course but not the second\n";
+    out << "4. Students in neither of two courses\n";
+    out << "5. Co-enrollment counts for one course\n";
+    int choice = co_await Validator::getValidatedIntInput(session, "Enter choice (1-5): ", 1, 5);
+
+    lms->displayCourses(out);
+    int firstIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter first course index (1-" + to_string(courses.size()) + "): ", 1, courses.size());
+    Course& first = lms->getCourse(firstIndex - 1);
+
+    if (choice == 5) {
+        auto start = chrono::steady_clock::now();
+        auto counts = lms->coEnrollmentCounts(first);
+        long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        out << "Students of " << first.getCourseName() << " also enrolled in:\n";
+        for (const auto& entry : counts) {
+            out << "  " << entry.first->getCourseName() << ": " << entry.second << endl;
+        }
+        if (counts.empty()) {
+            out << "  no other course\n";
+        }
+        out << "(" << micros << " us)\n";
+        session.pause();
+        co_return;
+    }
+
+    int secondIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter second course index (1-" + to_string(courses.size()) + "): ", 1, courses.size());
+    Course& second = lms->getCourse(secondIndex - 1);
+
+    static const LMSManager::EnrollmentQuery queries[] = {
+        LMSManager::EnrollmentQuery::Both, LMSManager::EnrollmentQuery::Either,
+        LMSManager::EnrollmentQuery::FirstOnly, LMSManager::EnrollmentQuery::Neither};
+    const size_t shown = 20;
+    auto start = chrono::steady_clock::now();
+    RoaringBitmap result = lms->queryEnrollment(first, second, queries[choice - 1]);
+    long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    size_t total = result.cardinality();
+    for (const auto& email : lms->studentEmailsOf(result, shown)) {
+        out << "  " << email << endl;
+    }
+    if (total > shown) {
+        out << "  ... and " << total - shown << " more\n";
+    }
+    out << total << " student(s) (" << micros << " us)\n";
+    session.pause();
+}
+
+// Replaces the course's weekly meeting times
+Task<> Admin::editSchedule(Session& session, Course& course) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::editSchedule");
+    out << "Current schedule: " << course.scheduleString() << endl;
+    out << "Enter the new meeting times. Days are 1 (Monday) to 7 (Sunday); times are HH:MM.\n";
+
+    vector<TimeSlot> slots;
+    while (true) {
+        int day = co_await Validator::getValidatedIntInput(session, "Enter day (or 0 to finish): ", 0, 7);
+        if (day == 0) {
+            break;
+        }
+        out << "Enter start time: ";
+        int startMinute = TimeSlot::parseClock(co_await session.readToken());
+        out << "Enter end time: ";
+        int endMinute = TimeSlot::parseClock(co_await session.readToken());
+        try {
+            if (startMinute < 0 || endMinute < 0) {
+                throw ValidationException("Invalid time slot");
+            }
+            slots.push_back(TimeSlot(day - 1, startMinute, endMinute));
+        } catch (const ValidationException& e) {
+            out << e.what() << ". Please try again.\n";
+        }
+    }
+
+    LMSManager::getInstance()->setSchedule(course, slots);
+    out << "Schedule updated: " << course.scheduleString() << endl;
+}
+
+Task<> Admin::editCourse(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::editCourse");
+    session.clear();  // Clear screen
+
+    // Check if there are courses available
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    if (courses.empty()) {
+        out << "There are no courses available.\n";
+        session.pause();  // Wait for user to see the message
+        co_return;  // Exit the function if there are no courses
+    }
+
+    // If there are courses, proceed with editing
+    LMSManager::getInstance()->displayCourses(out);
+    int userIndex;
+    out << "Enter course index to edit (1-" << courses.size() << "): ";
+    userIndex = co_await session.readInt();
+
+    try {
+        // Convert 1-based user input to 0-based index
+        int systemIndex = userIndex - 1;
+        Course& course = LMSManager::getInstance()->getCourse(systemIndex);
+        out << "Editing course: " << course.getCourseName() << endl;
+        
+        out << "Would you like to edit the course content? (y/n): ";
+        char choice;
+        choice = co_await session.readChar();
+        
+        if (tolower(choice) == 'y') {
+            int contentChoice;
+            out << "1. Add content\n2. Remove content\nEnter choice: ";
+            contentChoice = co_await session.readInt();
+
+            if (contentChoice == 1) {
+                string content;
+                out << "Enter content: ";
+                co_await session.ignoreChar();
+                content = co_await session.readLine();
+                LMSManager::getInstance()->addContent(course, content);
+                out << "Content added successfully.\n";
+            } 
+            else if (contentChoice == 2) {
+                // Check if there's any content to remove
+                vector<string> contents = course.getContents();
+                if (contents.empty()) {
+                    out << "There is no content to remove.\n";
+                } 
+                else {
+                    // Display current content with 1-based indexing
+                    out << "\nCurrent content:\n";
+                    for (size_t i = 0; i < contents.size(); i++) {
+                        out << i + 1 << ". " << contents[i] << endl;
+                    }
+
+                    int userContentIndex;
+                    out << "Enter content index to remove (1-" << contents.size() << "): ";
+                    userContentIndex = co_await session.readInt();
+
+                    try {
+                        // Convert to 0-based index for internal use
+                        LMSManager::getInstance()->removeContent(course, userContentIndex - 1);
+                        out << "Content removed successfully.\n";
+                    } 
+                    catch (const out_of_range&) {
+                        out << "Invalid content index. Please enter a number between 1 and " 
+                             << contents.size() << ".\n";
+                    }
+                }
+            } 
+            else {
+                out << "Invalid choice. Please select 1 or 2.\n";
+            }
+        }
+
+        out << "Would you like to edit the schedule? (y/n): ";
+        choice = co_await session.readChar();
+        if (tolower(choice) == 'y') {
+            co_await editSchedule(session, course);
+        }
+
+        out << "Would you like to change the capacity (currently ";
+        if (course.getCapacity() == 0) {
+            out << "unlimited";
+        } else {
+            out << course.getCapacity();
+        }
+        out << ")? (y/n): ";
+        choice = co_await session.readChar();
+
+        if (tolower(choice) == 'y') {
+            int capacity = co_await Validator::getValidatedIntInput(session,
+                "Enter course capacity (0 for unlimited): ", 0, 100000);
+            vector<string> promoted = LMSManager::getInstance()->setCapacity(course, capacity);
+            out << "Capacity updated.\n";
+            for (const auto& promotedEmail : promoted) {
+                out << "Enrolled from the waitlist: " << promotedEmail << endl;
+            }
+        }
+    } 
+    catch (InvalidCourseIndexException&) {
+        out << "Invalid course index. Please enter a number between 1 and " 
+             << courses.size() << ".\n";
+    }
+    
+    session.pause();  // Pause the console to see the message
+}
+
+
+Task<> Admin::viewReports(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Admin::viewReports");
+    session.clear();  // Clear screen
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+
+    if (courses.empty()) {
+        out << "No courses available to generate reports.\n";
+        session.pause();
+        co_return;
+    }
+
+    out << "Courses Report:\n";
+    for (auto& course : courses) {
+        out << "Course: " << course.getCourseName() << " (Teacher: " << course.getTeacherEmail() << ")\n";
+        out << "Schedule: " << course.scheduleString() << "\n";
+        if (course.getCapacity() != 0) {
+            out << "Seats: " << course.getEnrollmentCount() << "/" << course.getCapacity()
+                 << ", waitlisted: " << course.getWaitlistSize() << "\n";
+        }
+        out << "Enrolled Students:\n";
+        course.displayStudents(out);
+        out << "Grades:\n";
+        course.displayGrades(out);
+        session.pause();   
+        out << "----------------------\n";
+    }
+    GradeSummary summary = summarizeGrades(courses);
+    out << "Total enrollments: " << summary.enrollments << ", grades recorded: "
+         << summary.gradeCount << ", average grade: " << summary.average() << "%\n";
+    displayUserLookupStats(out);
+    out << "Login throttle: " << loginThrottle().failures << " failed attempts, "
+        << loginThrottle().blocked << " attempts refused\n";
+    if (GradeStore* store = LMSManager::getInstance()->getGradeStore()) {
+        store->displayStats(out);
+    }
+    session.pause();
+}
+
+// Teacher class implementation
+Task<> Teacher::addGrade(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::addGrade");
+    session.clear();
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    
+    if (courses.empty()) {
+        out << "No courses available.\n";
+        session.pause();
+        co_return; // Exit if no courses are available
+    }
+
+    // Store courses assigned to this teacher
+    vector<Course*> assignedCourses;
+
+    // Filter courses to find those assigned to the current teacher
+    for (auto& course : courses) {
+        if (course.getTeacherEmail() == getEmail()) {
+            assignedCourses.push_back(&course);
+        }
+    }
+
+    // Check if there are any assigned courses
+    if (assignedCourses.empty()) {
+        out << "You are not assigned to any courses. Cannot add grades.\n";
+        session.pause();
+        co_return; // Exit if no courses are assigned
+    }
+
+    // Display the list of assigned courses with 1-based indexing
+    out << "Your Assigned Courses:\n";
+    for (size_t i = 0; i < assignedCourses.size(); ++i) {
+        out << i + 1 << ". " << assignedCourses[i]->getCourseName() << endl;
+    }
+
+    int courseIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
+        1, assignedCourses.size());
+
+    try {
+        Course& course = *assignedCourses[courseIndex - 1]; // Get the selected course
+        
+        string studentEmail;
+        bool validEmail = false;
+        do {
+            out << "Enter student's email: ";
+            studentEmail = co_await session.readToken();
+            if (Validator::isValidEmail(studentEmail)) {
+                validEmail = true;
+            } else {
+                out << "Invalid email format. Please try again.\n";
+            }
+        } while (!validEmail);
+
+        // Validate student enrollment
+        bool studentFound = false;
+        for (const string& student : course.getStudents()) {
+            if (student == studentEmail) {
+                studentFound = true;
+                break;
+            }
+        }
+
+        if (!studentFound) {
+            out << "Student is not enrolled in this course.\n";
+            session.pause();
+            co_return; // Exit if the student is not enrolled
+        }
+
+        int grade = co_await Validator::getValidatedIntInput(session,
+            "Enter grade (0-100): ",
+            0, 100);
+
+        LMSManager::getInstance()->addGrade(course, studentEmail, grade);
+        out << "Grade added successfully for student: " << studentEmail << endl;
+        session.pause();
+    } catch (const exception& e) {
+        out << e.what() << endl;
+        session.pause();
+    }
+}
+
+// Applies one bulk transform to every grade of an assigned course
+Task<> Teacher::curveGrades(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::curveGrades");
+    session.clear();
+    vector<Course*> assignedCourses;
+    for (auto& course : LMSManager::getInstance()->getCourses()) {
+        if (course.getTeacherEmail() == getEmail()) {
+            assignedCourses.push_back(&course);
+        }
+    }
+    if (assignedCourses.empty()) {
+        out << "You are not assigned to any courses.\n";
+        session.pause();
+        co_return;
+    }
+
+    out << "Your Assigned Courses:\n";
+    for (size_t i = 0; i < assignedCourses.size(); ++i) {
+        out << i + 1 << ". " << assignedCourses[i]->getCourseName()
+            << " (" << assignedCourses[i]->getGradeCount() << " grades)" << endl;
+    }
+    int courseIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
+        1, assignedCourses.size());
+    Course& course = *assignedCourses[courseIndex - 1];
+
+    out << "1. Add or subtract points\n";
+    out << "2. Linear rescale (grade x factor + shift)\n";
+    out << "3. Square-root curve (10 x sqrt(grade))\n";
+    out << "4. Clamp to a range\n";
+    int kind = co_await Validator::getValidatedIntInput(session, "Enter choice (1-4): ", 1, 4);
+
+    GradeTransform transform;
+    switch (kind) {
+        case 1:
+            transform.kind = GradeTransform::Kind::Offset;
+            transform.first = co_await Validator::getValidatedDoubleInput(session, "Points to add (-100 to 100): ", -100, 100);
+            break;
+        case 2:
+            transform.kind = GradeTransform::Kind::Scale;
+            transform.first = co_await Validator::getValidatedDoubleInput(session, "Factor (0-10): ", 0, 10);
+            transform.second = co_await Validator::getValidatedDoubleInput(session, "Shift (-100 to 100): ", -100, 100);
+            break;
+        case 3:
+            transform.kind = GradeTransform::Kind::SquareRoot;
+            break;
+        case 4:
+            transform.kind = GradeTransform::Kind::Clamp;
+            transform.first = co_await Validator::getValidatedDoubleInput(session, "Lowest grade (0-100): ", 0, 100);
+            transform.second = co_await Validator::getValidatedDoubleInput(session, "Highest grade (0-100): ", transform.first, 100);
+            break;
+    }
+
+    LMSManager::getInstance()->curveGrades(course, transform);
+    out << "Applied " << transform.describe() << " to " << course.getGradeCount()
+        << " grade(s) in " << course.getCourseName() << ".\n";
+    session.pause();
+}
+
+Task<> Teacher::manageCourses(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::manageCourses");
     int choice;
     do {
-        system("cls");
-        cout << "\nAdmin Menu:\n";
-        cout << "1. Manage Courses\n";
-        cout << "2. View Reports\n";
-        cout << "3. Enroll Student\n";
-        cout << "4. Remove Student\n";
-        cout << "5. Log Out\n";
-        
-        choice = Validator::getValidatedIntInput("Enter choice (1-5): ", 1, 5);
+        session.clear();
+        out << "\nManage Courses:\n";
+        out << "1. View Course\n";
+        out << "2. Add Content\n";
+        out << "3. Add Grade\n";
+        out << "4. View Assigned Students\n";
+        out << "5. Curve Grades\n";
+        out << "6. Back\n";
+
+        choice = co_await Validator::getValidatedIntInput(session, "Enter choice (1-6): ", 1, 6);
 
         switch (choice) {
             case 1:
-                manageCourses();
+                co_await viewCourse(session);
                 break;
-            case 2:
-                viewReports();
+            case 2: 
+                co_await addContent(session);
                 break;
+                
             case 3:
-                enrollStudent();
+                co_await addGrade(session);
                 break;
-            case 4:
-                removeStudent();
-                system("pause");
+            case 4: {
+                co_await viewAssignedStudents(session);
                 break;
+            }
             case 5:
-                cout << "Logging out...\n";
-                system("pause");
+                co_await curveGrades(session);
+                break;
+            case 6:
+                out << "Returning...\n";
+                session.pause();
                 break;
         }
-    } while (choice != 5);
+    } while (choice != 6);
 }
-void Admin::enrollStudent() {
+
+
+Task<> Teacher::viewAssignedStudents(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::viewAssignedStudents");
+    session.clear();
+    
     vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    
     if (courses.empty()) {
-        cout << "There are no courses available for enrollment.\n";
-        return;
+        out << "No courses available.\n";
+        session.pause();
+        co_return; // Exit if no courses are available
     }
 
-    LMSManager::getInstance()->displayCourses();
-    int userIndex = Validator::getValidatedIntInput(
-        "Enter course index to enroll student (1-" + to_string(courses.size()) + "): ",
-        1, courses.size());
+    // Store courses assigned to this teacher
+    vector<Course*> assignedCourses;
+
+    // Filter courses to find those assigned to the current teacher
+    for (auto& course : courses) {
+        if (course.getTeacherEmail() == getEmail()) {
+            assignedCourses.push_back(&course);
+        }
+    }
+
+    // Check if there are any assigned courses
+    if (assignedCourses.empty()) {
+        out << "You are not assigned to any courses. Cannot view students.\n";
+        session.pause();
+        co_return; // Exit if no courses are assigned
+    }
+
+    // Display the list of assigned courses with 1-based indexing
+    out << "Your Assigned Courses:\n";
+    for (size_t i = 0; i < assignedCourses.size(); ++i) {
+        out << i + 1 << ". " << assignedCourses[i]->getCourseName() << endl;
+    }
+
+    int index = co_await Validator::getValidatedIntInput(session,
+        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
+        1, assignedCourses.size());
 
     try {
-        Course& course = LMSManager::getInstance()->getCourse(userIndex - 1);
-        
-        string studentEmail;
-        string studentPassword;
-        bool validEmail = false;
-        
-        // Email validation
-        do {
-            cout << "Enter student's email: ";
-            cin >> studentEmail;
-            if (Validator::isValidEmail(studentEmail)) {
-                
-                // Check if student already exists
-                bool studentExists = false;
-                for (const auto& user : users) {
-                    if (user->getEmail() == studentEmail) {
-                        studentExists = true;
-                        break;
-                    }
-                }
-                
-                if (studentExists) {
-                    cout << "Student with this email already exists. Cannot create a duplicate account.\n";
-                    return;
-                }
-                
-                validEmail = true;
-            } else {
-                cout << "Invalid email format. Please try again.\n";
-            }
-        } while (!validEmail);
-        
-        // Password input
-        cout << "Enter password for the student: ";
-        cin >> studentPassword;
-        
-        // Create new student
-        UserPtr newStudent = make_shared<Student>(
-            studentEmail.substr(0, studentEmail.find('@')),  // Use email prefix as username
-            studentEmail, 
-            studentPassword
-        );
-        
-        // Add to users list
-        users.push_back(newStudent);
+    Course& course = *assignedCourses[index - 1]; // Get the selected course
+
+    // Check if there are any students in the course
+    const auto& students = course.getStudents();
+    out << "Course: " << course.getCourseName() << " has " << students.size() << " students.\n"; // Debug print
+
+    if (students.empty()) {
+        session.pause();
+        out << "There are no students enrolled in this course.\n";
+    } else {
+        // Display the students enrolled in the selected course
+        course.displayStudents(out);
+        session.pause();
+    }
+    
+    } catch (const exception& e) {
+        out << e.what() << endl;
+        session.pause();
+    }
+}
+Task<> Teacher::addContent(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::addContent");
+    session.clear();
+    
+    vector<Course>& courses = LMSManager::getInstance()->getCourses(); // Get all courses
+
+    if (courses.empty()) {
+        out << "No courses available.\n";
+        session.pause();
+        co_return; // Exit if no courses are available
+    }
+
+    // Store courses assigned to this teacher
+    vector<Course*> assignedCourses;
+
+    // Filter courses to find those assigned to the current teacher
+    for (auto& course : courses) {
+        if (course.getTeacherEmail() == getEmail()) {
+            assignedCourses.push_back(&course);
+        }
+    }
+
+    // Check if there are any assigned courses
+    if (assignedCourses.empty()) {
+        out << "You are not assigned to any courses. Cannot add content.\n";
+        session.pause();
+        co_return; // Exit if no courses are assigned
+    }
+
+    // Display the list of assigned courses with 1-based indexing
+    out << "Your Assigned Courses:\n";
+    for (size_t i = 0; i < assignedCourses.size(); ++i) {
+        out << i + 1 << ". " << assignedCourses[i]->getCourseName() << endl;
+    }
+
+    int index = co_await Validator::getValidatedIntInput(session,
+        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
+        1, assignedCourses.size());
+
+    try {
+        Course& course = *assignedCourses[index - 1]; // Get the selected course
+
+        string content;
+        out << "Enter the content to add: ";
+        co_await session.ignoreChar();
+        content = co_await session.readLine();
         
-        // Enroll in the course
-        course.enrollStudent(studentEmail);
+        // Add content to the course
+        LMSManager::getInstance()->addContent(course, content);
         
-        cout << "Student enrolled successfully and account created.\n";
-        cout << "Username: " << newStudent->getEmail() << endl;
-        system("pause");
+        out << "Content added to the course: " << course.getCourseName() << endl;
+        session.pause();
     } catch (const exception& e) {
-        cout << e.what() << endl;
-        system("pause");
+        out << e.what() << endl;
+        session.pause();
     }
 }
 
-void Admin::removeStudent() {
-    // Check if there are courses available
+Task<> Teacher::viewCourse(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::viewCourse");
+    session.clear();  // Clear screen
+
     vector<Course>& courses = LMSManager::getInstance()->getCourses();
     if (courses.empty()) {
-        cout << "There are no courses available.\n";
-        return;
+        out << "No courses available to view.\n";
+        session.pause();
+        co_return;  // Exit the function if there are no courses
     }
 
-    LMSManager::getInstance()->displayCourses();
-    int userIndex;
-    cout << "Enter course index to remove student (1-" << courses.size() << "): ";
-    cin >> userIndex;
-
-    try {
-        // Convert 1-based user input to 0-based index
-        int systemIndex = userIndex - 1;
-        Course& course = LMSManager::getInstance()->getCourse(systemIndex);
+    // Store courses assigned to this teacher
+    vector<Course*> assignedCourses;
 
-        // Check if the course has any students
-        if (course.getStudents().empty()) {
-            cout << "There is no student here.\n";
-            return;
+    // Filter courses to find those assigned to the current teacher
+    for (auto& course : courses) {
+        if (course.getTeacherEmail() == this->getEmail()) {
+            assignedCourses.push_back(&course);
         }
+    }
 
-        string studentEmail;
-        cout << "Enter student's email to remove: ";
-        cin >> studentEmail;
+    // Check if there are any assigned courses
+    if (assignedCourses.empty()) {
+        out << "No courses are assigned to you.\n";
+        session.pause();
+        co_return;  // Exit if no courses are assigned
+    }
 
-        try {
-            course.removeStudent(studentEmail);
-            cout << "Student removed successfully.\n";
-        } catch (const runtime_error&) {
-            cout << "Student not found in the course.\n";
+    // Display the list of assigned courses with 1-based indexing
+    out << "Your Assigned Courses:\n";
+    for (size_t i = 0; i < assignedCourses.size(); ++i) {
+        out << i + 1 << ". " << assignedCourses[i]->getCourseName() << endl;
+    }
+
+    int index;
+    out << "Enter course index to view (1-based): ";
+    index = co_await session.readInt();
+
+    try {
+        // Validate and adjust for 0-based indexing
+        if (index < 1 || index > assignedCourses.size()) {
+            throw out_of_range("Invalid index");
         }
+
+        // Get the course using 0-based index
+        Course& course = *assignedCourses[index - 1];
+        out << "Viewing course: " << course.getCourseName() << endl;
+        course.displayContents(out);
+        session.pause();  // Wait for the user to see the course contents
     } catch (InvalidCourseIndexException&) {
-        cout << "Invalid course index. Please enter a number between 1 and " 
-             << courses.size() << ".\n";
+        out << "Invalid course index.\n";
+    } catch (out_of_range&) {
+        out << "Invalid course index.\n";
     }
 }
 
-void Admin::manageCourses() {
-    int choice;
-    do {
-        system("cls");
-        cout << "\nManage Courses:\n";
-        cout << "1. Add Course\n";
-        cout << "2. Delete Course\n";
-        cout << "3. Edit Course\n";
-        cout << "4. Display Courses\n";
-        cout << "5. Back\n";
 
-        choice = Validator::getValidatedIntInput("Enter choice (1-5): ", 1, 5);
+Task<> Teacher::viewReports(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Teacher::viewReports");
+    session.clear();  // Clear screen
+    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+    string teacherEmail = getEmail();
 
-        switch (choice) {
-            case 1:
-                addCourse();
-                break;
-            case 2:
-                deleteCourse();
-                system("pause");
-                break;
-            case 3:
-                editCourse();
-                break;
-            case 4:
-                LMSManager::getInstance()->displayCourses();
-                system("pause");
-                break;
-            case 5:
-                cout << "Returning...\n";
-                system("pause");
+    bool hasCourses = false;
+    out << "Courses Report for " << teacherEmail << ":\n";
+    for (auto& course : courses) {
+        if (course.getTeacherEmail() == teacherEmail) {
+            hasCourses = true;
+            out << "Course: " << course.getCourseName() << "\n";
+            out << "Enrolled Students:\n";
+            course.displayStudents(out);
+            out << "Grades:\n";
+            course.displayGrades(out);
+            const GradeRanking& ranking = course.getRanking();
+            if (!ranking.highest().empty()) {
+                StreamFormatScope format(out);
+                out << fixed << setprecision(1) << "Top performers (average):";
+                for (const auto& entry : ranking.highest()) {
+                    out << " " << entry.second << " (" << entry.first << "%)";
+                }
+                out << "\nNeeds attention (average):";
+                for (const auto& entry : ranking.lowest()) {
+                    out << " " << entry.second << " (" << entry.first << "%)";
+                }
+                out << "\n";
+            }
+        session.pause(); 
+            out << "----------------------\n";
+        }
+    }
+
+    if (!hasCourses) {
+        out << "No courses assigned to you.\n";
+    }
+    session.pause();
+    co_return;
+}
+
+// Student class implementation
+Task<> Student::viewEnrolledCourses(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Student::viewEnrolledCourses");
+    vector<Course>& allCourses = LMSManager::getInstance()->getCourses();
+    vector<Course*> enrolledCourses;
+
+    // Find courses where the student is enrolled
+    for (Course& course : allCourses) {
+        for (const string& studentEmail : course.getStudents()) {
+            if (studentEmail == email) {
+                enrolledCourses.push_back(&course);
                 break;
+            }
         }
-    } while (choice != 5);
+    }
+
+    // Check if student is enrolled in any courses
+    if (enrolledCourses.empty()) {
+        out << "You are not enrolled in any courses.\n";
+        co_return;
+    }
+
+    // Display enrolled courses
+    out << "Your Enrolled Courses:\n";
+    for (size_t i = 0; i < enrolledCourses.size(); ++i) {
+        out << i + 1 << ": " << enrolledCourses[i]->getCourseName() 
+             << " (Teacher: " << enrolledCourses[i]->getTeacherEmail() << ")\n";
+    }
+
+    int index = co_await Validator::getValidatedIntInput(session,
+        "Enter course index to view content (or 0 to go back): ", 
+        0, enrolledCourses.size()
+    );
+
+    if (index == 0) co_return;
+
+    // Display course contents
+    try {
+        Course& selectedCourse = *enrolledCourses[index - 1];
+        out << "Selected course: " << selectedCourse.getCourseName() << endl; // Debugging line
+        selectedCourse.displayContents(out);
+        session.pause();
+    } catch (const exception& e) {
+        out << "Error viewing course contents: " << e.what() << endl;
+    }
 }
 
-void Admin::addCourse() {
-    system("cls");
-    string courseName, teacherEmail;
-    
-    cout << "Enter course name: ";
-    cin.ignore();
-    getline(cin, courseName);
-    
-    cout << "Enter teacher's email: ";
-    cin >> teacherEmail;
+Task<> Student::viewGrades(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Student::viewGrades");
+    vector<Course>& allCourses = LMSManager::getInstance()->getCourses();
+    vector<Course*> enrolledCourses;
 
-    // Check if the teacher's email exists among the registered users
-    bool teacherExists = false;
-    for (const auto& user : users) {
-        if (user->getEmail() == teacherEmail) {
-            teacherExists = true;
-            break;
+    // Find courses where the student is enrolled
+    for (Course& course : allCourses) {
+        for (const string& studentEmail : course.getStudents()) {
+            if (studentEmail == email) {
+                enrolledCourses.push_back(&course);
+                break;
+            }
         }
     }
 
-    if (!teacherExists) {
-        char addTeacher;
-        cout << "Error: The email does not belong to a registered teacher.\n";
-        cout << "Would you like to register this teacher? (y/n): ";
-        cin >> addTeacher;
-        cin.ignore(); 
+    // Check if student is enrolled in any courses
+    if (enrolledCourses.empty()) {
+        out << "You are not enrolled in any courses.\n";
+        co_return;
+    }
 
-        if (addTeacher == 'y' || addTeacher == 'Y') {
-            string teacherName, teacherPassword;
+    // Display enrolled courses
+    out << "Your Enrolled Courses:\n";
+    for (size_t i = 0; i < enrolledCourses.size(); ++i) {
+        out << i + 1 << ": " << enrolledCourses[i]->getCourseName() 
+             << " (Teacher: " << enrolledCourses[i]->getTeacherEmail() << ")\n";
+    }
 
-            cout << "Enter teacher's name: ";
-            getline(cin, teacherName);
-            cout << "Enter teacher's password: ";
-            getline(cin, teacherPassword);
+    int index = co_await Validator::getValidatedIntInput(session,
+        "Enter course index to view grades (or 0 to go back): ", 
+        0, enrolledCourses.size()
+    );
 
-            // Create a new Teacher object and add to the users
-            auto newTeacher = make_shared<Teacher>(teacherName, teacherEmail, teacherPassword);
-            users.push_back(newTeacher);
-            cout << "Teacher registered successfully: " << teacherName << " (" << teacherEmail << ")\n";
+    if (index == 0) co_return;
+    
+    // Display course grades
+    try {
+        Course& selectedCourse = *enrolledCourses[index - 1];
+        
+        // Find and display only this student's grade
+        vector<int> grades = selectedCourse.getGradesOf(email);
+        if (!grades.empty()) {
+            out << "Your Grade in " << selectedCourse.getCourseName() 
+                 << ": " << grades.front() << "%" << endl;
         } else {
-            cout << "Course addition canceled.\n";
-            system("pause"); // Wait for user to see the message
-            return; // Exit the function if the admin does not want to register the teacher
+            out << "No grade available for this course.\n";
         }
+
+        LMSManager* lms = LMSManager::getInstance();
+        size_t rank = lms->rankOf(email);
+        if (rank != 0) {
+            out << "Your overall rank: " << rank << " of " << lms->getLeaderboard().size() << endl;
+        }
+    } catch (const exception& e) {
+        out << "Error viewing grades: " << e.what() << endl;
     }
+}
 
-    // Ensure teacher is not managing multiple subjects
+Task<> Student::enrollInCourse(Session& session) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Student::enrollInCourse");
     vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    for (const auto& course : courses) {
-        if (course.getTeacherEmail() == teacherEmail) {
-            cout << "Error: Teacher is already assigned to another course.\n";
-            system("pause");
-            return;
+    vector<Course*> unenrolledCourses;
+
+    // Find courses student is not already enrolled in
+    for (Course& course : courses) {
+        if (!course.isEnrolled(email)) {
+            unenrolledCourses.push_back(&course);
         }
     }
 
-    // Proceed to add the course
-    Course newCourse(courseName, teacherEmail);
-    LMSManager::getInstance()->addCourse(newCourse);
-    cout << "Course added successfully.\n";
-    system("pause");
-}
-void Admin::deleteCourse() {
-    // Check if there are any courses
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    if (courses.empty()) {
-        cout << "There are no courses to delete.\n";
-        system("pause");  // Wait for the user to see the message
-        return;  // Exit the function if there are no courses
+    // Check if there are courses available for enrollment
+    if (unenrolledCourses.empty()) {
+        out << "No courses available for enrollment.\n";
+        co_return;
     }
-    
-    // Display the list of courses if there are courses
-    LMSManager::getInstance()->displayCourses();
-    int index;
-    cout << "Enter course index to delete: ";
-    cin >> index;
-    
-     try {
-        // Validate user input and adjust for 0-based indexing
-        if (index < 1 || index > courses.size()) {
-            throw out_of_range("Invalid index");
+
+    // Suggestions first, from what classmates in the same courses also took
+    LMSManager* lms = LMSManager::getInstance();
+    auto recommendations = lms->recommendCourses(email, 3);
+    if (!recommendations.empty()) {
+        out << "Recommended for you:\n";
+        for (const auto& recommendation : recommendations) {
+            out << "  " << lms->findCourseById(recommendation.courseId)->getCourseName()
+                << " - students who took " << lms->findCourseById(recommendation.becauseOf)->getCourseName()
+                << " also took this (" << recommendation.score << ")\n";
         }
-        
-        // Subtract 1 to convert to 0-based index
-        Course courseToDelete = courses[index - 1];  // Get a copy of the course
-        
-        LMSManager::getInstance()->removeCourse(index - 1);  // Pass 0-based indexad
-        cout << "Successfully deleted course: " << courseToDelete.getCourseName() << endl;
-    } catch (InvalidCourseIndexException&) {
-        cout << "Invalid course index.\n";
-    } catch (out_of_range&) {
-        // Handle case where index is out of vector bounds
-        cout << "Invalid course index.\n";
     }
-}
 
-void Admin::editCourse() {
-    system("cls");  // Clear screen
-
-    // Check if there are courses available
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    if (courses.empty()) {
-        cout << "There are no courses available.\n";
-        system("pause");  // Wait for user to see the message
-        return;  // Exit the function if there are no courses
+    // Display unenrolled courses
+    out << "Available Courses:\n";
+    for (size_t i = 0; i < unenrolledCourses.size(); ++i) {
+        out << i + 1 << ": " << unenrolledCourses[i]->getCourseName() 
+             << " (Teacher: " << unenrolledCourses[i]->getTeacherEmail() << ")";
+        out << " - " << unenrolledCourses[i]->scheduleString();
+        if (!LMSManager::getInstance()->meetsPrerequisites(*unenrolledCourses[i], email)) {
+            out << " [Prerequisites not met]";
+        } else if (unenrolledCourses[i]->isFull()) {
+            out << " [Full, waitlist: " << unenrolledCourses[i]->getWaitlistSize() << "]";
+        }
+        out << "\n";
     }
 
-    // If there are courses, proceed with editing
-    LMSManager::getInstance()->displayCourses();
-    int userIndex;
-    cout << "Enter course index to edit (1-" << courses.size() << "): ";
-    cin >> userIndex;
+    int courseIndex = co_await Validator::getValidatedIntInput(session,
+        "Enter course index to enroll (or 0 to go back): ", 
+        0, unenrolledCourses.size()
+    );
+
+    if (courseIndex == 0) co_return;
 
     try {
-        // Convert 1-based user input to 0-based index
-        int systemIndex = userIndex - 1;
-        Course& course = LMSManager::getInstance()->getCourse(systemIndex);
-        cout << "Editing course: " << course.getCourseName() << endl;
-        
-        cout << "Would you like to edit the course content? (y/n): ";
-        char choice;
-        cin >> choice;
-        
-        if (tolower(choice) == 'y') {
-            int contentChoice;
-            cout << "1. Add content\n2. Remove content\nEnter choice: ";
-            cin >> contentChoice;
+        Course& course = *unenrolledCourses[courseIndex - 1];
+        size_t position = LMSManager::getInstance()->enrollOrWaitlist(course, email);
+        if (position == 0) {
+            out << "Successfully enrolled in the course: " 
+                 << course.getCourseName() << endl;
+        } else {
+            out << course.getCourseName() << " is full. You are number " << position
+                 << " on the waitlist and will be enrolled when a seat frees up.\n";
+        }
+    } catch (const exception& e) {
+        out << e.what() << endl;
+    }
+}
 
-            if (contentChoice == 1) {
-                string content;
-                cout << "Enter content: ";
-                cin.ignore();
-                getline(cin, content);
-                course.addContent(content);
-                cout << "Content added successfully.\n";
-            } 
-            else if (contentChoice == 2) {
-                // Check if there's any content to remove
-                vector<string> contents = course.getContents();
-                if (contents.empty()) {
-                    cout << "There is no content to remove.\n";
-                } 
-                else {
-                    // Display current content with 1-based indexing
-                    cout << "\nCurrent content:\n";
-                    for (size_t i = 0; i < contents.size(); i++) {
-                        cout << i + 1 << ". " << contents[i] << endl;
-                    }
+// Runs password verifications on its own threads so slow hashes never stall
+// the thread driving sessions. Console sessions wait for the result; headless
+// sessions suspend and are resumed by the driver in runCompletions(), so
+// session code always runs on the driver's thread.
+class PasswordVerifier {
+private:
+    ThreadPool pool;
+    mutex lock;
+    condition_variable completed;
+    vector<coroutine_handle<>> ready;
+    size_t pending = 0;
 
-                    int userContentIndex;
-                    cout << "Enter content index to remove (1-" << contents.size() << "): ";
-                    cin >> userContentIndex;
+public:
+    explicit PasswordVerifier(size_t threadCount)
+        : pool(threadCount == 0 ? 1 : threadCount) {}
 
-                    try {
-                        // Convert to 0-based index for internal use
-                        course.removeContent(userContentIndex - 1);
-                        cout << "Content removed successfully.\n";
-                    } 
-                    catch (const out_of_range&) {
-                        cout << "Invalid content index. Please enter a number between 1 and " 
-                             << contents.size() << ".\n";
-                    }
-                }
-            } 
-            else {
-                cout << "Invalid choice. Please select 1 or 2.\n";
+    static PasswordVerifier& shared() {
+        static PasswordVerifier verifier(max(2u, thread::hardware_concurrency() / 2));
+        return verifier;
+    }
+
+    struct Awaiter {
+        PasswordVerifier& verifier;
+        bool blocking;
+        string password;
+        string hash;
+        bool matches = false;
+
+        bool await_ready() {
+            if (!blocking) {
+                return false;
             }
+            auto result = make_shared<promise<bool>>();
+            future<bool> done = result->get_future();
+            verifier.pool.submit([this, result] { result->set_value(PasswordHasher::verify(password, hash)); });
+            matches = done.get();
+            return true;
         }
-    } 
-    catch (InvalidCourseIndexException&) {
-        cout << "Invalid course index. Please enter a number between 1 and " 
-             << courses.size() << ".\n";
-    }
-    
-    system("pause");  // Pause the console to see the message
-}
 
+        void await_suspend(coroutine_handle<> handle) {
+            {
+                lock_guard<mutex> guard(verifier.lock);
+                ++verifier.pending;
+            }
+            verifier.pool.submit([this, handle] {
+                matches = PasswordHasher::verify(password, hash);
+                PasswordVerifier& owner = verifier; // `this` may be gone once the handle is queued
+                {
+                    lock_guard<mutex> guard(owner.lock);
+                    owner.ready.push_back(handle);
+                }
+                owner.completed.notify_all();
+            });
+        }
 
-void Admin::viewReports() {
-    system("cls");  // Clear screen
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
+        bool await_resume() const { return matches; }
+    };
 
-    if (courses.empty()) {
-        cout << "No courses available to generate reports.\n";
-        system("pause");
-        return;
+    Awaiter verify(Session& session, const string& password, const string& hash) {
+        return Awaiter{*this, session.isConsole(), password, hash};
     }
 
-    cout << "Courses Report:\n";
-    for (auto& course : courses) {
-        cout << "Course: " << course.getCourseName() << " (Teacher: " << course.getTeacherEmail() << ")\n";
-        cout << "Enrolled Students:\n";
-        course.displayStudents();
-        cout << "Grades:\n";
-        course.displayGrades();
-        system("pause");   
-        cout << "----------------------\n";
+    // Resumes sessions whose verification finished. With `wait`, blocks until
+    // at least one is ready if any are outstanding. Returns how many resumed.
+    size_t runCompletions(bool wait = false) {
+        vector<coroutine_handle<>> batch;
+        {
+            unique_lock<mutex> guard(lock);
+            if (wait) {
+                completed.wait(guard, [this] { return !ready.empty() || pending == 0; });
+            }
+            batch.swap(ready);
+            pending -= batch.size();
+        }
+        for (auto handle : batch) {
+            handle.resume();
+        }
+        return batch.size();
     }
-    system("pause");
-}
 
-// Teacher class implementation
-void Teacher::displayMenu() {
-    int choice;
-    do {
-        system("cls");
-        cout << "\nTeacher Menu:\n";
-        cout << "1. Manage Courses\n";
-        cout << "2. View Reports\n";
-        cout << "3. Log Out\n";
+    // Resumes sessions until no verification is outstanding
+    void drain() {
+        while (hasPending()) {
+            runCompletions(true);
+        }
+    }
 
-        choice = Validator::getValidatedIntInput("Enter choice (1-3): ", 1, 3);
+    bool hasPending() {
+        lock_guard<mutex> guard(lock);
+        return pending > 0;
+    }
+};
 
-        switch (choice) {
-            case 1:
-                manageCourses();
-                break;
+#ifndef _WIN32
+// Primary side of replication: streams the mutation log to every follower
+// connected on a Unix socket, starting from the first record. Whenever a
+// follower has been sent every record, and at most every HEARTBEAT_MICROS, it
+// also gets a HEARTBEAT record stamped with the time it was caught up.
+class ReplicationServer {
+public:
+    static const long long HEARTBEAT_MICROS = 100000;
 
-            case 2:
-                viewReports();
-                break;
+private:
+    string socketPath;
+    MutationLog& log; // Of the institution that started the server
+    int listenFd = -1;
+    atomic<bool> stopping{false};
+    thread acceptThread;
+    vector<thread> senders;
+    mutex sendersLock;
+
+    static bool sendAll(int fd, const string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) {
+                return false;
+            }
+            sent += written;
+        }
+        return true;
+    }
 
-            case 3:
-                cout << "Logging out...\n";
-                system("pause");
+    void streamTo(int followerFd) {
+        string record;
+        size_t next = 0;
+        long long lastHeartbeat = 0;
+        while (true) {
+            // Taken before the wait, so an Idle result covers every record appended up to `now`
+            long long now = wallClockMicros();
+            bool heartbeatDue = now - lastHeartbeat >= HEARTBEAT_MICROS;
+            MutationLog::Wait result = log.waitForRecord(next, record, stopping,
+                chrono::milliseconds(heartbeatDue ? 0 : HEARTBEAT_MICROS / 1000));
+            if (result == MutationLog::Wait::Stopped) {
                 break;
+            }
+            if (result == MutationLog::Wait::Record) {
+                ++next;
+            } else {
+                LogRecord heartbeat;
+                heartbeat.timestampMicros = now;
+                heartbeat.operation = "HEARTBEAT";
+                record = heartbeat.serialize();
+                lastHeartbeat = now;
+            }
+            if (!sendAll(followerFd, record + "\n")) {
+                break; // Follower went away
+            }
         }
-    } while (choice != 3);
-}
-
-void Teacher::addGrade() {
-    system("cls");
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    
-    if (courses.empty()) {
-        cout << "No courses available.\n";
-        system("pause");
-        return; // Exit if no courses are available
+        close(followerFd);
     }
 
-    // Store courses assigned to this teacher
-    vector<Course> assignedCourses;
-
-    // Filter courses to find those assigned to the current teacher
-    for (const auto& course : courses) {
-        if (course.getTeacherEmail() == getEmail()) {
-            assignedCourses.push_back(course);
+    void acceptLoop() {
+        while (!stopping) {
+            pollfd waiting = {listenFd, POLLIN, 0};
+            if (poll(&waiting, 1, 100) <= 0) {
+                continue;
+            }
+            int followerFd = accept(listenFd, nullptr, nullptr);
+            if (followerFd < 0) {
+                continue;
+            }
+            lock_guard<mutex> guard(sendersLock);
+            senders.emplace_back(&ReplicationServer::streamTo, this, followerFd);
         }
     }
 
-    // Check if there are any assigned courses
-    if (assignedCourses.empty()) {
-        cout << "You are not assigned to any courses. Cannot add grades.\n";
-        system("pause");
-        return; // Exit if no courses are assigned
-    }
+public:
+    explicit ReplicationServer(const string& path) : socketPath(path), log(mutationLog()) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("Socket path too long: " + path);
+        }
+        path.copy(address.sun_path, path.size());
 
-    // Display the list of assigned courses with 1-based indexing
-    cout << "Your Assigned Courses:\n";
-    for (size_t i = 0; i < assignedCourses.size(); ++i) {
-        cout << i + 1 << ". " << assignedCourses[i].getCourseName() << endl;
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listenFd, 16) < 0) {
+            throw runtime_error("Cannot listen on " + path);
+        }
+        acceptThread = thread(&ReplicationServer::acceptLoop, this);
     }
 
-    int courseIndex = Validator::getValidatedIntInput(
-        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
-        1, assignedCourses.size());
+    ~ReplicationServer() {
+        stopping = true;
+        acceptThread.join();
+        for (auto& sender : senders) {
+            sender.join();
+        }
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+};
 
-    try {
-        Course& course = assignedCourses[courseIndex - 1]; // Get the selected course
-        
-        string studentEmail;
-        bool validEmail = false;
-        do {
-            cout << "Enter student's email: ";
-            cin >> studentEmail;
-            if (Validator::isValidEmail(studentEmail)) {
-                validEmail = true;
-            } else {
-                cout << "Invalid email format. Please try again.\n";
+// Follower side: applies streamed records to this process's LMSManager and
+// measures how far behind the primary it is. Reads are bounded: they are
+// refused once the replica has gone longer than the configured limit without
+// proof, from a heartbeat, that it held every record of the primary.
+class ReplicaFollower {
+private:
+    int fd = -1;
+    thread receiver;
+    shared_mutex stateLock; // Writers: the receiver. Readers: report screens.
+    atomic<bool> connected{true};
+    atomic<uint64_t> appliedSequence{0};
+    atomic<long long> lastLagMicros{0};
+    atomic<long long> maxLagMicros{0};
+    atomic<long long> totalLagMicros{0};
+    atomic<long long> caughtUpMicros{0}; // Primary's clock at the last heartbeat
+    long long maxStalenessMicros;
+
+    // Returns false if the record could not be parsed or applied. The replica
+    // then stops replicating rather than serve state that has diverged.
+    bool handle(const string& line) {
+        try {
+            LogRecord record = LogRecord::parse(line);
+            if (record.operation == "HEARTBEAT") {
+                caughtUpMicros = record.timestampMicros; // Records arrive in order, so all before it are applied
+                return true;
             }
-        } while (!validEmail);
+            {
+                unique_lock<shared_mutex> guard(stateLock);
+                applyLogRecord(record);
+            }
+            long long lag = wallClockMicros() - record.timestampMicros;
+            lastLagMicros = lag;
+            totalLagMicros += lag;
+            if (lag > maxLagMicros) {
+                maxLagMicros = lag;
+            }
+            appliedSequence = record.sequence;
+            return true;
+        } catch (const exception& e) {
+            cerr << "Replication stopped: " << e.what() << endl;
+            return false;
+        }
+    }
 
-        // Validate student enrollment
-        bool studentFound = false;
-        for (const string& student : course.getStudents()) {
-            if (student == studentEmail) {
-                studentFound = true;
+    void receive() {
+        string pending;
+        char chunk[4096];
+        bool healthy = true;
+        while (healthy) {
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
                 break;
             }
+            pending.append(chunk, received);
+            size_t lineStart = 0;
+            for (size_t newline; healthy && (newline = pending.find('\n', lineStart)) != string::npos;
+                 lineStart = newline + 1) {
+                healthy = handle(pending.substr(lineStart, newline - lineStart));
+            }
+            pending.erase(0, lineStart);
         }
+        connected = false;
+    }
 
-        if (!studentFound) {
-            cout << "Student is not enrolled in this course.\n";
-            system("pause");
-            return; // Exit if the student is not enrolled
+public:
+    ReplicaFollower(const string& path, long long maxStalenessMs) : maxStalenessMicros(maxStalenessMs * 1000) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("Socket path too long: " + path);
         }
+        path.copy(address.sun_path, path.size());
 
-        int grade = Validator::getValidatedIntInput(
-            "Enter grade (0-100): ",
-            0, 100);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw runtime_error("Cannot connect to primary at " + path);
+        }
+        receiver = thread(&ReplicaFollower::receive, this);
+    }
 
-        course.addGrade(studentEmail, grade);
-        cout << "Grade added successfully for student: " << studentEmail << endl;
-        system("pause");
-    } catch (const exception& e) {
-        cout << e.what() << endl;
-        system("pause");
+    ~ReplicaFollower() {
+        shutdown(fd, SHUT_RDWR);
+        receiver.join();
+        close(fd);
     }
-}
 
-void Teacher::manageCourses() {
+    shared_mutex& lock() { return stateLock; }
+
+    // How long ago the replica last held everything the primary had
+    long long stalenessMicros() const { return wallClockMicros() - caughtUpMicros; }
+
+    // Writes why reads are refused and returns false if the replica is too far behind
+    bool checkFresh(ostream& out) const {
+        long long staleness = stalenessMicros();
+        if (staleness <= maxStalenessMicros) {
+            return true;
+        }
+        out << (caughtUpMicros == 0 ? string("The replica has not caught up with the primary yet")
+                                    : "The replica is " + to_string(staleness / 1000) + " ms behind the primary")
+            << " (limit " << maxStalenessMicros / 1000 << " ms). Try again later or query the primary.\n";
+        return false;
+    }
+
+    void displayStatus(ostream& out) {
+        uint64_t applied = appliedSequence;
+        out << "Connected to primary: " << (connected ? "yes" : "no") << endl;
+        out << "Records applied: " << applied << endl;
+        out << "Replication lag (ms): last " << lastLagMicros / 1000.0
+            << ", average " << (applied == 0 ? 0.0 : totalLagMicros / 1000.0 / applied)
+            << ", max " << maxLagMicros / 1000.0 << endl;
+        out << "Staleness (ms): " << (caughtUpMicros == 0 ? string("not caught up yet") : to_string(stalenessMicros() / 1000))
+            << ", reads refused above " << maxStalenessMicros / 1000 << endl;
+    }
+};
+
+// Read-only screens served by a follower
+Task<> runFollowerSession(Session& session, ReplicaFollower& follower) {
+    ostream& out = session.out();
+    ScreenScope screen(session, "Follower::displayMenu");
     int choice;
     do {
-        system("cls");
-        cout << "\nManage Courses:\n";
-        cout << "1. View Course\n";
-        cout << "2. Add Content\n";
-        cout << "3. Add Grade\n";
-        cout << "4. View Assigned Students\n";
-        cout << "5. Back\n";
+        session.clear();
+        out << "\nRead Replica Menu:\n";
+        out << "1. Courses Report\n";
+        out << "2. Student Transcript\n";
+        out << "3. Replication Status\n";
+        out << "4. Exit\n";
 
-        choice = Validator::getValidatedIntInput("Enter choice (1-5): ", 1, 5);
+        choice = co_await Validator::getValidatedIntInput(session, "Enter choice (1-4): ", 1, 4);
 
         switch (choice) {
-            case 1:
-                viewCourse();
+            case 1: {
+                if (!follower.checkFresh(out)) {
+                    break;
+                }
+                shared_lock<shared_mutex> guard(follower.lock());
+                vector<Course>& courses = LMSManager::getInstance()->getCourses();
+                if (courses.empty()) {
+                    out << "No courses available to generate reports.\n";
+                }
+                for (auto& course : courses) {
+                    out << "Course: " << course.getCourseName() << " (Teacher: " << course.getTeacherEmail() << ")\n";
+                    out << "Enrolled Students:\n";
+                    course.displayStudents(out);
+                    out << "Grades:\n";
+                    course.displayGrades(out);
+                    out << "----------------------\n";
+                }
                 break;
-            case 2: 
-                addContent();
+            }
+            case 2: {
+                out << "Enter student's email: ";
+                string studentEmail = co_await session.readToken();
+                if (!follower.checkFresh(out)) {
+                    break;
+                }
+                shared_lock<shared_mutex> guard(follower.lock());
+                bool enrolledAnywhere = false;
+                for (auto& course : LMSManager::getInstance()->getCourses()) {
+                    if (!course.isEnrolled(studentEmail)) {
+                        continue;
+                    }
+                    enrolledAnywhere = true;
+                    out << course.getCourseName() << ": ";
+                    vector<int> grades = course.getGradesOf(studentEmail);
+                    for (int grade : grades) {
+                        out << grade << "% ";
+                    }
+                    out << (grades.empty() ? "no grade yet" : "") << endl;
+                }
+                if (!enrolledAnywhere) {
+                    out << "Student is not enrolled in any courses.\n";
+                }
                 break;
-                
+            }
             case 3:
-                addGrade();
-                break;
-            case 4: {
-                viewAssignedStudents();
+                follower.displayStatus(out);
                 break;
-            }
-            case 5:
-                cout << "Returning...\n";
-                system("pause");
+            case 4:
+                out << "Exiting...\n";
                 break;
         }
-    } while (choice != 5);
+        if (choice != 4) {
+            session.pause();
+        }
+    } while (choice != 4);
 }
-
-
-void Teacher::viewAssignedStudents() {
-    system("cls");
-    
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    
-    if (courses.empty()) {
-        cout << "No courses available.\n";
-        system("pause");
-        return; // Exit if no courses are available
-    }
-
-    // Store courses assigned to this teacher
-    vector<Course> assignedCourses;
-
-    // Filter courses to find those assigned to the current teacher
-    for (const auto& course : courses) {
-        if (course.getTeacherEmail() == getEmail()) {
-            assignedCourses.push_back(course);
+#endif
+
+// Main menu of a logged-in account, listing its role's slice of MENU_ACTIONS
+Task<> runRoleMenu(UserRecord& account, Session& session) {
+    ostream& out = session.out();
+    Role role = roleId(account);
+    string title = ROLE_TITLES[static_cast<size_t>(role)];
+    ScreenScope screen(session, title + "::displayMenu");
+    span<const MenuAction> actions = actionsOf(role);
+    int logOut = actions.size() + 1;
+    int choice;
+    do {
+        session.clear();
+        out << "\n" << title << " Menu:\n";
+        for (size_t i = 0; i < actions.size(); ++i) {
+            out << i + 1 << ". " << actions[i].label << "\n";
         }
-    }
+        out << logOut << ". Log Out\n";
 
-    // Check if there are any assigned courses
-    if (assignedCourses.empty()) {
-        cout << "You are not assigned to any courses. Cannot view students.\n";
-        system("pause");
-        return; // Exit if no courses are assigned
-    }
+        choice = co_await Validator::getValidatedIntInput(session,
+            "Enter choice (1-" + to_string(logOut) + "): ", 1, logOut);
 
-    // Display the list of assigned courses with 1-based indexing
-    cout << "Your Assigned Courses:\n";
-    for (size_t i = 0; i < assignedCourses.size(); ++i) {
-        cout << i + 1 << ". " << assignedCourses[i].getCourseName() << endl;
-    }
+        if (choice == logOut) {
+            out << "Logging out...\n";
+            session.pause();
+            continue;
+        }
+        const MenuAction& action = actions[choice - 1];
+        if (!isPermitted(role, action.required)) {
+            out << "Permission denied.\n";
+            continue;
+        }
+        co_await action.handler(account, session);
+        if (action.pauseAfter) {
+            session.pause();
+        }
+    } while (choice != logOut);
+}
 
-    int index = Validator::getValidatedIntInput(
-        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
-        1, assignedCourses.size());
+// Login loop of one session: authenticates and hands over to the role menu
+Task<> runLoginSession(Session& session) {
+    ostream& out = session.out();
+    string email, password;
+    bool loggedIn = false;
+
+    while (true) {
+        while (!loggedIn) {
+            session.clear();
+            out << "Learning Management System Login\n";
+            out << "================================\n";
+            out << "Enter your email (or type '0' to exit): ";
+            email = co_await session.readToken();
+
+            if (email == "0") {
+                out << "Exiting program...\n";
+                co_return;
+            }
 
-    try {
-    Course& course = assignedCourses[index - 1]; // Get the selected course
+            out << "Enter your password: ";
+            password = co_await session.readToken();
 
-    // Check if there are any students in the course
-    const auto& students = course.getStudents();
-    cout << "Course: " << course.getCourseName() << " has " << students.size() << " students.\n"; // Debug print
+            // Refuse without checking the password while recent failures are too many
+            double wait = loginThrottle().retryAfter(email, session.getSource());
+            if (wait > 0.0) {
+                out << "Too many failed attempts. Try again in " << static_cast<int>(wait) << " seconds.\n";
+                session.pause();
+                continue;
+            }
 
-    if (students.empty()) {
-        system("pause");
-        cout << "There are no students enrolled in this course.\n";
-    } else {
-        // Display the students enrolled in the selected course
-        course.displayStudents();
-        system("pause");
-    }
-    
-    } catch (const exception& e) {
-        cout << e.what() << endl;
-        system("pause");
-    }
-}
-void Teacher::addContent() {
-    system("cls");
-    
-    vector<Course>& courses = LMSManager::getInstance()->getCourses(); // Get all courses
+            // The session works on its own copy, so the account list can change meanwhile
+            optional<UserRecord> account;
+            if (optional<uint32_t> id = findUserByEmail(email)) {
+                account = users().load(*id);
+            }
+            // Unknown emails are checked against a dummy so timing does not reveal them
+            string hash = account ? userFields(*account).getPasswordHash() : PasswordHasher::unpack(PasswordHasher::dummy());
+            bool matches = co_await PasswordVerifier::shared().verify(session, password, hash);
+            if (matches && account) {
+                loggedIn = true;
+                co_await runRoleMenu(*account, session);
+            }
 
-    if (courses.empty()) {
-        cout << "No courses available.\n";
-        system("pause");
-        return; // Exit if no courses are available
-    }
+            if (!loggedIn) {
+                loginThrottle().recordFailure(email, session.getSource());
+                out << "Invalid login credentials. Please try again.\n";
+                session.pause();
+            }
+        }
 
-    // Store courses assigned to this teacher
-    vector<Course> assignedCourses;
+        out << "Do you want to log in as a different role? (y/n): ";
+        char changeRole = co_await session.readChar();
 
-    // Filter courses to find those assigned to the current teacher
-    for (const auto& course : courses) {
-        if (course.getTeacherEmail() == getEmail()) {
-            assignedCourses.push_back(course);
+        if (tolower(changeRole) == 'n') {
+            out << "Logging out...\n";
+            break;
         }
+        loggedIn = false;
     }
+}
 
-    // Check if there are any assigned courses
-    if (assignedCourses.empty()) {
-        cout << "You are not assigned to any courses. Cannot add content.\n";
-        system("pause");
-        return; // Exit if no courses are assigned
+// Runs one command line of the form "email password action [input;input...]"
+// and returns what the action's screen printed. The inputs answer the screen's
+// prompts in order. Batch files and the command socket both come through here.
+string executeCommand(const string& line, const string& source) {
+    istringstream words(line);
+    string email, password, actionName, inputs;
+    words >> email >> password >> actionName;
+    getline(words >> ws, inputs);
+    if (actionName.empty()) {
+        return "Usage: <email> <password> <action> [input;input...]\n";
     }
 
-    // Display the list of assigned courses with 1-based indexing
-    cout << "Your Assigned Courses:\n";
-    for (size_t i = 0; i < assignedCourses.size(); ++i) {
-        cout << i + 1 << ". " << assignedCourses[i].getCourseName() << endl;
+    if (loginThrottle().retryAfter(email, source) > 0.0) {
+        return "Too many failed attempts. Try again later.\n";
+    }
+    optional<uint32_t> id = findUserByEmail(email);
+    bool matches = PasswordHasher::verify(password, id ? users().credential(*id) : PasswordHasher::dummy());
+    if (!id || !matches) {
+        loginThrottle().recordFailure(email, source);
+        return "Invalid login credentials.\n";
     }
 
-    int index = Validator::getValidatedIntInput(
-        "Enter course index (1-" + to_string(assignedCourses.size()) + "): ",
-        1, assignedCourses.size());
+    Role role = users().role(*id);
+    const MenuAction* action = findAction(role, actionName);
+    if (!action) {
+        return "Unknown " + string(ROLE_TITLES[static_cast<size_t>(role)]) + " action: " + actionName + "\n";
+    }
+    if (!isPermitted(role, action->required)) {
+        return "Permission denied.\n";
+    }
 
-    try {
-        Course& course = assignedCourses[index - 1]; // Get the selected course
+    ostringstream out;
+    Session session(out);
+    session.setSource(source);
+    replace(inputs.begin(), inputs.end(), ';', '\n');
+    session.feed(inputs + "\n");
+    session.closeInput();
 
-        string content;
-        cout << "Enter the content to add: ";
-        cin.ignore();
-        getline(cin, content);
-        
-        // Add content to the course
-        course.addContent(content); // Assuming addContent method is properly defined in Course
-        
-        cout << "Content added to the course: " << course.getCourseName() << endl;
-        system("pause");
+    // A failing command reports on its own output; the batch or socket keeps going
+    try {
+        UserRecord account = users().load(*id);
+        Task<> task = action->handler(account, session);
+        task.start();
+        PasswordVerifier::shared().drain();
+        task.result();
+    } catch (const SessionClosedException&) {
+        out << "\n(Input ended before the action finished.)\n";
     } catch (const exception& e) {
-        cout << e.what() << endl;
-        system("pause");
+        out << "\nError: " << e.what() << endl;
     }
+    return out.str();
 }
 
-void Teacher::viewCourse() {
-    system("cls");  // Clear screen
-
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    if (courses.empty()) {
-        cout << "No courses available to view.\n";
-        system("pause");
-        return;  // Exit the function if there are no courses
+// Runs every non-empty, non-comment line of a file as a command
+void runBatchFile(const string& path) {
+    ifstream file(path);
+    if (!file) {
+        throw runtime_error("Cannot open batch file: " + path);
     }
-
-    // Store courses assigned to this teacher
-    vector<Course> assignedCourses;
-
-    // Filter courses to find those assigned to the current teacher
-    for (const auto& course : courses) {
-        if (course.getTeacherEmail() == this->getEmail()) {
-            assignedCourses.push_back(course);
+    string line;
+    for (size_t lineNumber = 1; getline(file, line); ++lineNumber) {
+        if (line.empty() || line[0] == '#') {
+            continue;
         }
+        cout << "[" << lineNumber << "] " << executeCommand(line, "batch");
     }
+}
 
-    // Check if there are any assigned courses
-    if (assignedCourses.empty()) {
-        cout << "No courses are assigned to you.\n";
-        system("pause");
-        return;  // Exit if no courses are assigned
+#ifndef _WIN32
+// Answers commands on a Unix socket, one command per line. Each reply is the
+// action's output followed by a line holding a single ".". Clients are served
+// one at a time on the calling thread until the process is stopped.
+class CommandServer {
+private:
+    string socketPath;
+    int listenFd = -1;
+    uint64_t connections = 0;
+
+    // Login throttling source of a client: its user ID, so one local user's
+    // failures never lock out another's. A client whose credentials cannot be
+    // read is throttled on its own connection.
+    string peerSource(int clientFd) {
+#ifdef SO_PEERCRED
+        ucred credentials = {};
+        socklen_t length = sizeof(credentials);
+        if (getsockopt(clientFd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0) {
+            return "socket uid " + to_string(credentials.uid);
+        }
+#else
+        uid_t uid;
+        gid_t gid;
+        if (getpeereid(clientFd, &uid, &gid) == 0) {
+            return "socket uid " + to_string(uid);
+        }
+#endif
+        return "socket connection " + to_string(connections);
     }
 
-    // Display the list of assigned courses with 1-based indexing
-    cout << "Your Assigned Courses:\n";
-    for (size_t i = 0; i < assignedCourses.size(); ++i) {
-        cout << i + 1 << ". " << assignedCourses[i].getCourseName() << endl;
+    static bool sendAll(int fd, const string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) {
+                return false;
+            }
+            sent += written;
+        }
+        return true;
     }
 
-    int index;
-    cout << "Enter course index to view (1-based): ";
-    cin >> index;
+    void serveClient(int clientFd) {
+        ++connections;
+        string source = peerSource(clientFd);
+        string pending;
+        char chunk[4096];
+        ssize_t received;
+        while ((received = recv(clientFd, chunk, sizeof(chunk), 0)) > 0) {
+            pending.append(chunk, received);
+            size_t lineStart = 0;
+            for (size_t newline; (newline = pending.find('\n', lineStart)) != string::npos; lineStart = newline + 1) {
+                string line = pending.substr(lineStart, newline - lineStart);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (!sendAll(clientFd, executeCommand(line, source) + ".\n")) {
+                    close(clientFd);
+                    return;
+                }
+            }
+            pending.erase(0, lineStart);
+        }
+        close(clientFd);
+    }
 
-    try {
-        // Validate and adjust for 0-based indexing
-        if (index < 1 || index > assignedCourses.size()) {
-            throw out_of_range("Invalid index");
+public:
+    explicit CommandServer(const string& path) : socketPath(path) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("Socket path too long: " + path);
         }
+        path.copy(address.sun_path, path.size());
 
-        // Get the course using 0-based index
-        Course& course = assignedCourses[index - 1];
-        cout << "Viewing course: " << course.getCourseName() << endl;
-        course.displayContents();
-        system("pause");  // Wait for the user to see the course contents
-    } catch (InvalidCourseIndexException&) {
-        cout << "Invalid course index.\n";
-    } catch (out_of_range&) {
-        cout << "Invalid course index.\n";
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listenFd, 16) < 0) {
+            throw runtime_error("Cannot listen on " + path);
+        }
     }
-}
-
 
-void Teacher::viewReports() {
-    system("cls");  // Clear screen
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    string teacherEmail = getEmail();
+    ~CommandServer() {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
 
-    bool hasCourses = false;
-    cout << "Courses Report for " << teacherEmail << ":\n";
-    for (auto& course : courses) {
-        if (course.getTeacherEmail() == teacherEmail) {
-            hasCourses = true;
-            cout << "Course: " << course.getCourseName() << "\n";
-            cout << "Enrolled Students:\n";
-            course.displayStudents();
-            cout << "Grades:\n";
-            course.displayGrades();
-        system("pause"); 
-            cout << "----------------------\n";
+    void run() {
+        while (true) {
+            int clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd >= 0) {
+                serveClient(clientFd);
+            }
         }
     }
+};
+#endif
 
-    if (!hasCourses) {
-        cout << "No courses assigned to you.\n";
+// Sample institution used by the console program and the benchmarks
+void seedSampleData() {
+    LMSManager* lms = LMSManager::getInstance();
+    if (users().size() > 0) {
+        return; // Restored from a snapshot
     }
-    system("pause");
+
+    Course course1("Mathematics", "teacher1@example.com");
+    course1.addContent("Introduction to Algebra");
+    course1.addContent("Advanced Calculus");
+
+    Course course2("Physics", "teacher2@example.com");
+    course2.addContent("Newton's Laws");
+    course2.addContent("Thermodynamics");
+
+    lms->addCourse(course1);
+    lms->addCourse(course2);
+
+    addUser(Admin("admin1", "admin1@example.com", PasswordHasher::hash("adminpass")));
+    addUser(Teacher("teacher1", "teacher1@example.com", PasswordHasher::hash("teacherpass")));
+    addUser(Teacher("teacher2", "teacher2@example.com", PasswordHasher::hash("teacherpass")));
 }
 
-// Student class implementation
-void Student::displayMenu() {
-    int choice;
-    do {
-        system("cls");
-        cout << "\nStudent Menu:\n";
-        cout << "1. View Enrolled Courses\n";
-        cout << "2. View Grades\n";
-        cout << "3. Log Out\n";
+// Starts over with an empty manager and user list in the bound institution,
+// as a fresh process would
+void resetInstitution() {
+    Institution::current().reset();
+}
 
-        choice = Validator::getValidatedIntInput("Enter choice (1-3): ", 1, 3);
+struct TraceRecord {
+    long long offsetMicros;
+    string screen;
+    string text;
+};
 
-        switch (choice) {
-            case 1:
-                viewEnrolledCourses();
-                break;
-            case 2:
-                viewGrades();
-                system("pause");
-                break;
-            case 3:
-                cout << "Logging out...\n";
-                system("pause");
-                break;
+vector<TraceRecord> loadSessionTrace(const string& path) {
+    ifstream file(path);
+    if (!file) {
+        throw runtime_error("Cannot open trace file: " + path);
+    }
+    vector<TraceRecord> records;
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
         }
-    } while (choice != 3);
+        size_t firstTab = line.find('\t');
+        size_t secondTab = line.find('\t', firstTab + 1);
+        if (firstTab == string::npos || secondTab == string::npos) {
+            throw runtime_error("Malformed trace record: " + line);
+        }
+        records.push_back({stoll(line.substr(0, firstTab)),
+                           line.substr(firstTab + 1, secondTab - firstTab - 1),
+                           unescapeField(line.substr(secondTab + 1))});
+    }
+    return records;
 }
 
-void Student::viewEnrolledCourses() {
-    vector<Course>& allCourses = LMSManager::getInstance()->getCourses();
-    vector<Course> enrolledCourses;
+// Replays a recorded trace headlessly against a freshly seeded institution and
+// reports how long each screen took to handle its input (feed to next prompt)
+void replaySessionTrace(const string& path, bool preserveThinkTime) {
+    vector<TraceRecord> records = loadSessionTrace(path);
+    resetInstitution();
+    seedSampleData();
+
+    ostream discard(nullptr);
+    Session session(discard);
+    Task<> task = runLoginSession(session);
+    task.start();
+
+    map<string, vector<double>> latencies; // screen -> microseconds per input
+    auto replayStart = chrono::steady_clock::now();
+    for (const auto& record : records) {
+        if (task.isDone()) {
+            break;
+        }
+        if (preserveThinkTime) {
+            this_thread::sleep_until(replayStart + chrono::microseconds(record.offsetMicros));
+        }
+        string screen = session.currentScreen();
+        auto start = chrono::steady_clock::now();
+        session.feed(record.text);
+        PasswordVerifier::shared().drain(); // Keep inputs in order behind a pending login
+        latencies[screen].push_back(
+            chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+    }
+    double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - replayStart).count();
 
-    // Find courses where the student is enrolled
-    for (Course& course : allCourses) {
-        for (const string& studentEmail : course.getStudents()) {
-            if (studentEmail == email) {
-                enrolledCourses.push_back(course);
-                break;
-            }
+    session.closeInput();
+    if (task.isDone()) {
+        try {
+            task.result();
+        } catch (const SessionClosedException&) {
+            // The trace ended in the middle of a screen
         }
     }
 
-    // Check if student is enrolled in any courses
-    if (enrolledCourses.empty()) {
-        cout << "You are not enrolled in any courses.\n";
-        return;
+    cout << "Replayed " << records.size() << " inputs from " << path << " in " << totalMs << " ms"
+         << (preserveThinkTime ? " (with think times)" : "") << "\n";
+    cout << "Screen                           inputs   mean us    p50 us    p95 us    max us\n";
+    for (auto& entry : latencies) {
+        vector<double>& samples = entry.second;
+        sort(samples.begin(), samples.end());
+        double total = 0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        cout << left << setw(32) << entry.first << right
+             << setw(7) << samples.size()
+             << setw(10) << fixed << setprecision(1) << total / samples.size()
+             << setw(10) << samples[samples.size() / 2]
+             << setw(10) << samples[min(samples.size() - 1, samples.size() * 95 / 100)]
+             << setw(10) << samples.back() << "\n";
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+    }
+}
+
+// Runs many login sessions on this thread, feeding each one line at a time
+// in round-robin order, the way a socket or replay driver would. Password
+// checks finish on the verifier's threads and are resumed between rounds.
+// Returns how many sessions ran to completion.
+size_t driveScriptedSessions(size_t sessionCount, const vector<string>& script) {
+    ostream discard(nullptr); // Headless sessions print nowhere
+
+    vector<unique_ptr<Session>> sessions;
+    vector<Task<>> tasks;
+    for (size_t i = 0; i < sessionCount; ++i) {
+        sessions.push_back(unique_ptr<Session>(new Session(discard)));
+        sessions.back()->setSource("client-" + to_string(i));
+        tasks.push_back(runLoginSession(*sessions.back()));
     }
 
-    // Display enrolled courses
-    cout << "Your Enrolled Courses:\n";
-    for (size_t i = 0; i < enrolledCourses.size(); ++i) {
-        cout << i + 1 << ": " << enrolledCourses[i].getCourseName() 
-             << " (Teacher: " << enrolledCourses[i].getTeacherEmail() << ")\n";
+    for (auto& task : tasks) {
+        task.start(); // Runs until the first read suspends
     }
+    for (const string& line : script) {
+        for (auto& session : sessions) {
+            session->feed(line + "\n");
+        }
+        PasswordVerifier::shared().runCompletions();
+    }
+    PasswordVerifier::shared().drain();
 
-    int index = Validator::getValidatedIntInput(
-        "Enter course index to view content (or 0 to go back): ", 
-        0, enrolledCourses.size()
-    );
+    size_t finished = 0;
+    for (auto& task : tasks) {
+        if (task.isDone()) {
+            task.result(); // Rethrows anything a session failed with
+            ++finished;
+        }
+    }
+    return finished;
+}
 
-    if (index == 0) return;
+void benchmarkMultiplexedSessions(size_t sessionCount) {
+    const vector<string> script = {
+        "teacher1@example.com", "teacherpass", "2", "1", "6", "3", "n"
+    };
+    auto start = chrono::steady_clock::now();
+    size_t finished = driveScriptedSessions(sessionCount, script);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << finished << "/" << sessionCount << " sessions completed on one thread in "
+         << seconds * 1000 << " ms (" << static_cast<long long>(sessionCount * script.size() / seconds)
+         << " inputs/s)\n";
+}
 
-    // Display course contents
-    try {
-        Course& selectedCourse = enrolledCourses[index - 1];
-        cout << "Selected course: " << selectedCourse.getCourseName() << endl; // Debugging line
-        selectedCourse.displayContents();
-        system("pause");
-    } catch (const exception& e) {
-        cout << "Error viewing course contents: " << e.what() << endl;
+// Login throughput of multiplexed sessions at several hashing work factors
+void benchmarkLogins(size_t sessionCount) {
+    const vector<string> script = {"admin1@example.com", "adminpass",
+                                   to_string(actionsOf(Role::Admin).size() + 1), "n"}; // Log Out
+    cout << "Login throughput (" << sessionCount << " sessions, "
+         << max(2u, thread::hardware_concurrency() / 2) << " verifier threads)\n";
+    uint32_t configured = PasswordHasher::getIterations();
+    for (uint32_t iterations : {1000u, 10000u, 100000u}) {
+        PasswordHasher::setIterations(iterations);
+        resetInstitution();
+        seedSampleData();
+
+        auto hashStart = chrono::steady_clock::now();
+        PasswordHasher::hash("adminpass");
+        double hashMs = chrono::duration<double, milli>(chrono::steady_clock::now() - hashStart).count();
+
+        auto start = chrono::steady_clock::now();
+        size_t finished = driveScriptedSessions(sessionCount, script);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "  " << setw(6) << iterations << " iterations: " << hashMs << " ms per hash, "
+             << finished << "/" << sessionCount << " logins in " << seconds * 1000 << " ms ("
+             << static_cast<long long>(finished / seconds) << " logins/s)\n";
     }
+    PasswordHasher::setIterations(configured);
 }
 
-void Student::viewGrades() {
-    vector<Course>& allCourses = LMSManager::getInstance()->getCourses();
-    vector<Course> enrolledCourses;
+// Fills one institution with students, enrollments and grades
+void simulateInstitution(Institution& institution, size_t studentCount, const string& passwordHash) {
+    Institution::Scope scope(institution);
+    seedSampleData();
+    LMSManager* lms = LMSManager::getInstance();
+    for (size_t s = 0; s < studentCount; ++s) {
+        string email = "student" + to_string(s) + "@example.com";
+        addUser(Student(email, email, passwordHash));
+        for (Course& course : lms->getCourses()) {
+            lms->enrollStudent(course, email);
+            lms->addGrade(course, email, static_cast<int>((s * 37 + course.getId() * 11) % 101));
+        }
+    }
+    lms->refreshRecommendations();
+}
 
-    // Find courses where the student is enrolled
-    for (Course& course : allCourses) {
-        for (const string& studentEmail : course.getStudents()) {
-            if (studentEmail == email) {
-                enrolledCourses.push_back(course);
-                break;
+// Builds independent institutions one after another and then all at once,
+// snapshots each one and checks that none of them saw another's data
+void benchmarkTenants(size_t tenantCount, size_t studentsPerTenant) {
+    cout << "Institutions in one process (" << tenantCount << " institutions, "
+         << studentsPerTenant << " students each)\n";
+    string passwordHash = PasswordHasher::hash("studentpass");
+
+    auto build = [&](bool concurrent) {
+        vector<unique_ptr<Institution>> institutions;
+        for (size_t t = 0; t < tenantCount; ++t) {
+            institutions.push_back(unique_ptr<Institution>(new Institution("institution" + to_string(t))));
+        }
+        auto start = chrono::steady_clock::now();
+        if (concurrent) {
+            vector<thread> workers;
+            for (auto& institution : institutions) {
+                workers.emplace_back([&institution, studentsPerTenant, &passwordHash] {
+                    simulateInstitution(*institution, studentsPerTenant, passwordHash);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        } else {
+            for (auto& institution : institutions) {
+                simulateInstitution(*institution, studentsPerTenant, passwordHash);
             }
         }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << (concurrent ? "  concurrent: " : "  sequential: ") << seconds * 1000 << " ms ("
+             << static_cast<long long>(tenantCount * studentsPerTenant / seconds) << " students/s)\n";
+        return institutions;
+    };
+    build(false);
+    vector<unique_ptr<Institution>> institutions = build(true);
+
+    // Snapshots are written in parallel too, one file per institution
+    auto snapshotPath = [](const Institution& institution) {
+        return (filesystem::temp_directory_path() / ("lms-" + institution.getName() + ".snapshot")).string();
+    };
+    auto start = chrono::steady_clock::now();
+    vector<thread> writers;
+    for (auto& institution : institutions) {
+        writers.emplace_back([&institution, &snapshotPath] {
+            institution->saveSnapshot(snapshotPath(*institution));
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    double snapshotMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "  snapshots: " << snapshotMs << " ms\n";
+
+    size_t isolated = 0;
+    for (auto& institution : institutions) {
+        Institution::Scope scope(*institution);
+        if (users().countWithRole(Role::Student) == studentsPerTenant &&
+            LMSManager::getInstance()->getLeaderboard().size() == studentsPerTenant) {
+            ++isolated;
+        }
     }
+    Institution restored("restored");
+    restored.loadSnapshot(snapshotPath(*institutions[0]));
+    Institution::Scope scope(restored);
+    cout << "  " << isolated << "/" << tenantCount << " institutions hold only their own students; "
+         << "restored snapshot has " << users().countWithRole(Role::Student) << " students\n";
+    for (auto& institution : institutions) {
+        filesystem::remove(snapshotPath(*institution));
+    }
+}
+// Runs several terms back to back, closing each one once the next has started,
+// and reports what stays in memory against what went to the archives
+// Archive directory for a benchmark institution, under the temp directory so
+// benchmarks leave nothing behind in the working directory
+string benchmarkArchiveDirectory(const string& name) {
+    return (filesystem::temp_directory_path() / ("lms-archive-" + name)).string();
+}
 
-    // Check if student is enrolled in any courses
-    if (enrolledCourses.empty()) {
-        cout << "You are not enrolled in any courses.\n";
-        return;
+void benchmarkTerms(size_t termCount, size_t studentCount) {
+    const size_t coursesPerTerm = 20;
+    cout << "Term archival (" << termCount << " terms of " << coursesPerTerm << " courses, "
+         << studentCount << " students)\n";
+    Institution institution("bench-terms");
+    Institution::Scope scope(institution);
+    LMSManager* lms = LMSManager::getInstance();
+    lms->setArchiveDirectory(benchmarkArchiveDirectory("bench-terms"));
+    string passwordHash = PasswordHasher::hash("studentpass");
+    for (size_t s = 0; s < studentCount; ++s) {
+        string email = "student" + to_string(s) + "@example.com";
+        addUser(Student(email, email, passwordHash));
     }
 
-    // Display enrolled courses
-    cout << "Your Enrolled Courses:\n";
-    for (size_t i = 0; i < enrolledCourses.size(); ++i) {
-        cout << i + 1 << ": " << enrolledCourses[i].getCourseName() 
-             << " (Teacher: " << enrolledCourses[i].getTeacherEmail() << ")\n";
+    double closeMs = 0;
+    size_t storedBytes = 0, plainBytes = 0;
+    for (size_t t = 0; t < termCount; ++t) {
+        string term = "Term " + to_string(t + 1);
+        if (t > 0) {
+            lms->startTerm(term);
+        }
+        for (size_t c = 0; c < coursesPerTerm; ++c) {
+            lms->addCourse(Course("Course " + to_string(c) + " of " + term, "teacher1@example.com"));
+            Course& course = lms->getCourses().back();
+            for (size_t s = c % 4; s < studentCount; s += 4) {
+                string email = "student" + to_string(s) + "@example.com";
+                lms->enrollStudent(course, email);
+                lms->addGrade(course, email, static_cast<int>((s + c * 7) % 101));
+            }
+        }
+        if (t > 0) {
+            string previous = "Term " + to_string(t);
+            auto start = chrono::steady_clock::now();
+            lms->closeTerm(previous);
+            closeMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            TermArchive archive = lms->openArchive(previous);
+            storedBytes += archive.storedBytes();
+            plainBytes += archive.plainBytes();
+        }
     }
 
-    int index = Validator::getValidatedIntInput(
-        "Enter course index to view grades (or 0 to go back): ", 
-        0, enrolledCourses.size()
-    );
+    auto start = chrono::steady_clock::now();
+    size_t grades = 0;
+    for (const auto& term : lms->getClosedTerms()) {
+        grades += lms->openArchive(term).transcript("student0@example.com").size();
+    }
+    double transcriptMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "  courses in memory: " << lms->getCourses().size() << ", archived terms: "
+         << lms->getClosedTerms().size() << "\n";
+    cout << "  archives: " << storedBytes << " bytes (" << plainBytes << " as plain text), "
+         << closeMs / max<size_t>(1, termCount - 1) << " ms per close\n";
+    cout << "  transcript across archives: " << grades << " grades in " << transcriptMs << " ms\n";
+    filesystem::remove_all(lms->getArchiveDirectory());
+}
 
-    if (index == 0) return;
-    
-    // Display course grades
-    try {
-        Course& selectedCourse = enrolledCourses[index - 1];
-        
-        // Find and display only this student's grade
-        bool gradeFound = false;
-        for (auto& grade : selectedCourse.getGrades()) {
-            if (grade.first == email) {
-                cout << "Your Grade in " << selectedCourse.getCourseName() 
-                     << ": " << grade.second << "%" << endl;
-                gradeFound = true;
-                break;
+// Loads random (course, student) rows into a grade store, then measures
+// lookups of present and absent keys and whole-course scans
+void benchmarkGradeStore(size_t rowCount) {
+    const int courseCount = 1000;
+    const size_t lookups = 100000;
+    string directory = (filesystem::temp_directory_path() / "lms-bench-grade-store").string();
+    cout << "LSM grade store (" << rowCount << " rows over " << courseCount << " courses)\n";
+    {
+        GradeStore store(directory);
+        mt19937_64 random(42);
+        size_t studentRange = max<size_t>(1, rowCount / courseCount * 4);
+        vector<string> emails(studentRange);
+        for (size_t i = 0; i < studentRange; ++i) {
+            emails[i] = "student" + to_string(i) + "@example.com";
+        }
+        vector<pair<int, size_t>> written;
+        GradeRow row;
+        row.enrolled = true;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < rowCount; ++i) {
+            int course = random() % courseCount;
+            size_t student = random() % studentRange;
+            row.grades.assign(1 + random() % 3, static_cast<int>(random() % 101));
+            store.put(course, emails[student], row);
+            if (i % max<size_t>(1, rowCount / lookups) == 0) {
+                written.push_back({course, student});
             }
         }
+        store.flush();
+        double writeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "  writes: " << static_cast<long long>(rowCount / writeSeconds) << " rows/s\n";
+
+        auto time = [&store](const string& label, const vector<pair<int, string>>& keys) {
+            auto begin = chrono::steady_clock::now();
+            size_t found = 0;
+            for (const auto& key : keys) {
+                found += store.get(key.first, key.second).has_value();
+            }
+            double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+            cout << "  " << label << ": " << micros / keys.size() << " us per lookup, "
+                 << found << "/" << keys.size() << " found\n";
+        };
+        vector<pair<int, string>> present, absent;
+        for (const auto& key : written) {
+            present.push_back({key.first, emails[key.second]});
+            // Known students in courses they have no row in, so only the filters can skip runs
+            absent.push_back({courseCount + key.first, emails[key.second]});
+        }
+        time("present keys", present);
+        time("absent keys", absent);
 
-        if (!gradeFound) {
-            cout << "No grade available for this course.\n";
+        auto scanStart = chrono::steady_clock::now();
+        size_t scanned = 0;
+        for (int course = 0; course < 100; ++course) {
+            scanned += store.scanCourse(course).size();
         }
-    } catch (const exception& e) {
-        cout << "Error viewing grades: " << e.what() << endl;
+        double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - scanStart).count();
+        cout << "  course scans: " << scanMs / 100 << " ms per course (" << scanned / 100 << " rows each)\n";
+        cout << "  ";
+        store.displayStats(cout);
     }
+    filesystem::remove_all(directory);
 }
 
-void Student::enrollInCourse() {
-    vector<Course>& courses = LMSManager::getInstance()->getCourses();
-    vector<Course> unenrolledCourses;
-
-    // Find courses student is not already enrolled in
-    for (Course& course : courses) {
-        bool alreadyEnrolled = false;
-        for (const string& studentEmail : course.getStudents()) {
-            if (studentEmail == email) {
-                alreadyEnrolled = true;
-                break;
+// Builds an email index far larger than its buffer pool and measures how many
+// page reads lookups and prefix scans need once the pool starts cold
+void benchmarkEmailIndex(size_t accountCount) {
+    const size_t lookups = 100000;
+    string path = (filesystem::temp_directory_path() / "lms-bench-emails.idx").string();
+    cout << "B+tree email index (" << accountCount << " accounts, 1 MB buffer pool)\n";
+    {
+        EmailBTree index(path);
+        vector<uint32_t> order(accountCount);
+        iota(order.begin(), order.end(), 0);
+        shuffle(order.begin(), order.end(), mt19937(42));
+        auto emailOf = [](uint32_t id) { return "user" + to_string(id) + "@example.com"; };
+
+        auto start = chrono::steady_clock::now();
+        for (uint32_t id : order) {
+            index.insert(emailOf(id), id);
+        }
+        index.flush();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "  inserts: " << static_cast<long long>(accountCount / seconds) << " per second, "
+             << index.levels() << " levels, " << index.fileBytes() / 1024 << " KB file\n";
+
+        mt19937 random(7);
+        auto time = [&](const string& label, bool present) {
+            index.dropCache();
+            uint64_t readsBefore = index.stats().pageReads;
+            size_t found = 0;
+            auto begin = chrono::steady_clock::now();
+            for (size_t i = 0; i < lookups; ++i) {
+                uint32_t id = random() % accountCount;
+                found += index.find(present ? emailOf(id) : emailOf(id) + ".invalid").has_value();
             }
+            double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+            cout << "  " << label << ": " << micros / lookups << " us per lookup, "
+                 << static_cast<double>(index.stats().pageReads - readsBefore) / lookups
+                 << " page reads per lookup, " << found << "/" << lookups << " found\n";
+        };
+        time("present emails", true);
+        time("absent emails", false);
+
+        index.dropCache();
+        uint64_t readsBefore = index.stats().pageReads;
+        size_t matched = index.scanPrefix("user12", SIZE_MAX, [](const string&, uint32_t) {});
+        cout << "  prefix scan \"user12\": " << matched << " emails, "
+             << index.stats().pageReads - readsBefore << " page reads\n";
+    }
+    filesystem::remove(path);
+}
+
+// Fingerprint of the bound institution's courses, grades and indexes, for
+// checking that two recoveries produced the same state
+uint64_t recoveredStateDigest() {
+    LMSManager* lms = LMSManager::getInstance();
+    string state;
+    for (const auto& course : lms->getCourses()) {
+        state += to_string(course.getId()) + course.getCourseName() + course.getTerm() + '|';
+        vector<string> roster = course.getStudents();
+        for (const auto& studentEmail : roster) {
+            state += studentEmail + (lms->meetsPrerequisites(course, studentEmail) ? "+" : "-");
         }
-        
-        if (!alreadyEnrolled) {
-            unenrolledCourses.push_back(course);
+        course.forEachGrade([&state](const string& studentEmail, int grade) { state += studentEmail + to_string(grade); });
+        state += to_string(course.getCapacity()) + ',' + to_string(course.getWaitlistSize()) + ',' +
+                 to_string(course.getContents().size()) + ',' + course.scheduleString();
+        if (!roster.empty()) {
+            for (const auto& recommendation : lms->recommendCourses(roster[0], 3)) {
+                state += ',' + to_string(recommendation.courseId) + ':' + to_string(recommendation.score);
+            }
         }
     }
-
-    // Check if there are courses available for enrollment
-    if (unenrolledCourses.empty()) {
-        cout << "No courses available for enrollment.\n";
-        return;
+    for (const auto& standing : lms->getLeaderboard().range(1, 50)) {
+        state += lms->studentEmailById(standing.studentId) + to_string(standing.average);
     }
-
-    // Display unenrolled courses
-    cout << "Available Courses:\n";
-    for (size_t i = 0; i < unenrolledCourses.size(); ++i) {
-        cout << i + 1 << ": " << unenrolledCourses[i].getCourseName() 
-             << " (Teacher: " << unenrolledCourses[i].getTeacherEmail() << ")\n";
+    for (const auto& term : lms->getClosedTerms()) {
+        state += term + to_string(lms->openArchive(term).courseCount());
     }
+    return hashString(state) ^ lms->getLeaderboard().size() ^ (users().size() << 32);
+}
 
-    int courseIndex = Validator::getValidatedIntInput(
-        "Enter course index to enroll (or 0 to go back): ", 
-        0, unenrolledCourses.size()
-    );
-
-    if (courseIndex == 0) return;
+// Writes a synthetic log of about `recordCount` records: accounts, three terms
+// (the first one closed), enrollments, waitlists, grades, curves, schedules and
+// prerequisites. Returns the snapshot path.
+string writeRecoveryLog(size_t recordCount) {
+    Institution institution("bench-recovery");
+    Institution::Scope scope(institution);
+    LMSManager* lms = LMSManager::getInstance();
+    lms->setArchiveDirectory(benchmarkArchiveDirectory("bench-recovery"));
+    size_t studentCount = max<size_t>(100, recordCount / 20);
+    string passwordHash = PasswordHasher::hash("studentpass");
+    auto studentEmail = [](size_t s) { return "student" + to_string(s) + "@example.com"; };
+    for (size_t s = 0; s < studentCount; ++s) {
+        addUser(Student(studentEmail(s), studentEmail(s), passwordHash));
+    }
 
-    try {
-        Course& course = unenrolledCourses[courseIndex - 1];
-        course.enrollStudent(email);
-        cout << "Successfully enrolled in the course: " 
-             << course.getCourseName() << endl;
-    } catch (const exception& e) {
-        cout << e.what() << endl;
+    mt19937 random(2024);
+    size_t coursesPerTerm = max<size_t>(10, recordCount / 600);
+    for (int term = 1; term <= 3; ++term) {
+        if (term > 1) {
+            lms->startTerm("Term " + to_string(term));
+        }
+        for (size_t c = 0; c < coursesPerTerm; ++c) {
+            lms->addCourse(Course("Course " + to_string(c) + " of Term " + to_string(term), "teacher1@example.com"));
+        }
+        if (term == 3) {
+            lms->closeTerm("Term 1");
+        }
+        size_t until = recordCount * term / 3;
+        while (mutationLog().size() < until) {
+            vector<Course>& courses = lms->getCourses();
+            Course& course = courses[random() % courses.size()];
+            string student = studentEmail(random() % studentCount);
+            vector<string> roster = course.getStudents();
+            string enrolled = roster.empty() ? "" : roster[random() % roster.size()];
+            uint32_t roll = random() % 100;
+            try {
+                if (roll < 40) {
+                    lms->enrollStudent(course, student);
+                } else if (roll < 70 && !enrolled.empty()) {
+                    lms->addGrade(course, enrolled, 50 + static_cast<int>(random() % 51));
+                } else if (roll < 75 && !enrolled.empty()) {
+                    lms->removeStudent(course, enrolled);
+                } else if (roll < 82 && course.isFull()) {
+                    lms->joinWaitlist(course, student);
+                } else if (roll < 84) {
+                    lms->leaveWaitlist(course, student);
+                } else if (roll < 87) {
+                    lms->setCapacity(course, 10 + random() % 40);
+                } else if (roll < 93) {
+                    lms->addContent(course, "Lesson " + to_string(random() % 1000));
+                } else if (roll < 94) {
+                    lms->curveGrades(course, GradeTransform{GradeTransform::Kind::Offset, 2, 0});
+                } else if (roll < 97) {
+                    int day = static_cast<int>(random() % 5) + 1;
+                    int start = 480 + static_cast<int>(random() % 20) * 30;
+                    lms->setSchedule(course, {TimeSlot(day, start, start + 90)});
+                } else if (course.getId() > 0) {
+                    Course* earlier = lms->findCourseById(static_cast<int>(random() % course.getId()));
+                    if (earlier) {
+                        lms->setPrerequisites(course, {earlier->getId()});
+                    }
+                }
+            } catch (const ValidationException&) {
+                // Invalid picks (already enrolled, full course, time conflict) are not logged
+            }
+        }
     }
+    string path = (filesystem::temp_directory_path() / ("lms-recovery-" + to_string(recordCount) + ".log")).string();
+    institution.saveSnapshot(path);
+    filesystem::remove_all(lms->getArchiveDirectory());
+    return path;
 }
 
-// Main function for login and menu display
-int main() {
-   try {
-        LMSManager* lms = LMSManager::getInstance();
-
-        Course course1("Mathematics", "teacher1@example.com");
-        course1.addContent("Introduction to Algebra");
-        course1.addContent("Advanced Calculus");
-
-        Course course2("Physics", "teacher2@example.com");
-        course2.addContent("Newton's Laws");
-        course2.addContent("Thermodynamics");
+// Times sequential replay against parallel recovery for growing logs and
+// thread counts, checking that every recovery ends in the same state
+// The sequential replay maintains every index record by record. The parallel
+// recovery wins even on one thread because it builds them once at the end;
+// more threads only help the phases that spread over the pool, and only up to
+// the number of hardware threads.
+void benchmarkRecovery(size_t maxRecords, size_t maxThreads) {
+    unsigned hardwareThreads = thread::hardware_concurrency();
+    cout << "Log recovery (up to " << maxRecords << " records, up to " << maxThreads << " threads, "
+         << hardwareThreads << " hardware threads)\n";
+    for (size_t records = max<size_t>(1000, maxRecords / 4); records <= maxRecords; records *= 2) {
+        string path = writeRecoveryLog(records);
+        RecoveryPhases phases;
+        auto recover = [&path, &phases](ThreadPool* pool, uint64_t& digest) {
+            Institution institution("bench-recovery");
+            {
+                Institution::Scope scope(institution);
+                LMSManager::getInstance()->setArchiveDirectory(benchmarkArchiveDirectory("bench-recovery"));
+            }
+            auto start = chrono::steady_clock::now();
+            phases = institution.loadSnapshot(path, pool);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            Institution::Scope scope(institution);
+            digest = recoveredStateDigest();
+            filesystem::remove_all(LMSManager::getInstance()->getArchiveDirectory());
+            return ms;
+        };
+
+        uint64_t expected = 0;
+        double sequentialMs = recover(nullptr, expected);
+        cout << "  " << records << " records: sequential " << sequentialMs << " ms";
+        for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            ThreadPool pool(threads);
+            uint64_t digest = 0;
+            double ms = recover(&pool, digest);
+            cout << ", " << threads << " thread(s) " << ms << " ms" << (digest == expected ? "" : " (MISMATCH)")
+                 << (threads > hardwareThreads ? " (oversubscribed)" : "");
+        }
+        cout << "\n    last run: parse " << phases.parseMs << " ms, partition " << phases.partitionMs
+             << " ms (sequential), replay " << phases.replayMs << " ms, install " << phases.installMs << " ms\n";
+        filesystem::remove(path);
+    }
+}
 
-        lms->addCourse(course1);
-        lms->addCourse(course2);
+// Appends records to a file-backed mutation log from several threads at each
+// durability level, showing how many writes and syncs each batch merged
+void benchmarkLogIo(size_t recordCount, size_t threadCount) {
+    cout << "Mutation log I/O (" << recordCount << " records from " << threadCount << " threads, "
+         << AsyncIo::shared().backend() << ")\n";
+    string path = (filesystem::temp_directory_path() / "lms-bench-io.log").string();
+    for (Durability level : {Durability::Buffered, Durability::Written, Durability::Synced}) {
+        filesystem::remove(path);
+        AsyncIo::Stats before = AsyncIo::shared().stats();
+        double ms;
+        {
+            Institution institution("bench-io");
+            Institution::Scope scope(institution);
+            mutationLog().attachFile(path);
+            mutationLog().setDurability(level);
+            auto start = chrono::steady_clock::now();
+            vector<thread> appenders;
+            for (size_t t = 0; t < threadCount; ++t) {
+                appenders.emplace_back([&institution, t, recordCount, threadCount] {
+                    Institution::Scope bound(institution);
+                    for (size_t i = t; i < recordCount; i += threadCount) {
+                        mutationLog().append("ADD_CONTENT", {"Course " + to_string(i % 50), "Lesson " + to_string(i)});
+                    }
+                });
+            }
+            for (auto& appender : appenders) {
+                appender.join();
+            }
+            ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        } // The log waits for its last write here
+        AsyncIo::Stats after = AsyncIo::shared().stats();
+        const char* names[] = {"buffered", "written", "synced"};
+        cout << "  " << names[static_cast<int>(level)] << ": " << ms << " ms, "
+             << recordCount / max(ms / 1000, 1e-9) << " records/s, "
+             << after.batches - before.batches << " batches, "
+             << after.syncs - before.syncs << " syncs for " << after.syncRequests - before.syncRequests
+             << " requests, " << filesystem::file_size(path) << " bytes\n";
+    }
+    filesystem::remove(path);
+}
 
-        users.push_back(make_shared<Admin>("admin1", "admin1@example.com", "adminpass"));
-        users.push_back(make_shared<Teacher>("teacher1", "teacher1@example.com", "teacherpass"));
-        users.push_back(make_shared<Teacher>("teacher2", "teacher2@example.com", "teacherpass"));
-        
 
-        string email, password;
-        bool loggedIn = false;
 
-        while (true) {
-            while (!loggedIn) {
-                system("cls");
-                cout << "Learning Management System Login\n";
-                cout << "================================\n";
-                cout << "Enter your email (or type '0' to exit): ";
-                cin >> email;
-
-                if (email == "0") {
-                    cout << "Exiting program...\n";
-                    return 0;
-                }
-
-                cout << "Enter your password: ";
-                cin >> password;
-
-                for (const auto& user : users) {
-                    if (user->getEmail() == email && user->getPassword() == password) {
-                        loggedIn = true;
-
-                        // Set the strategy based on user type
-                        if (auto admin = dynamic_cast<Admin*>(user.get())) {
-                            user->setActionStrategy(new AdminActions(admin));
-                        } else if (auto teacher = dynamic_cast<Teacher*>(user.get())) {
-                            user->setActionStrategy(new TeacherActions(teacher));
-                        } else if (auto student = dynamic_cast<Student*>(user.get())) {
-                            user->setActionStrategy(new StudentActions(student));
-                        }
-
-                        user->performAction(); // Perform the action using the strategy
-                        break;
-                    }
-                }
 
-                if (!loggedIn) {
-                    cout << "Invalid login credentials. Please try again.\n";
-                    system("pause");
+// Main function for login and menu display
+int main(int argc, char* argv[]) {
+   try {
+        // Options for every mode come first: the work factor for new password
+        // hashes, an on-disk email index and grade store for the default institution,
+        // a snapshot it is recovered from at startup and that every change is then
+        // appended to, and how durable an appended change must be before it returns
+        while (argc > 2) {
+            string option = argv[1];
+            if (option == "--hash-iterations") {
+                PasswordHasher::setIterations(stoul(argv[2]));
+            } else if (option == "--user-index") {
+                Institution::defaultInstitution().attachUserIndex(argv[2]);
+            } else if (option == "--grade-store") {
+                Institution::defaultInstitution().attachGradeStore(argv[2]);
+            } else if (option == "--snapshot") {
+                if (filesystem::exists(argv[2])) {
+                    Institution::defaultInstitution().loadSnapshot(argv[2], &ThreadPool::shared());
                 }
+                mutationLog().attachFile(argv[2]);
+            } else if (option == "--durability") {
+                mutationLog().setDurability(parseDurability(argv[2]));
+            } else {
+                break;
             }
+            argv += 2;
+            argc -= 2;
+        }
 
-            char changeRole;
-            cout << "Do you want to log in as a different role? (y/n): ";
-            cin >> changeRole;
-
-            if (tolower(changeRole) == 'n') {
-                cout << "Logging out...\n";
-                break;
+        // Command-line modes used for benchmarks and batch work
+        if (argc > 1) {
+            string mode = argv[1];
+            if (mode == "--bench-shards") {
+                size_t maxShards = argc > 2 ? stoul(argv[2]) : thread::hardware_concurrency();
+                benchmarkPartitionedLMS(maxShards == 0 ? 1 : maxShards);
+                return 0;
+            }
+            if (mode == "--bench-pool") {
+                size_t maxThreads = argc > 2 ? stoul(argv[2]) : thread::hardware_concurrency();
+                benchmarkThreadPool(maxThreads == 0 ? 1 : maxThreads);
+                return 0;
+            }
+            if (mode == "--bench-bitmaps") {
+                benchmarkEnrollmentBitmaps(argc > 2 ? stoul(argv[2]) : 100000);
+                return 0;
+            }
+            if (mode == "--bench-recommendations") {
+                benchmarkRecommendations(argc > 2 ? stoul(argv[2]) : 100000, argc > 3 ? stoul(argv[3]) : 10000);
+                return 0;
+            }
+            if (mode == "--bench-curves") {
+                benchmarkGradeCurves(argc > 2 ? stoul(argv[2]) : 10000);
+                return 0;
+            }
+            if (mode == "--bench-leaderboard") {
+                benchmarkLeaderboard(argc > 2 ? stoul(argv[2]) : 1000000);
+                return 0;
+            }
+            if (mode == "--bench-throttle") {
+                benchmarkLoginThrottle(argc > 2 ? stoul(argv[2]) : 1000000);
+                return 0;
+            }
+            if (mode == "--bench-logins") {
+                benchmarkLogins(argc > 2 ? stoul(argv[2]) : 1000);
+                return 0;
+            }
+            if (mode == "--bench-tenants") {
+                benchmarkTenants(argc > 2 ? stoul(argv[2]) : 8, argc > 3 ? stoul(argv[3]) : 2000);
+                return 0;
+            }
+            if (mode == "--bench-terms") {
+                benchmarkTerms(argc > 2 ? stoul(argv[2]) : 12, argc > 3 ? stoul(argv[3]) : 5000);
+                return 0;
             }
-            loggedIn = false;
+            if (mode == "--bench-lsm") {
+                benchmarkGradeStore(argc > 2 ? stoul(argv[2]) : 2000000);
+                return 0;
+            }
+            if (mode == "--bench-btree") {
+                benchmarkEmailIndex(argc > 2 ? stoul(argv[2]) : 1000000);
+                return 0;
+            }
+            if (mode == "--bench-recovery") {
+                size_t maxThreads = argc > 3 ? stoul(argv[3]) : thread::hardware_concurrency();
+                benchmarkRecovery(argc > 2 ? stoul(argv[2]) : 400000, maxThreads == 0 ? 1 : maxThreads);
+                return 0;
+            }
+            if (mode == "--bench-io") {
+                benchmarkLogIo(argc > 2 ? stoul(argv[2]) : 20000, argc > 3 ? stoul(argv[3]) : 4);
+                return 0;
+            }
+            if (mode == "--bench-users") {
+                benchmarkUserModels(argc > 2 ? stoul(argv[2]) : 1000000);
+                return 0;
+            }
+            if (mode == "--bench-sessions") {
+                seedSampleData();
+                benchmarkMultiplexedSessions(argc > 2 ? stoul(argv[2]) : 10000);
+                return 0;
+            }
+            if (mode == "--batch" && argc > 2) {
+                seedSampleData();
+                runBatchFile(argv[2]);
+                return 0;
+            }
+            if (mode == "--replay" && argc > 2) {
+                bool preserveThinkTime = argc > 3 && string(argv[3]) == "--realtime";
+                replaySessionTrace(argv[2], preserveThinkTime);
+                return 0;
+            }
+#ifndef _WIN32
+            if (mode == "--primary" && argc > 2) {
+                // Normal console program that streams its mutation log to followers
+                seedSampleData();
+                ReplicationServer server(argv[2]);
+                Session console(cout, Session::consoleSource());
+                Task<> session = runLoginSession(console);
+                session.start();
+                session.result();
+                return 0;
+            }
+            if (mode == "--serve-commands" && argc > 2) {
+                // Headless program taking commands from clients of a Unix socket
+                seedSampleData();
+                CommandServer server(argv[2]);
+                server.run();
+                return 0;
+            }
+            if (mode == "--follower" && argc > 2) {
+                // Read-only replica: everything, including the sample data, comes from the primary.
+                // The optional argument bounds how stale (ms) a replica may be and still answer reads.
+                ReplicaFollower follower(argv[2], argc > 3 ? stoll(argv[3]) : 1000);
+                Session console(cout, Session::consoleSource());
+                Task<> session = runFollowerSession(console, follower);
+                session.start();
+                session.result();
+                return 0;
+            }
+#endif
+            if (mode == "--record" && argc > 2) {
+                // Normal console program that also writes a session trace
+                seedSampleData();
+                SessionRecorder recorder(argv[2]);
+                Session console(cout, Session::consoleSource());
+                console.setRecorder(&recorder);
+                Task<> session = runLoginSession(console);
+                session.start();
+                session.result();
+                return 0;
+            }
+            cerr << "Unknown option: " << mode << endl;
+            return 1;
         }
+
+        seedSampleData();
+
+        // The console is a single session that blocks on standard input
+        Session console(cout, Session::consoleSource());
+        Task<> session = runLoginSession(console);
+        session.start();
+        session.result();
+    }
+    catch (const SessionClosedException&) {
+        return 0; // Standard input ended
     }
     catch (const exception& e) {
         cerr << "Fatal error: " << e.what() << endl;
@@ -1337,4 +9944,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}